@@ -0,0 +1,477 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// include the implementation (see stb style library:
+// https://github.com/nothings/stb)
+#define CMAT_IMPL
+#include "cmat.h"
+
+// benchmark of the cmat kernels, every case is run until it take at least --min-time seconds then
+// timed --samples times, one line (csv) or object (json) per case with the best and median time of
+// one call, the GFLOP/s and the GB/s (the bytes a call must at least read and write) of the best
+//
+// usage:
+// bench.exe [--format csv|json] [--max-size n] [--threads 1,4,...] [--types f64,f32,i32]
+//           [--kernel name] [--isa scalar|sse2|avx2|avx512] [--min-time seconds] [--samples n]
+// (16 thread counts at most, an unknown isa or a bad value print the usage)
+
+typedef struct {
+    bool        json;
+    size_t      max_size;
+    size_t      threads[16];
+    size_t      num_threads;
+    const char *types;
+    const char *kernel;
+    double      min_time;
+    size_t      samples;
+} BenchOptions;
+
+// the operands of a case, a case of a view layout use views with a stride (see CMat_from_submat)
+// in bigger matrices
+typedef struct {
+    void   *a, *b, *c;
+    void   *parents[3];
+    size_t  n;
+    size_t  count;
+    size_t *piv;
+} BenchCtx;
+
+// a benchmarked kernel, the flops and the bytes of a call are polynomials of n (or of count for
+// the kernels of many small matrices), the bytes are in elements of the type
+typedef struct {
+    const char *name;
+    const char *type;
+    size_t      elem_size;
+    bool        batch; // n is 4 and the size sweep is on the number of matrices
+    bool        cubic; // the kernel use the threads of the gemm
+    double      flops[4];
+    double      elems[4];
+    void (*setup)(BenchCtx *ctx, bool view);
+    void (*run)(BenchCtx *ctx);
+    void (*teardown)(BenchCtx *ctx);
+} BenchKernel;
+
+// read by nobody, the results of the reductions are stored in it so they are not optimized away
+static volatile double bench_sink;
+
+static double bench_now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// an operand, a random n x n matrix or a n x n view of a random (n + 3) x (n + 5) matrix
+#define BENCH_DEFINE_OPERAND(X)                                                                    \
+    static X *bench_operand_##X(void **parent, size_t n, bool view) {                              \
+        X *cmat = malloc(sizeof(X));                                                               \
+        X *full = malloc(sizeof(X));                                                               \
+        X##_init(full, view ? n + 3 : n, view ? n + 5 : n);                                        \
+        CMat_iterate(full, row, col, val, *val = (rand() % 2001 - 1000) / 250.0;);                 \
+        *cmat         = *full;                                                                     \
+        if (view) {                                                                                \
+            cmat->data += full->stride + 1;                                                        \
+            cmat->nrow = n;                                                                        \
+            cmat->ncol = n;                                                                        \
+        }                                                                                          \
+        *parent = full;                                                                            \
+        return cmat;                                                                               \
+    }                                                                                              \
+    static void bench_setup_##X(BenchCtx *ctx, bool view) {                                        \
+        ctx->a = bench_operand_##X(&ctx->parents[0], ctx->n, view);                                \
+        ctx->b = bench_operand_##X(&ctx->parents[1], ctx->n, view);                                \
+        ctx->c = bench_operand_##X(&ctx->parents[2], ctx->n, view);                                \
+    }                                                                                              \
+    static void bench_teardown_##X(BenchCtx *ctx) {                                                \
+        for (size_t i = 0; i < 3; ++i) {                                                           \
+            X##_deinit((X *)ctx->parents[i]);                                                      \
+            free(ctx->parents[i]);                                                                 \
+        }                                                                                          \
+        free(ctx->a);                                                                              \
+        free(ctx->b);                                                                              \
+        free(ctx->c);                                                                              \
+    }                                                                                              \
+    static void bench_dot_##X(BenchCtx *ctx) { X##_dot(ctx->c, ctx->a, ctx->b); }                  \
+    static void bench_transpose_##X(BenchCtx *ctx) { X##_transpose(ctx->c, ctx->a); }              \
+    static void bench_add_##X(BenchCtx *ctx) { X##_add(ctx->c, ctx->a, ctx->b); }                  \
+    static void bench_scale_##X(BenchCtx *ctx) { X##_scale(ctx->c, 3, ctx->a); }                   \
+    static void bench_axpy_##X(BenchCtx *ctx) { X##_axpy(ctx->c, 1, ctx->a); }                     \
+    static void bench_sum_##X(BenchCtx *ctx) { bench_sink = X##_sum(ctx->a); }                     \
+    static void bench_inner_##X(BenchCtx *ctx) { bench_sink = X##_inner(ctx->a, ctx->b); }
+
+BENCH_DEFINE_OPERAND(CMatd)
+BENCH_DEFINE_OPERAND(CMatf)
+BENCH_DEFINE_OPERAND(CMati32)
+
+// a diagonally dominant matrix stay well conditioned after any number of inverse in place
+static void bench_setup_regular(BenchCtx *ctx, bool view) {
+    bench_setup_CMatd(ctx, view);
+    CMat *a = ctx->a;
+    for (size_t i = 0; i < ctx->n; ++i) { CMat_at(a, i, i) += 4.0 * ctx->n; }
+    ctx->piv = malloc(ctx->n * sizeof(*ctx->piv));
+}
+static void bench_teardown_regular(BenchCtx *ctx) {
+    free(ctx->piv);
+    bench_teardown_CMatd(ctx);
+}
+static void bench_det(BenchCtx *ctx) { bench_sink = CMat_det(ctx->a); }
+static void bench_inverse(BenchCtx *ctx) { CMat_inverse(ctx->a); }
+// the time include a n^2 copy since the LU is done in place
+static void bench_lu(BenchCtx *ctx) {
+    CMat_scale(ctx->c, 1, ctx->a);
+    CMat_lu(ctx->c, ctx->piv);
+}
+// the time include a n^2 copy since the decompositions are done in place, b hold the values
+static void bench_qr(BenchCtx *ctx) {
+    CMat *b = ctx->b;
+    CMat_scale(ctx->c, 1, ctx->a);
+    CMat_qr(ctx->c, b->data);
+}
+static void bench_sym_eigen(BenchCtx *ctx) {
+    CMat *a = ctx->a, *b = ctx->b, *c = ctx->c;
+    CMat_iterate(c, row, col, val,
+                 *val = row <= col ? CMat_at(a, row, col) : CMat_at(a, col, row););
+    CMat_sym_eigen(c, b->data, false);
+}
+static void bench_svd(BenchCtx *ctx) {
+    CMat *b = ctx->b;
+    CMat_scale(ctx->c, 1, ctx->a);
+    CMat_svd(ctx->c, b->data, NULL, NULL);
+}
+static void bench_strassen(BenchCtx *ctx) { CMat_strassen(ctx->c, ctx->a, ctx->b); }
+static void bench_dot_tn(BenchCtx *ctx) {
+    CMat    *a = ctx->a, *b = ctx->b, *c = ctx->c;
+    CMatView a_t = CMatView_transpose(&CMat_view(a));
+    CMatView_dot(&CMat_view(c), &a_t, &CMat_view(b));
+}
+static void bench_max_abs(BenchCtx *ctx) { bench_sink = CMat_max_abs(ctx->a); }
+static void bench_eval(BenchCtx *ctx) {
+    CMat_eval(ctx->c, CMatExpr_sub(CMatExpr_add(CMatExpr_scale(2, CMatExpr_mat(ctx->a)),
+                                                CMatExpr_scale(3, CMatExpr_mat(ctx->b))),
+                                   CMatExpr_mat(ctx->c)));
+}
+static void bench_transpose_inplace(BenchCtx *ctx) { CMat_transpose_inplace(ctx->a); }
+
+// the lower triangle of the regular a as a packed CMatTri or CMatSym instead of a
+static void bench_setup_tri(BenchCtx *ctx, bool view) {
+    bench_setup_regular(ctx, view);
+    CMatTri *tri = malloc(sizeof(*tri));
+    CMatTri_from_dense(tri, ctx->a, false);
+    free(ctx->a);
+    ctx->a = tri;
+}
+static void bench_teardown_tri(BenchCtx *ctx) {
+    CMatTri_deinit((CMatTri *)ctx->a);
+    bench_teardown_regular(ctx);
+}
+static void bench_setup_sym(BenchCtx *ctx, bool view) {
+    bench_setup_CMatd(ctx, view);
+    CMatSym *sym = malloc(sizeof(*sym));
+    CMatSym_from_dense(sym, ctx->a);
+    free(ctx->a);
+    ctx->a = sym;
+}
+static void bench_teardown_sym(BenchCtx *ctx) {
+    CMatSym_deinit((CMatSym *)ctx->a);
+    bench_teardown_CMatd(ctx);
+}
+// the time include a n^2 copy since the solve is done in place
+static void bench_tri_solve(BenchCtx *ctx) {
+    CMat_scale(ctx->c, 1, ctx->b);
+    CMatTri_solve(ctx->c, ctx->a);
+}
+static void bench_sym_dot(BenchCtx *ctx) { CMatSym_dot(ctx->c, ctx->a, ctx->b); }
+
+// a n x n CSR with 8 non zeros per row at random cols instead of the a of bench_setup_CMatd
+static void bench_setup_csr(BenchCtx *ctx, bool view) {
+    bench_setup_CMatd(ctx, view);
+    CMatCoo coo;
+    CMatCoo_init(&coo, ctx->n, ctx->n, 8 * ctx->n);
+    for (size_t i = 0; i < ctx->n; ++i) {
+        for (size_t j = 0; j < 8; ++j) {
+            CMatCoo_push(&coo, i, rand() % ctx->n, (rand() % 2001 - 1000) / 250.0);
+        }
+    }
+    free(ctx->a);
+    ctx->a = malloc(sizeof(CMatCsr));
+    CMatCsr_from_coo(ctx->a, &coo);
+    CMatCoo_deinit(&coo);
+}
+static void bench_teardown_csr(BenchCtx *ctx) {
+    CMatCsr_deinit(ctx->a);
+    bench_teardown_CMatd(ctx);
+}
+// the first col of b and c
+static void bench_csr_spmv(BenchCtx *ctx) {
+    CMat x = *(CMat *)ctx->b, y = *(CMat *)ctx->c;
+    x.ncol = y.ncol = 1;
+    CMatCsr_dot(&y, ctx->a, &x);
+}
+static void bench_csr_spmm(BenchCtx *ctx) { CMatCsr_dot(ctx->c, ctx->a, ctx->b); }
+
+// count 4x4 matrices in a CMatBatch (SoA) or in an array of CMat4x4 (AoS)
+static void bench_setup_batch(BenchCtx *ctx, bool view) {
+    (void)view;
+    CMatBatch *batch = malloc(3 * sizeof(CMatBatch));
+    for (size_t i = 0; i < 3; ++i) {
+        CMatBatch_init(&batch[i], 4, 4, ctx->count);
+        for (size_t e = 0; e < 16 * batch[i].stride; ++e) {
+            batch[i].data[e] = (rand() % 2001 - 1000) / 250.0;
+        }
+    }
+    ctx->a = &batch[0];
+    ctx->b = &batch[1];
+    ctx->c = &batch[2];
+}
+static void bench_teardown_batch(BenchCtx *ctx) {
+    CMatBatch *batch = ctx->a;
+    for (size_t i = 0; i < 3; ++i) { CMatBatch_deinit(&batch[i]); }
+    free(batch);
+}
+static void bench_batch_dot(BenchCtx *ctx) { CMatBatch_dot(ctx->c, ctx->a, ctx->b); }
+static void bench_batch_det(BenchCtx *ctx) { CMatBatch_det(((CMatBatch *)ctx->c)->data, ctx->a); }
+static void bench_batch_inverse(BenchCtx *ctx) { CMatBatch_inverse(ctx->c, ctx->a, NULL); }
+static void bench_setup_fixed(BenchCtx *ctx, bool view) {
+    (void)view;
+    CMat4x4 *fixed = malloc(3 * ctx->count * sizeof(CMat4x4));
+    for (size_t i = 0; i < 3 * ctx->count; ++i) {
+        CMat cmat = CMat_from_fixed(&fixed[i]);
+        CMat_iterate(&cmat, row, col, val, *val = (rand() % 2001 - 1000) / 250.0;);
+    }
+    ctx->a = fixed;
+    ctx->b = fixed + ctx->count;
+    ctx->c = fixed + 2 * ctx->count;
+}
+static void bench_teardown_fixed(BenchCtx *ctx) { free(ctx->a); }
+static void bench_fixed_dot(BenchCtx *ctx) {
+    CMat4x4 *a = ctx->a, *b = ctx->b, *c = ctx->c;
+    for (size_t i = 0; i < ctx->count; ++i) { CMat4x4_dot(&c[i], &a[i], &b[i]); }
+}
+static void bench_fixed_inverse(BenchCtx *ctx) {
+    CMat4x4 *a = ctx->a, *c = ctx->c;
+    for (size_t i = 0; i < ctx->count; ++i) { CMat4x4_inverse(&c[i], &a[i]); }
+}
+
+#define BENCH_TYPE(X, type) #type, sizeof(X##Type), false
+#define BENCH_KERNELS_OF(X, type)                                                                  \
+    {"dot", BENCH_TYPE(X, type), true, {0, 0, 0, 2}, {0, 0, 3, 0},                                 \
+     bench_setup_##X, bench_dot_##X, bench_teardown_##X},                                          \
+    {"transpose", BENCH_TYPE(X, type), false, {0}, {0, 0, 2, 0},                                   \
+     bench_setup_##X, bench_transpose_##X, bench_teardown_##X},                                    \
+    {"add", BENCH_TYPE(X, type), false, {0, 0, 1, 0}, {0, 0, 3, 0},                                \
+     bench_setup_##X, bench_add_##X, bench_teardown_##X},                                          \
+    {"scale", BENCH_TYPE(X, type), false, {0, 0, 1, 0}, {0, 0, 2, 0},                              \
+     bench_setup_##X, bench_scale_##X, bench_teardown_##X},                                        \
+    {"axpy", BENCH_TYPE(X, type), false, {0, 0, 2, 0}, {0, 0, 3, 0},                               \
+     bench_setup_##X, bench_axpy_##X, bench_teardown_##X},                                         \
+    {"sum", BENCH_TYPE(X, type), false, {0, 0, 1, 0}, {0, 0, 1, 0},                                \
+     bench_setup_##X, bench_sum_##X, bench_teardown_##X},                                          \
+    {"inner", BENCH_TYPE(X, type), false, {0, 0, 2, 0}, {0, 0, 2, 0},                              \
+     bench_setup_##X, bench_inner_##X, bench_teardown_##X}
+
+static const BenchKernel bench_kernels[] = {
+    BENCH_KERNELS_OF(CMatd, f64),
+    BENCH_KERNELS_OF(CMatf, f32),
+    BENCH_KERNELS_OF(CMati32, i32),
+    {"det", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2.0 / 3.0}, {0, 0, 1, 0},
+     bench_setup_regular, bench_det, bench_teardown_regular},
+    {"inverse", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2}, {0, 0, 2, 0},
+     bench_setup_regular, bench_inverse, bench_teardown_regular},
+    {"lu", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2.0 / 3.0}, {0, 0, 3, 0},
+     bench_setup_regular, bench_lu, bench_teardown_regular},
+    // the values only, the flops of the Householder reductions
+    {"qr", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 4.0 / 3.0}, {0, 0, 3, 0},
+     bench_setup_CMatd, bench_qr, bench_teardown_CMatd},
+    {"sym_eigen", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 4.0 / 3.0}, {0, 0, 3, 0},
+     bench_setup_CMatd, bench_sym_eigen, bench_teardown_CMatd},
+    {"svd", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 8.0 / 3.0}, {0, 0, 3, 0},
+     bench_setup_CMatd, bench_svd, bench_teardown_CMatd},
+    // the nominal flops of the dense product, so the speedup over dot is the ratio of the gflops
+    {"strassen", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2}, {0, 0, 3, 0},
+     bench_setup_CMatd, bench_strassen, bench_teardown_CMatd},
+    // c = a^T . b read in place, the same speed as dot when the packing hide the layout
+    {"dot_tn", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2}, {0, 0, 3, 0},
+     bench_setup_CMatd, bench_dot_tn, bench_teardown_CMatd},
+    {"max_abs", BENCH_TYPE(CMatd, f64), false, {0, 0, 1, 0}, {0, 0, 1, 0},
+     bench_setup_CMatd, bench_max_abs, bench_teardown_CMatd},
+    {"transpose_inplace", BENCH_TYPE(CMatd, f64), false, {0}, {0, 0, 2, 0},
+     bench_setup_CMatd, bench_transpose_inplace, bench_teardown_CMatd},
+    // c = 2 * a + 3 * b - c in one pass
+    {"eval", BENCH_TYPE(CMatd, f64), false, {0, 0, 4, 0}, {0, 0, 4, 0},
+     bench_setup_CMatd, bench_eval, bench_teardown_CMatd},
+    {"tri_solve", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 1}, {0, 0, 3.5, 0},
+     bench_setup_tri, bench_tri_solve, bench_teardown_tri},
+    {"sym_dot", BENCH_TYPE(CMatd, f64), true, {0, 0, 0, 2}, {0, 0, 2.5, 0},
+     bench_setup_sym, bench_sym_dot, bench_teardown_sym},
+    // about 8 non zeros per row, an index is half an element
+    {"csr_spmv", BENCH_TYPE(CMatd, f64), true, {0, 16, 0, 0}, {0, 15, 0, 0},
+     bench_setup_csr, bench_csr_spmv, bench_teardown_csr},
+    {"csr_spmm", BENCH_TYPE(CMatd, f64), true, {0, 0, 16, 0}, {0, 13, 2, 0},
+     bench_setup_csr, bench_csr_spmm, bench_teardown_csr},
+    // 64 mul and 48 add per product, 12 minors, the det and 16 entries of 6 flops per inverse
+    {"batch_dot", "f64", sizeof(CMatType), true, false, {0, 112}, {0, 48},
+     bench_setup_batch, bench_batch_dot, bench_teardown_batch},
+    {"batch_det", "f64", sizeof(CMatType), true, false, {0, 47}, {0, 17},
+     bench_setup_batch, bench_batch_det, bench_teardown_batch},
+    {"batch_inverse", "f64", sizeof(CMatType), true, false, {0, 144}, {0, 32},
+     bench_setup_batch, bench_batch_inverse, bench_teardown_batch},
+    {"fixed_dot", "f64", sizeof(CMatType), true, false, {0, 112}, {0, 48},
+     bench_setup_fixed, bench_fixed_dot, bench_teardown_fixed},
+    {"fixed_inverse", "f64", sizeof(CMatType), true, false, {0, 144}, {0, 32},
+     bench_setup_fixed, bench_fixed_inverse, bench_teardown_fixed},
+};
+
+static double bench_poly(const double coef[4], double x) {
+    return coef[0] + x * (coef[1] + x * (coef[2] + x * coef[3]));
+}
+static int bench_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+// true if name is in the comma separated list (NULL match everything)
+static bool bench_in_list(const char *list, const char *name) {
+    if (!list) { return true; }
+    size_t len = strlen(name);
+    for (const char *s = list; *s;) {
+        const char *end = strchr(s, ',');
+        size_t      n   = end ? (size_t)(end - s) : strlen(s);
+        if (n == len && strncmp(s, name, len) == 0) { return true; }
+        s += n + (end != NULL);
+    }
+    return false;
+}
+
+static void bench_case(const BenchOptions *opt, const BenchKernel *k, size_t n, size_t count,
+                       bool view, size_t threads, bool *first) {
+    BenchCtx ctx = {.n = n, .count = count};
+    k->setup(&ctx, view);
+
+    // double the repetitions until a sample is long enough (the first call is the warm up)
+    size_t reps = 1;
+    k->run(&ctx);
+    for (;;) {
+        double start = bench_now();
+        for (size_t r = 0; r < reps; ++r) { k->run(&ctx); }
+        if (bench_now() - start >= opt->min_time) { break; }
+        reps *= 2;
+    }
+    double times[64];
+    size_t samples = opt->samples;
+    for (size_t s = 0; s < samples; ++s) {
+        double start = bench_now();
+        for (size_t r = 0; r < reps; ++r) { k->run(&ctx); }
+        times[s] = (bench_now() - start) / reps;
+    }
+    qsort(times, samples, sizeof(*times), bench_cmp);
+    k->teardown(&ctx);
+
+    double      x      = k->batch ? count : n;
+    double      best   = times[0];
+    double      median = times[samples / 2];
+    double      gflops = bench_poly(k->flops, x) / best * 1e-9;
+    double      gbps   = bench_poly(k->elems, x) * k->elem_size / best * 1e-9;
+    const char *layout = view ? "view" : "contiguous";
+    const char *isa    = CMat_isa_name(CMat_isa_get());
+    if (opt->json) {
+        printf("%s\n  {\"kernel\": \"%s\", \"type\": \"%s\", \"n\": %zu, \"count\": %zu, "
+               "\"layout\": \"%s\", \"threads\": %zu, \"isa\": \"%s\", \"reps\": %zu, "
+               "\"best_ns\": %.1f, \"median_ns\": %.1f, \"gflops\": %.3f, \"gbps\": %.3f}",
+               *first ? "" : ",", k->name, k->type, n, count, layout, threads, isa, reps,
+               best * 1e9, median * 1e9, gflops, gbps);
+    } else {
+        printf("%s,%s,%zu,%zu,%s,%zu,%s,%zu,%.1f,%.1f,%.3f,%.3f\n", k->name, k->type, n, count,
+               layout, threads, isa, reps, best * 1e9, median * 1e9, gflops, gbps);
+    }
+    fflush(stdout);
+    *first = false;
+}
+
+static void bench_usage() {
+    fputs("usage: bench [--format csv|json] [--max-size n] [--threads 1,4,...]\n"
+          "             [--types f64,f32,i32] [--kernel name,...] [--isa name]\n"
+          "             [--min-time seconds] [--samples n]\n",
+          stderr);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt = {
+        .max_size    = 2048,
+        .threads     = {1, 0},
+        .num_threads = 2,
+        .min_time    = 0.05,
+        .samples     = 3,
+    };
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (i + 1 == argc) { bench_usage(); }
+        const char *val = argv[++i];
+        if (strcmp(arg, "--format") == 0) {
+            opt.json = strcmp(val, "json") == 0;
+        } else if (strcmp(arg, "--max-size") == 0) {
+            opt.max_size = strtoul(val, NULL, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            opt.num_threads = 0;
+            for (char *end; *val; val = end + (*end == ',')) {
+                if (opt.num_threads == 16) { bench_usage(); }
+                opt.threads[opt.num_threads++] = strtoul(val, &end, 10);
+                if (end == val) { bench_usage(); }
+            }
+        } else if (strcmp(arg, "--types") == 0) {
+            opt.types = val;
+        } else if (strcmp(arg, "--kernel") == 0) {
+            opt.kernel = val;
+        } else if (strcmp(arg, "--isa") == 0) {
+            CMatIsa isa = CMAT_ISA_SCALAR;
+            while (isa <= CMAT_ISA_AVX512 && strcmp(CMat_isa_name(isa), val) != 0) { ++isa; }
+            if (isa > CMAT_ISA_AVX512) { bench_usage(); }
+            CMat_isa_set(isa);
+        } else if (strcmp(arg, "--min-time") == 0) {
+            opt.min_time = strtod(val, NULL);
+        } else if (strcmp(arg, "--samples") == 0) {
+            opt.samples = strtoul(val, NULL, 10);
+            if (opt.samples == 0 || opt.samples > 64) { bench_usage(); }
+        } else {
+            bench_usage();
+        }
+    }
+    // 0 is every cpu
+    for (size_t t = 0; t < opt.num_threads; ++t) {
+        CMat_set_num_threads(opt.threads[t]);
+        opt.threads[t] = CMat_get_num_threads();
+    }
+
+    bool first = true;
+    if (opt.json) {
+        fputs("[", stdout);
+    } else {
+        puts("kernel,type,n,count,layout,threads,isa,reps,best_ns,median_ns,gflops,gbps");
+    }
+    for (size_t i = 0; i < sizeof(bench_kernels) / sizeof(*bench_kernels); ++i) {
+        const BenchKernel *k = &bench_kernels[i];
+        if (!bench_in_list(opt.types, k->type) || !bench_in_list(opt.kernel, k->name)) {
+            continue;
+        }
+        if (k->batch) {
+            // from a few matrices to more than the last level cache
+            for (size_t count = 1; count <= (1 << 18); count *= 8) {
+                bench_case(&opt, k, 4, count, false, 1, &first);
+            }
+            continue;
+        }
+        for (size_t n = 2; n <= opt.max_size; n *= 2) {
+            for (size_t view = 0; view < 2; ++view) {
+                for (size_t t = 0; t < (k->cubic ? opt.num_threads : 1); ++t) {
+                    // the same number of threads twice is the same case
+                    if (k->cubic && t > 0 && opt.threads[t] == opt.threads[t - 1]) { continue; }
+                    CMat_set_num_threads(k->cubic ? opt.threads[t] : 1);
+                    bench_case(&opt, k, n, 1, view, CMat_get_num_threads(), &first);
+                }
+            }
+        }
+    }
+    if (opt.json) { puts("\n]"); }
+    CMat_threads_deinit();
+    return 0;
+}
@@ -1,8 +1,6 @@
 #include <math.h>
 #include <stdio.h>
 
-// TODO: diagonal matrix
-
 // include the implementation (see stb style library:
 // https://github.com/nothings/stb)
 #define CMAT_IMPL
@@ -19,7 +17,7 @@ void test_example(const CMat *test, const CMat *expected) {
             CMatType t = CMat_at(test, row, col);     // access test at row col
             CMatType e = CMat_at(expected, row, col); // expected test at row col
             if (round(t * 1e10) / 1e10 != round(e * 1e10) / 1e10) {
-                printf("error at arr[%d][%d], got '%lf', expected '%lf'\n", row, col, t, e);
+                printf("error at arr[%zu][%zu], got '%lf', expected '%lf'\n", row, col, t, e);
                 exit(1);
             }
         }
@@ -66,7 +64,7 @@ void example_dot() {
 void example_subarr() {
     CMatType arr[1][6] = {{1, 2, 3, 4, 5, 6}};
     // create a 2x2 matrix from an array by skiping the first column
-    CMat subcmat = CMat_from_subarr(arr, 0, 1, 2, 2);
+    CMat subcmat = CMat_from_subarr(arr, 0, 1, 2, 2, 3);
     // create a 1x2 matrix from a matrix by skiping the first row
     CMat subcmat2 = CMat_from_submat(&subcmat, 1, 0, 1, 2);
 
@@ -105,6 +103,48 @@ void example_det() {
     }
     printf("\n");
 }
+void example_lu() {
+    // create a 4x4 matrix
+    CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
+    CMat     cmat      = CMat_from_2darr(arr);
+
+    // factorize the matrix in place into L (under the diagonal) and U (on and above)
+    size_t piv[4];
+    CMat_lu(&cmat, piv);
+
+    // create a 4x4 matrix
+    CMatType arr_expected[4][4] = {{-1, 0, 0, -2}, {0, 1, 4, 0}, {-1, 0, 5, -7}, {0, 0, -1, -7}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat, &cmat_expected);
+    // the row 1 was swapped with the row 2
+    if (piv[0] != 0 || piv[1] != 2 || piv[2] != 2 || piv[3] != 3) {
+        printf("wrong pivots\n");
+        exit(1);
+    }
+}
+void example_solve() {
+    // create a 4x4 matrix
+    CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
+    CMat     cmat      = CMat_from_2darr(arr);
+
+    // factorize the matrix once
+    CMatLU lu;
+    CMat_lu_factor(&lu, &cmat);
+
+    // create 2 right hand sides (one per column)
+    CMatType arr_b[4][2] = {{-9, -1}, {-4, 1}, {14, 0}, {-15, 0}};
+    CMat     cmat_b      = CMat_from_2darr(arr_b);
+    // solve cmat . x = b, b get x
+    CMat_lu_solve(&lu, &cmat_b);
+    CMat_lu_deinit(&lu);
+
+    // create a 4x2 matrix
+    CMatType arr_expected[4][2] = {{1, 1}, {2, 0}, {3, 0}, {4, 0}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_b, &cmat_expected);
+}
 void example_inverse() {
     // create a 4x4 matrix
     CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
@@ -127,6 +167,296 @@ void example_inverse() {
     test_example(&cmat_inverse, &cmat_expected);
 }
 
+void example_fixed() {
+    // create a 4x4 transform (a translation of 1, 2, 3) and a point without heap allocating
+    CMat4x4 transform = {{{1, 0, 0, 1}, {0, 1, 0, 2}, {0, 0, 1, 3}, {0, 0, 0, 1}}};
+    CMat4x1 point     = {{{1}, {1}, {1}, {1}}};
+
+    // move the point by the transform then twice by its inverse
+    CMat4x4_dot4x1(&point, &transform, &point);
+    CMat4x4_inverse(&transform, &transform);
+    CMat4x4_dot4x1(&point, &transform, &point);
+    CMat4x4_dot4x1(&point, &transform, &point);
+
+    CMat cmat_point = CMat_from_fixed(&point);
+
+    // create a 4x1 matrix
+    CMatType arr_expected[4][1] = {{0}, {-1}, {-2}, {1}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_point, &cmat_expected);
+}
+void example_batch() {
+    // create a 4x4 matrix
+    CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
+    CMat     cmat      = CMat_from_2darr(arr);
+
+    // create a batch of 3 4x4 matrices, the matrix i is (i + 1) . cmat
+    CMatBatch batch, batch_inverse;
+    CMatBatch_init(&batch, 4, 4, 3);
+    CMatBatch_init(&batch_inverse, 4, 4, 3);
+    for (size_t i = 0; i < batch.count; ++i) {
+        CMat_iterate(&cmat, row, col, val, CMatBatch_at(&batch, i, row, col) = (i + 1) * *val;);
+    }
+
+    // inverse every matrix then multiply it by its inverse
+    CMatBatch_inverse(&batch_inverse, &batch, NULL);
+    CMatBatch_dot(&batch, &batch, &batch_inverse);
+
+    // get the last product
+    CMatType arr_res[4][4];
+    CMat     cmat_res = CMat_from_2darr(arr_res);
+    CMatBatch_get(&cmat_res, &batch, 2);
+    CMatBatch_deinit(&batch);
+    CMatBatch_deinit(&batch_inverse);
+
+    // create a 4x4 identity matrix
+    CMatType arr_expected[4][4];
+    CMat     cmat_expected = CMat_from_2darr(arr_expected);
+    CMat_identity(&cmat_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+void example_binary() {
+    // create a 2x3 matrix
+    CMatType arr[2][3] = {{1, 2, 3}, {4, 5, 6}};
+    CMat     cmat      = CMat_from_2darr(arr);
+
+    // write it to a file then map the file in memory and use it without copying
+    if (!CMat_save("example.cmat", &cmat)) {
+        puts("can't write example.cmat");
+        exit(1);
+    }
+    CMatMap map;
+    CMat    cmat_mapped;
+    if (!CMat_mmap(&map, &cmat_mapped, "example.cmat", true)) {
+        puts("can't map example.cmat");
+        exit(1);
+    }
+
+    test_example(&cmat_mapped, &cmat);
+    CMat_munmap(&map);
+    remove("example.cmat");
+}
+void example_csv() {
+    // create a 2x3 matrix
+    CMatType arr[2][3] = {{1.5, -2, 3e-7}, {4, 0.1, 6e20}};
+    CMat     cmat      = CMat_from_2darr(arr);
+
+    // write it as CSV to a temporary file and read it back in a 3x4 matrix after a row and a col
+    FILE *f = tmpfile();
+    CMat_csv_write(f, &cmat, ',', CMAT_CSV_DEFAULT_PRES);
+    rewind(f);
+
+    CMatType arr_res[3][4] = {{0}};
+    CMat     cmat_res      = CMat_from_2darr(arr_res);
+    CMat     cmat_view     = {.data = &arr_res[1][1], .nrow = 2, .ncol = 3, .stride = 4};
+    if (!CMat_csv_read(f, &cmat_view, ',')) {
+        puts("can't read the CSV");
+        exit(1);
+    }
+    fclose(f);
+
+    // create a 3x4 matrix
+    CMatType arr_expected[3][4] = {{0, 0, 0, 0}, {0, 1.5, -2, 3e-7}, {0, 4, 0.1, 6e20}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+
+    // zeros with any exponent keep their sign, the big exponents aren't exact powers of 10
+    f = tmpfile();
+    fputs("0e31,-0.e169,1.25e33\n0.00000000000000000000000,-0e188,-4e-30\n", f);
+    rewind(f);
+    CMatType arr_cells[2][3];
+    CMat     cmat_cells = CMat_from_2darr(arr_cells);
+    if (!CMat_csv_read(f, &cmat_cells, ',')) {
+        puts("can't read the CSV");
+        exit(1);
+    }
+    fclose(f);
+    if (!signbit(arr_cells[0][1]) || !signbit(arr_cells[1][1]) || signbit(arr_cells[0][0])) {
+        puts("wrong sign of a zero");
+        exit(1);
+    }
+
+    CMatType arr_expected_cells[2][3] = {{0, -0.0, 1.25e33}, {0, -0.0, -4e-30}};
+    CMat     cmat_expected_cells      = CMat_from_2darr(arr_expected_cells);
+    test_example(&cmat_cells, &cmat_expected_cells);
+
+    // only decimal numbers, an hexadecimal one is an error
+    f = tmpfile();
+    fputs("1,0x10,2\n", f);
+    rewind(f);
+    CMat cmat_row = CMat_from_submat(&cmat_cells, 0, 0, 1, 3);
+    if (CMat_csv_read(f, &cmat_row, ',')) {
+        puts("an hexadecimal number was read");
+        exit(1);
+    }
+    fclose(f);
+}
+void example_sparse() {
+    // build a 3x3 sparse matrix from its non zeros, the duplicate (2, 0) entries are summed
+    CMatCoo coo;
+    CMatCoo_init(&coo, 3, 3, 4);
+    CMatCoo_push(&coo, 0, 0, 2);
+    CMatCoo_push(&coo, 2, 0, 1);
+    CMatCoo_push(&coo, 1, 2, -1);
+    CMatCoo_push(&coo, 2, 0, 3);
+    CMatCsr csr;
+    CMatCsr_from_coo(&csr, &coo);
+    CMatCoo_deinit(&coo);
+
+    // multiply it by a 3x2 matrix
+    CMatType arr_b[3][2] = {{1, 2}, {3, 4}, {5, 6}};
+    CMat     cmat_b      = CMat_from_2darr(arr_b);
+    CMatType arr_res[3][2];
+    CMat     cmat_res = CMat_from_2darr(arr_res);
+    CMatCsr_dot(&cmat_res, &csr, &cmat_b);
+    CMatCsr_deinit(&csr);
+
+    // create a 3x2 matrix
+    CMatType arr_expected[3][2] = {{2, 4}, {-5, -6}, {4, 8}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+void example_structured() {
+    // a 3x3 diagonal matrix, only its diagonal is stored
+    CMatDiag diag;
+    CMatDiag_init(&diag, 3);
+    diag.data[0] = 1, diag.data[1] = 2, diag.data[2] = 4;
+
+    // a 3x3 lower triangular matrix, only its 6 elements are stored
+    CMatType arr_l[3][3] = {{2, 0, 0}, {1, 1, 0}, {-1, 3, 1}};
+    CMat     cmat_l      = CMat_from_2darr(arr_l);
+    CMatTri  tri;
+    CMatTri_from_dense(&tri, &cmat_l, false);
+
+    // solve (tri . diag) . x = b, the diagonal is inverted in O(n)
+    CMatType arr_res[3][1] = {{2}, {5}, {23}};
+    CMat     cmat_res      = CMat_from_2darr(arr_res);
+    CMatTri_solve(&cmat_res, &tri);
+    CMatDiag_inverse(&diag);
+    CMatDiag_dot(&cmat_res, &diag, &cmat_res);
+    CMatDiag_deinit(&diag);
+    CMatTri_deinit(&tri);
+
+    // create a 3x1 matrix
+    CMatType arr_expected[3][1] = {{1}, {2}, {3}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+void example_eval() {
+    // create 3 2x2 matrices
+    CMatType arr_a[2][2] = {{1, 2}, {3, 4}};
+    CMat     cmat_a      = CMat_from_2darr(arr_a);
+    CMatType arr_b[2][2] = {{4, 3}, {2, 1}};
+    CMat     cmat_b      = CMat_from_2darr(arr_b);
+    CMatType arr_c[2][2] = {{1, 1}, {1, 1}};
+    CMat     cmat_c      = CMat_from_2darr(arr_c);
+
+    // res = 2 * a + b * b - c in a single pass
+    CMatType arr_res[2][2];
+    CMat     cmat_res = CMat_from_2darr(arr_res);
+    CMat_eval(&cmat_res, CMatExpr_sub(CMatExpr_add(CMatExpr_scale(2, CMatExpr_mat(&cmat_a)),
+                                                   CMatExpr_mul(CMatExpr_mat(&cmat_b),
+                                                                CMatExpr_mat(&cmat_b))),
+                                      CMatExpr_mat(&cmat_c)));
+
+    // create a 2x2 matrix
+    CMatType arr_expected[2][2] = {{17, 12}, {9, 8}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+
+void example_view() {
+    // create a 3x2 and a 3x2 matrix
+    CMatType arr_a[3][2] = {{1, 2}, {3, 4}, {5, 6}};
+    CMat     cmat_a      = CMat_from_2darr(arr_a);
+    CMatType arr_b[3][2] = {{1, 0}, {0, 1}, {1, 1}};
+    CMat     cmat_b      = CMat_from_2darr(arr_b);
+
+    // res = a^T . b without transposing a
+    CMatType arr_res[2][2];
+    CMat     cmat_res = CMat_from_2darr(arr_res);
+    CMatView_dot(&CMat_view(&cmat_res), &CMatView_transpose(&CMat_view(&cmat_a)),
+                 &CMat_view(&cmat_b));
+
+    // create a 2x2 matrix
+    CMatType arr_expected[2][2] = {{6, 8}, {8, 10}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+
+void example_chain() {
+    // create a 2x3, a 3x3 and a 3x1 matrix
+    CMatType arr_a[2][3] = {{1, 0, 1}, {0, 1, 0}};
+    CMat     cmat_a      = CMat_from_2darr(arr_a);
+    CMatType arr_b[3][3] = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    CMat     cmat_b      = CMat_from_2darr(arr_b);
+    CMatType arr_v[3][1] = {{1}, {0}, {-1}};
+    CMat     cmat_v      = CMat_from_2darr(arr_v);
+
+    // res = a . b . v, computed as a . (b . v)
+    CMatType arr_res[2][1];
+    CMat     cmat_res = CMat_from_2darr(arr_res);
+    CMat     chain[]  = {cmat_a, cmat_b, cmat_v};
+    CMat_chain_dot(&cmat_res, chain, 3);
+
+    // create a 2x1 matrix
+    CMatType arr_expected[2][1] = {{-4}, {-2}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_res, &cmat_expected);
+}
+
+void example_inverse_update() {
+    // create a 2x2 matrix and its inverse
+    CMatType arr_inv[2][2] = {{2, 0}, {0, 4}};
+    CMat     cmat_inv      = CMat_from_2darr(arr_inv);
+    CMat_inverse(&cmat_inv);
+
+    // the matrix become {{2, 1}, {0, 4}}: u = e_0 and v = (0, 1)
+    CMatType arr_u[2][1] = {{1}, {0}};
+    CMat     cmat_u      = CMat_from_2darr(arr_u);
+    CMatType arr_v[2][1] = {{0}, {1}};
+    CMat     cmat_v      = CMat_from_2darr(arr_v);
+    CMat_inverse_update(&cmat_inv, 1, &cmat_u, &cmat_v);
+
+    // create a 2x2 matrix
+    CMatType arr_expected[2][2] = {{0.5, -0.125}, {0, 0.25}};
+    CMat     cmat_expected      = CMat_from_2darr(arr_expected);
+
+    test_example(&cmat_inv, &cmat_expected);
+}
+
+void example_decomposition() {
+    // create a 2x2 symmetric matrix, its eigenvalues are 1 and 3
+    CMatType arr_sym[2][2] = {{2, 1}, {1, 2}};
+    CMat     cmat_sym      = CMat_from_2darr(arr_sym);
+    CMatType arr_eig[1][2];
+    CMat     cmat_eig = CMat_from_2darr(arr_eig);
+    CMat_sym_eigen(&cmat_sym, cmat_eig.data, false);
+
+    CMatType arr_expected_eig[1][2] = {{1, 3}};
+    CMat     cmat_expected_eig      = CMat_from_2darr(arr_expected_eig);
+    test_example(&cmat_eig, &cmat_expected_eig);
+
+    // create a 3x2 matrix, its singular values are 4 and 3
+    CMatType arr[3][2] = {{3, 0}, {0, -4}, {0, 0}};
+    CMat     cmat      = CMat_from_2darr(arr);
+    CMatType arr_s[1][2];
+    CMat     cmat_s = CMat_from_2darr(arr_s);
+    CMat_svd(&cmat, cmat_s.data, NULL, NULL);
+
+    CMatType arr_expected_s[1][2] = {{4, 3}};
+    CMat     cmat_expected_s      = CMat_from_2darr(arr_expected_s);
+    test_example(&cmat_s, &cmat_expected_s);
+}
+
 int main() {
     example_add();
     puts("=========================");
@@ -138,6 +468,32 @@ int main() {
     puts("=========================");
     example_det();
     puts("=========================");
+    example_lu();
+    puts("=========================");
+    example_solve();
+    puts("=========================");
     example_inverse();
+    puts("=========================");
+    example_fixed();
+    puts("=========================");
+    example_batch();
+    puts("=========================");
+    example_binary();
+    puts("=========================");
+    example_csv();
+    puts("=========================");
+    example_sparse();
+    puts("=========================");
+    example_structured();
+    puts("=========================");
+    example_eval();
+    puts("=========================");
+    example_view();
+    puts("=========================");
+    example_chain();
+    puts("=========================");
+    example_inverse_update();
+    puts("=========================");
+    example_decomposition();
     return 0;
 }
@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // define CMAT_NO_PRINT to disable importing stdio at the cost of not having printing
 #ifndef CMAT_NO_PRINT
@@ -46,7 +47,7 @@ typedef struct {
 /// @param num_elem the number of element
 /// @param size_elem the size of one element
 ///
-#define CMAT_MALLOC(num_elem, size_elem) malloc(num_elem *size_elem)
+#define CMAT_MALLOC(num_elem, size_elem) malloc((num_elem) * (size_elem))
 #endif // CMAT_MALLOC
 
 // define CMAT_FREE before including cmat to replace free
@@ -75,6 +76,190 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 ///
 #define CMat_deinit(cmat) (CMAT_FREE((cmat)->data))
 
+// the alignment of the allocations of CMatArena and CMatBlockPool (a cache line)
+#define CMAT_ALIGN 64
+///
+/// @brief an allocator given to the *_with functions or used for the temporaries (see
+/// CMat_set_scratch_allocator)
+///
+/// example:
+/// void *my_alloc(void *ctx, size_t size) { return malloc(size); }
+/// void  my_free(void *ctx, void *ptr, size_t size) { free(ptr); }
+///
+/// CMatAllocator alloc = {.alloc = my_alloc, .free = my_free, .ctx = NULL};
+/// CMat          cmat;
+/// CMat_init_with(&cmat, 3, 3, &alloc);
+/// CMat_deinit_with(&cmat, &alloc);
+///
+typedef struct {
+    void *(*alloc)(void *ctx, size_t size);          /// @memberof alloc NULL if it failed
+    void (*free)(void *ctx, void *ptr, size_t size); /// @memberof free size is the one of alloc
+    void *ctx; /// @memberof ctx the first parameter of alloc and free
+} CMatAllocator;
+///
+/// @brief the allocator using CMAT_MALLOC and CMAT_FREE (the default)
+///
+///
+extern const CMatAllocator CMat_heap_allocator;
+
+///
+/// @brief initiliaze a matrix with the memory of an allocator (O(1) ?) (allocate)
+///
+/// @param cmat an non initialize matrix we went to initiliaze
+/// @param nrow the number of row
+/// @param ncol the number of col
+/// @param alloc the allocator to use
+///
+void CMat_init_with(CMat *cmat, size_t nrow, size_t ncol, const CMatAllocator *alloc);
+///
+/// @brief deinitialize a matrix initialized by CMat_init_with (O(1) ?) (free)
+///
+/// @param cmat matrix to deinitialize
+/// @param alloc the allocator given to CMat_init_with
+///
+void CMat_deinit_with(CMat *cmat, const CMatAllocator *alloc);
+
+// define CMAT_STRIDE_AVOID before including cmat to change the power of 2 (in bytes) the stride
+// of CMat_init_aligned is never a multiple of: rows that far apart map to the same cache sets and
+// alias in the store buffer (4K aliasing) when a kernel walk down a column
+#ifndef CMAT_STRIDE_AVOID
+#define CMAT_STRIDE_AVOID 2048
+#endif // CMAT_STRIDE_AVOID
+///
+/// @brief the stride CMat_init_aligned use for ncol: a multiple of a cache line (CMAT_ALIGN) and
+/// not a multiple of CMAT_STRIDE_AVOID bytes (O(1))
+///
+/// example:
+/// CMat_aligned_stride(3);    // 8
+/// CMat_aligned_stride(256);  // 264 (256 * sizeof(CMatType) is a multiple of 2048)
+///
+/// @param ncol the number of col
+/// @return the stride
+///
+size_t CMat_aligned_stride(size_t ncol);
+///
+/// @brief initiliaze a matrix with every row aligned on a cache line (CMAT_ALIGN) and a padded
+/// stride (see CMat_aligned_stride) so the kernels use aligned loads and stores and don't suffer
+/// from cache set conflicts with power of 2 sizes (O(1) ?) (allocate)
+///
+/// warning:
+/// the padding at the end of the rows is not initialized
+///
+/// @param cmat an non initialize matrix we went to initiliaze
+/// @param nrow the number of row
+/// @param ncol the number of col
+///
+void CMat_init_aligned(CMat *cmat, size_t nrow, size_t ncol);
+///
+/// @brief deinitialize a matrix initialized by CMat_init_aligned (O(1) ?) (free)
+///
+/// @param cmat matrix to deinitialize
+///
+void CMat_deinit_aligned(CMat *cmat);
+
+///
+/// @brief a bump allocator: an allocation move a cursor in a buffer, a free only give back the
+/// memory of the last allocation and a reset give back everything at once
+///
+/// example:
+/// CMatArena arena;
+/// CMat_arena_init(&arena, NULL, 1 << 20);
+/// CMatAllocator alloc = CMat_arena_allocator(&arena);
+/// for (;;) {
+///     // every temporary of a request come from the arena
+///     const CMatAllocator *prev = CMat_set_scratch_allocator(&alloc);
+///     CMat                 res;
+///     CMat_init_with(&res, n, n, &alloc);
+///     CMat_inverse(&a);
+///     CMat_dot(&res, &a, &b);
+///     CMat_set_scratch_allocator(prev);
+///     CMat_arena_reset(&arena);
+/// }
+/// CMat_arena_deinit(&arena);
+///
+///
+typedef struct {
+    unsigned char *buf;   /// @memberof buf the memory of the arena
+    size_t         size;  /// @memberof size the size of buf
+    size_t         used;  /// @memberof used the bytes used in buf
+    size_t         peak;  /// @memberof peak the max of used since the init (to size the arena)
+    bool           owned; /// @memberof owned true if buf was allocated by CMat_arena_init
+} CMatArena;
+///
+/// @brief initialize an arena (O(1)) (allocate if buf is NULL)
+///
+/// @param arena the arena to initialize
+/// @param buf the memory of the arena or NULL to allocate it with CMAT_MALLOC
+/// @param size the size of buf in bytes
+///
+void CMat_arena_init(CMatArena *arena, void *buf, size_t size);
+///
+/// @brief deinitialize an arena (O(1)) (free if buf was NULL in CMat_arena_init)
+///
+/// @param arena the arena to deinitialize
+///
+void CMat_arena_deinit(CMatArena *arena);
+///
+/// @brief give back every allocation of an arena (O(1))
+///
+/// @param arena the arena to reset
+///
+#define CMat_arena_reset(arena) ((arena)->used = 0)
+///
+/// @brief the allocator allocating in an arena (O(1))
+///
+/// @param arena the arena to allocate in
+/// @return the allocator
+///
+CMatAllocator CMat_arena_allocator(CMatArena *arena);
+
+///
+/// @brief a pool of blocks of the same size, an allocation take a free block if its size fit
+///
+///
+typedef struct {
+    void  *free_list;  /// @memberof free_list the first free block (a free block point to the next)
+    void  *buf;        /// @memberof buf the memory of the blocks
+    size_t block_size; /// @memberof block_size the size of a block
+    bool   owned;      /// @memberof owned true if buf was allocated by CMat_block_pool_init
+} CMatBlockPool;
+// the size of the buffer CMat_block_pool_init need for num_blocks blocks of block_size
+#define CMAT_BLOCK_POOL_SIZE(block_size, num_blocks)                                               \
+    (((block_size) + CMAT_ALIGN - 1) / CMAT_ALIGN * CMAT_ALIGN * (num_blocks) + CMAT_ALIGN)
+///
+/// @brief initialize a pool of blocks (O(num_blocks)) (allocate if buf is NULL)
+///
+/// @param pool the pool to initialize
+/// @param buf the memory of the pool of CMAT_BLOCK_POOL_SIZE(block_size, num_blocks) bytes or
+/// NULL to allocate it with CMAT_MALLOC
+/// @param block_size the size of a block in bytes (the max size of an allocation)
+/// @param num_blocks the number of blocks
+///
+void CMat_block_pool_init(CMatBlockPool *pool, void *buf, size_t block_size, size_t num_blocks);
+///
+/// @brief deinitialize a pool of blocks (O(1)) (free if buf was NULL in CMat_block_pool_init)
+///
+/// @param pool the pool to deinitialize
+///
+void CMat_block_pool_deinit(CMatBlockPool *pool);
+///
+/// @brief the allocator allocating in a pool of blocks (O(1))
+///
+/// @param pool the pool to allocate in
+/// @return the allocator
+///
+CMatAllocator CMat_block_pool_allocator(CMatBlockPool *pool);
+
+///
+/// @brief set the allocator of the temporaries (gemm packing buffers, determinant, inverse,
+/// adjugate, solve, print...) of the calling thread, with an arena or a pool of blocks the
+/// functions do no malloc (except the thread pool creating its threads and buffers once)
+///
+/// @param alloc the allocator of the temporaries or NULL for CMat_heap_allocator
+/// @return the previous allocator of the temporaries
+///
+const CMatAllocator *CMat_set_scratch_allocator(const CMatAllocator *alloc);
+
 ///
 /// @brief equivalent to accessing a pointer by adding the index (zero based) (O(1))
 ///
@@ -120,7 +305,7 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 #define CMat_iterate(cmat, row, col, val, block)                                                   \
     for (size_t row = 0; row < (cmat)->nrow; ++row) {                                              \
         for (size_t col = 0; col < (cmat)->ncol; ++col) {                                          \
-            CMatType *val = CMat_pat(cmat, row, col);                                              \
+            __typeof__(&*(cmat)->data) val = CMat_pat(cmat, row, col);                             \
             block                                                                                  \
         }                                                                                          \
     }
@@ -146,8 +331,8 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
     CMAT_ASSERT((cmat1)->ncol == (cmat2)->ncol, "ncol don't match");                               \
     for (size_t row = 0; row < (cmat1)->nrow; ++row) {                                             \
         for (size_t col = 0; col < (cmat1)->ncol; ++col) {                                         \
-            CMatType *val1 = CMat_pat(cmat1, row, col);                                            \
-            CMatType *val2 = CMat_pat(cmat2, row, col);                                            \
+            __typeof__(&*(cmat1)->data) val1 = CMat_pat(cmat1, row, col);                          \
+            __typeof__(&*(cmat2)->data) val2 = CMat_pat(cmat2, row, col);                          \
             block                                                                                  \
         }                                                                                          \
     }
@@ -178,9 +363,9 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
     CMAT_ASSERT((cmat1)->ncol == (cmat3)->ncol, "ncol don't match");                               \
     for (size_t row = 0; row < (cmat1)->nrow; ++row) {                                             \
         for (size_t col = 0; col < (cmat1)->ncol; ++col) {                                         \
-            CMatType *val1 = CMat_pat(cmat1, row, col);                                            \
-            CMatType *val2 = CMat_pat(cmat2, row, col);                                            \
-            CMatType *val3 = CMat_pat(cmat3, row, col);                                            \
+            __typeof__(&*(cmat1)->data) val1 = CMat_pat(cmat1, row, col);                          \
+            __typeof__(&*(cmat2)->data) val2 = CMat_pat(cmat2, row, col);                          \
+            __typeof__(&*(cmat3)->data) val3 = CMat_pat(cmat3, row, col);                          \
             block                                                                                  \
         }                                                                                          \
     }
@@ -244,7 +429,7 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 /// @return a stack allocated matrix
 ///
 #define CMat_from_subarr(arr, row_start, col_start, _nrow, _ncol, _stride)                         \
-    ((CMat){.data   = (CMatType *)(arr) + (row_start) * ((col_start) + (_ncol)) + (col_start),     \
+    ((CMat){.data   = (CMatType *)(arr) + (row_start) * (_stride) + (col_start),                   \
             .nrow   = (_nrow),                                                                     \
             .ncol   = (_ncol),                                                                     \
             .stride = (_stride)})
@@ -275,7 +460,8 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 /// @return a stack allocated matrix
 ///
 #define CMat_from_sub2darr(arr, row_start, col_start, _nrow, _ncol)                                \
-    ((CMat){.data   = (CMatType *)(arr) + (row_start) * ((col_start) + (_ncol)) + (col_start),     \
+    ((CMat){.data = (CMatType *)(arr) + (row_start) * (sizeof(*(arr)) / sizeof(**(arr))) +         \
+                    (col_start),                                                                   \
             .nrow   = (_nrow),                                                                     \
             .ncol   = (_ncol),                                                                     \
             .stride = (sizeof(*(arr)) / sizeof(**(arr)))})
@@ -287,8 +473,8 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 ///
 /// example:
 /// CMatType arr[2][3] = {{1, 2, 3}, {4, 5, 6}};
-/// CMat cmat = CMat_from_subarr(arr, 0, 1, 2, 2);
-/// CMat cmat2 = CMat_from_submat(arr, 1, 0, 1, 2);
+/// CMat cmat = CMat_from_sub2darr(arr, 0, 1, 2, 2);
+/// CMat cmat2 = CMat_from_submat(&cmat, 1, 0, 1, 2);
 /// CMat_print(&cmat2);
 /// output:
 /// --   --
@@ -303,11 +489,141 @@ void CMat_init(CMat *cmat, size_t nrow, size_t ncol);
 /// @return a stack allocated matrix
 ///
 #define CMat_from_submat(cmat, row_start, col_start, _nrow, _ncol)                                 \
-    ((CMat){.data = (CMatType *)((cmat)->data) + (row_start) * ((col_start) + (cmat)->stride) +    \
-                    (col_start),                                                                   \
+    ((CMat){.data   = (CMatType *)((cmat)->data) + (row_start) * (cmat)->stride + (col_start),     \
             .nrow   = (_nrow),                                                                     \
             .ncol   = (_ncol),                                                                     \
-            .stride = (col_start + (cmat)->stride)})
+            .stride = (cmat)->stride})
+
+///
+/// @brief a view of a matrix with a stride between its rows and one between its cols, the element
+/// (row, col) is data[row * rs + col * cs]: a transposed view swap the strides, a reversed one has
+/// a negative stride and a CMat is a view with cs == 1, the views are read in place by
+/// CMatView_gemm, CMatView_copy, CMatExpr_view and CMatView_solve
+///
+///
+typedef struct {
+    CMatType *data; /// @memberof data the element (0, 0)
+    size_t    nrow; /// @memberof nrow the number of row
+    size_t    ncol; /// @memberof ncol the number of col
+    ptrdiff_t rs;   /// @memberof rs the distance between two rows
+    ptrdiff_t cs;   /// @memberof cs the distance between two cols
+} CMatView;
+///
+/// @brief get a pointer to an element of a view (O(1))
+///
+/// warning:
+/// no bound check
+///
+/// @param view the view
+/// @param row the row of the element
+/// @param col the col of the element
+///
+#define CMatView_pat(view, row, col)                                                               \
+    ((view)->data + (ptrdiff_t)(row) * (view)->rs + (ptrdiff_t)(col) * (view)->cs)
+///
+/// @brief get an element of a view (O(1)) (see CMatView_pat)
+///
+#define CMatView_at(view, row, col) (*CMatView_pat(view, row, col))
+///
+/// @brief the view of a whole matrix (O(1))
+///
+/// example:
+/// // dst = a^T . b without transposing a
+/// CMatView_gemm(&CMat_view(&dst), 1, &CMatView_transpose(&CMat_view(&a)), &CMat_view(&b), 0);
+///
+/// @param cmat the matrix
+/// @return a stack allocated view
+///
+#define CMat_view(cmat)                                                                            \
+    ((CMatView){.data = (cmat)->data,                                                              \
+                .nrow = (cmat)->nrow,                                                              \
+                .ncol = (cmat)->ncol,                                                              \
+                .rs   = (ptrdiff_t)(cmat)->stride,                                                 \
+                .cs   = 1})
+///
+/// @brief the transpose of a view (O(1))
+///
+/// @param view the view
+/// @return a stack allocated view
+///
+#define CMatView_transpose(view)                                                                   \
+    ((CMatView){.data = (view)->data,                                                              \
+                .nrow = (view)->ncol,                                                              \
+                .ncol = (view)->nrow,                                                              \
+                .rs   = (view)->cs,                                                                \
+                .cs   = (view)->rs})
+///
+/// @brief the view of a block of a view (O(1))
+///
+/// warning:
+/// no bound check
+///
+/// @param view the view
+/// @param row_start the first row of the block
+/// @param col_start the first col of the block
+/// @param _nrow the number of row of the block
+/// @param _ncol the number of col of the block
+/// @return a stack allocated view
+///
+#define CMatView_sub(view, row_start, col_start, _nrow, _ncol)                                     \
+    ((CMatView){.data = CMatView_pat(view, row_start, col_start),                                  \
+                .nrow = (_nrow),                                                                   \
+                .ncol = (_ncol),                                                                   \
+                .rs   = (view)->rs,                                                                \
+                .cs   = (view)->cs})
+///
+/// @brief a view with its rows or its cols in the reverse order (O(1))
+///
+/// @param view the view
+/// @return a stack allocated view
+///
+#define CMatView_reverse_rows(view)                                                                \
+    ((CMatView){.data = CMatView_pat(view, (view)->nrow ? (view)->nrow - 1 : 0, 0),                \
+                .nrow = (view)->nrow,                                                              \
+                .ncol = (view)->ncol,                                                              \
+                .rs   = -(view)->rs,                                                               \
+                .cs   = (view)->cs})
+#define CMatView_reverse_cols(view)                                                                \
+    ((CMatView){.data = CMatView_pat(view, 0, (view)->ncol ? (view)->ncol - 1 : 0),                \
+                .nrow = (view)->nrow,                                                              \
+                .ncol = (view)->ncol,                                                              \
+                .rs   = (view)->rs,                                                                \
+                .cs   = -(view)->cs})
+///
+/// @brief the view of every row_step row and col_step col of a view (O(1))
+///
+/// example:
+/// // the even rows of cmat
+/// CMatView even = CMatView_step(&CMat_view(&cmat), 2, 1);
+///
+/// requirement:
+/// row_step > 0 && col_step > 0
+///
+/// @param view the view
+/// @param row_step the step between two rows
+/// @param col_step the step between two cols
+/// @return a stack allocated view
+///
+#define CMatView_step(view, row_step, col_step)                                                    \
+    ((CMatView){.data = (view)->data,                                                              \
+                .nrow = ((view)->nrow + (row_step) - 1) / (row_step),                              \
+                .ncol = ((view)->ncol + (col_step) - 1) / (col_step),                              \
+                .rs   = (view)->rs * (ptrdiff_t)(row_step),                                        \
+                .cs   = (view)->cs * (ptrdiff_t)(col_step)})
+///
+/// @brief dst = src element by element between any layouts (O(n*m))
+///
+/// example:
+/// // cmat = its rows in the reverse order of src
+/// CMatView_copy(&CMat_view(&cmat), &CMatView_reverse_rows(&CMat_view(&src)));
+///
+/// requirement:
+/// dst and src have the same size and don't overlap
+///
+/// @param dst the view to write
+/// @param src the view to read
+///
+void CMatView_copy(CMatView *dst, const CMatView *src);
 
 ///
 /// @brief populate an identity matrix into dst (O(n^2))
@@ -347,7 +663,8 @@ void CMat_identity(CMat *dst);
     })
 
 ///
-/// @brief transpose a matrix (O(n*m))
+/// @brief transpose a matrix by recursively cut tiles (cache-oblivious) using SIMD block
+/// shuffles (O(n*m))
 ///
 /// example:
 /// CMatType arr[2][3] = {{1, 2, 3}, {4, 5, 6}};
@@ -365,17 +682,36 @@ void CMat_identity(CMat *dst);
 ///
 /// requirement:
 /// dst->nrow == src->ncol && dst->ncol == src->nrow
+/// dst don't overlap with src
 ///
 /// @param dst the resulted matrix
 /// @param src the matrix to transpose
 ///
-#define CMat_transpose(dst, src)                                                                   \
-    CMAT_ASSERT((dst)->nrow == (src)->ncol, "dst->nrow should be == to src->ncol");                \
-    CMAT_ASSERT((dst)->ncol == (src)->nrow, "dst->ncol should be == to src->nrow");                \
-    CMat_iterate((src), row, col, src_val, CMat_at(dst, col, row) = *src_val;);
+void CMat_transpose(CMat *dst, const CMat *src);
+///
+/// @brief transpose a square matrix in place by swapping tiles using SIMD block shuffles (O(n^2))
+///
+/// example:
+/// CMatType arr[2][2] = {{1, 2}, {3, 4}};
+/// CMat cmat = CMat_from_2darr(arr);
+/// CMat_transpose_inplace(&cmat);
+/// CMat_print(&cmat);
+/// output:
+/// --   --
+/// | 1 3 |
+/// | 2 4 |
+/// --   --
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param cmat the matrix to transpose
+///
+void CMat_transpose_inplace(CMat *cmat);
 
 ///
-/// @brief do a dot product between 2 matrix and put the result into dst (O(n*m^2))
+/// @brief do a dot product between 2 matrix and put the result into dst (O(n*m*k)) (allocate and
+/// free)
 ///
 /// example:
 /// CMatType arr1[2][3] = {{1, 2, 3}, {4, 5, 6}};
@@ -397,6 +733,7 @@ void CMat_identity(CMat *dst);
 ///
 /// requirement:
 /// cmat1->nrow == dst->nrow && cmat1->ncol == cmat2->nrow && cmat2->ncol == dst->ncol
+/// dst don't overlap with cmat1 or cmat2
 ///
 /// @param dst the resulted matrix
 /// @param cmat1 the first matrix
@@ -404,244 +741,6463 @@ void CMat_identity(CMat *dst);
 ///
 void CMat_dot(CMat *dst, const CMat *cmat1, const CMat *cmat2);
 
+// define CMAT_GEMM_MC, CMAT_GEMM_KC and CMAT_GEMM_NC before including cmat to tune the cache
+// blocking of CMat_gemm: a MC x KC block of cmat1 should fit in L2, a KC x NR sliver of cmat2 in L1
+// and a KC x NC panel of cmat2 in L3
+#ifndef CMAT_GEMM_MC
+#define CMAT_GEMM_MC 96
+#endif // CMAT_GEMM_MC
+#ifndef CMAT_GEMM_KC
+#define CMAT_GEMM_KC 256
+#endif // CMAT_GEMM_KC
+#ifndef CMAT_GEMM_NC
+#define CMAT_GEMM_NC 2048
+#endif // CMAT_GEMM_NC
+// define CMAT_GEMM_MR and CMAT_GEMM_NR before including cmat to change the register tile of the
+// scalar micro-kernel (the SIMD micro-kernels have their own tile, see CMatIsa)
+#ifndef CMAT_GEMM_MR
+#define CMAT_GEMM_MR 4
+#endif // CMAT_GEMM_MR
+#ifndef CMAT_GEMM_NR
+#define CMAT_GEMM_NR 8
+#endif // CMAT_GEMM_NR
+// define CMAT_GEMM_SMALL before including cmat to change the number of multiply-add (m*n*k) under
+// which CMat_gemm skip the packing and use a simple loop
+#ifndef CMAT_GEMM_SMALL
+#define CMAT_GEMM_SMALL (32 * 32 * 32)
+#endif // CMAT_GEMM_SMALL
+
+///
+/// @brief general matrix multiply dst = alpha * cmat1 . cmat2 + beta * dst (O(n*m*k)) (allocate
+/// and free)
+///
+/// cmat1 and cmat2 are packed into cache sized blocks (GotoBLAS/BLIS structure) and multiplied by
+/// a register tiled micro-kernel, every matrix can be a view with a stride (see CMat_from_submat)
 ///
-/// @brief cofactor of point row, col in matrix cmat (O(n!)) (allocate and free)
+/// above CMat_get_parallel_threshold() multiply-add dst is split into 2d tiles computed by the
+/// thread pool (see CMat_set_num_threads)
+///
+/// example:
+/// // dst += cmat1 . cmat2
+/// CMat_gemm(&dst, 1, &cmat1, &cmat2, 1);
 ///
 /// requirement:
-/// cmat->nrow == cmat->ncol
+/// cmat1->nrow == dst->nrow && cmat1->ncol == cmat2->nrow && cmat2->ncol == dst->ncol
+/// dst don't overlap with cmat1 or cmat2
 ///
-/// @param cmat the matrix we need to get the cofactor of
-/// @param row the row of point of the matrix we need to get the cofactor of
-/// @param col the col of point of the matrix we need to get the cofactor of
-/// @return the cofactor
+/// @param dst the resulted matrix, not read if beta == 0
+/// @param alpha the scalar multiplying cmat1 . cmat2
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
+/// @param beta the scalar multiplying dst before adding the product
 ///
-CMatType CMat_cofactor(const CMat *cmat, size_t row, size_t col);
+void CMat_gemm(CMat *dst, CMatType alpha, const CMat *cmat1, const CMat *cmat2, CMatType beta);
+///
+/// @brief dst = alpha * cmat1 . cmat2 + beta * dst on views of any layout without copy (O(n*m*k))
+/// (allocate and free)
 ///
-/// @brief determinant of matrix (Laplace expansion) (O(n!))
+/// the packing of CMat_gemm read any strides so the NN, NT, TN and TT products of BLAS are
+/// views with swapped strides, a dst with cs != 1 compute dst^T = cmat2^T . cmat1^T to write its
+/// contiguous rows
 ///
 /// example:
-/// CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
-/// CMat     cmat      = CMat_from_2darr(arr);
-/// CMatType det      = CMat_det(&cmat);
-/// printf("%lf\n", det);
-/// output:
-/// -35
+/// // dst = a . b^T
+/// CMatView_gemm(&CMat_view(&dst), 1, &CMat_view(&a), &CMatView_transpose(&CMat_view(&b)), 0);
 ///
 /// requirement:
-/// cmat->nrow == cmat->ncol
+/// cmat1->nrow == dst->nrow && cmat1->ncol == cmat2->nrow && cmat2->ncol == dst->ncol
+/// dst don't overlap with cmat1 or cmat2
 ///
-/// @param cmat the matrix we need to get the determinant of
-/// @return the determinant
+/// @param dst the resulted view, not read if beta == 0
+/// @param alpha the scalar multiplying cmat1 . cmat2
+/// @param cmat1 the first view
+/// @param cmat2 the second view
+/// @param beta the scalar multiplying dst before adding the product
 ///
-CMatType CMat_det(const CMat *cmat);
+void CMatView_gemm(CMatView *dst, CMatType alpha, const CMatView *cmat1, const CMatView *cmat2,
+                   CMatType beta);
+///
+/// @brief dst = cmat1 . cmat2 on views of any layout (O(n*m*k)) (see CMatView_gemm)
+///
+/// @param dst the resulted view
+/// @param cmat1 the first view
+/// @param cmat2 the second view
+///
+void CMatView_dot(CMatView *dst, const CMatView *cmat1, const CMatView *cmat2);
+
+// define CMAT_STRASSEN_CROSSOVER before including cmat to change the size under which
+// CMat_strassen stop its recursion and use the gemm (on a dimension of a product)
+#ifndef CMAT_STRASSEN_CROSSOVER
+#define CMAT_STRASSEN_CROSSOVER 1024
+#endif // CMAT_STRASSEN_CROSSOVER
+///
+/// @brief the number of CMatType CMat_strassen_ws need in work (O(log(n)))
+///
+/// @param m the number of row of dst
+/// @param k the number of col of cmat1
+/// @param n the number of col of dst
+/// @return about (m * max(k, n) + k * n) / 3
+///
+size_t CMat_strassen_work(size_t m, size_t k, size_t n);
+///
+/// @brief dst = cmat1 . cmat2 with the Strassen-Winograd algorithm (O(n^2.81)) (allocate and
+/// free) (see CMat_strassen_ws)
+///
+/// @param dst the resulted matrix
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
+///
+void CMat_strassen(CMat *dst, const CMat *cmat1, const CMat *cmat2);
 ///
-/// @brief adjugate of matrix (O(n!))
+/// @brief dst = cmat1 . cmat2 with the Strassen-Winograd algorithm without allocation
+/// (O(n^2.81))
+///
+/// every level split the matrices in 2 x 2 blocks multiplied with 7 products and 15 additions
+/// instead of 8 products, until a dimension is under CMAT_STRASSEN_CROSSOVER where CMat_gemm is
+/// faster, an odd last row or col is computed apart, every matrix can be a view with a stride
+///
+/// example:
+/// CMatType *work = malloc(CMat_strassen_work(n, n, n) * sizeof(*work));
+/// for (size_t i = 0; i < count; ++i) { CMat_strassen_ws(&dst[i], &a[i], &b[i], work); }
 ///
 /// requirement:
-/// src->nrow == src->ncol && dst->nrow == src->nrow && dst->ncol == src->ncol
+/// cmat1->nrow == dst->nrow && cmat1->ncol == cmat2->nrow && cmat2->ncol == dst->ncol
+/// dst don't overlap with cmat1 or cmat2
 ///
-/// @param dst the destination of the adjugate
-/// @param src the matrix to get the adjugate of
+/// warning:
+/// the error bound grows with the number of levels (|dst - cmat1 . cmat2| is about 3 times
+/// bigger every level than the one of CMat_dot, still on the order of the precision times the
+/// norms of the matrices)
 ///
-void CMat_adj(CMat *dst, const CMat *src);
+/// @param dst the resulted matrix
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
+/// @param work a buffer of CMat_strassen_work(dst->nrow, cmat1->ncol, dst->ncol) CMatType
+///
+void CMat_strassen_ws(CMat *dst, const CMat *cmat1, const CMat *cmat2, CMatType *work);
 
+// define CMAT_CHAIN_MAX before including cmat to change the maximum number of matrices of
+// CMat_chain_dot (its plan is on the stack, O(CMAT_CHAIN_MAX^2))
+#ifndef CMAT_CHAIN_MAX
+#define CMAT_CHAIN_MAX 32
+#endif // CMAT_CHAIN_MAX
 ///
-/// @brief inverse of matrix (Gaussian Jordan elemination) (O(n^3)) (allocate and free)
+/// @brief the number of CMatType CMat_chain_dot_ws need in work (O(count^3))
+///
+/// requirement:
+/// 0 < count <= CMAT_CHAIN_MAX && cmats[i].ncol == cmats[i + 1].nrow
+///
+/// @param cmats the matrices of the product
+/// @param count the number of matrices
+/// @return the sum of the sizes of the intermediate products of the cheapest order
+///
+size_t CMat_chain_work(const CMat *cmats, size_t count);
+///
+/// @brief dst = cmats[0] . cmats[1] ... cmats[count - 1] in the cheapest order (O(count^3) for
+/// the order) (allocate and free) (see CMat_chain_dot_ws)
 ///
 /// example:
-/// CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
-/// CMat     cmat      = CMat_from_2darr(arr);
+/// // dst = a . b . c . v, computed as a . (b . (c . v)) when v is a vector
+/// CMat chain[] = {a, b, c, v};
+/// CMat_chain_dot(&dst, chain, 4);
 ///
-/// if (CMat_inverse(&cmat)) {
-///     CMat_print(&cmat);
-/// } else {
-///     printf("no inverse");
-/// }
-/// output:
-/// --                    --
-/// | -5/7   2/7   0   2/7 |
-/// |    0     0   1   4/5 |
-/// |    0     0   0  -1/5 |
-/// | -1/7  -1/7   0  -1/7 |
-/// --                    --
+/// @param dst the resulted matrix
+/// @param cmats the matrices of the product
+/// @param count the number of matrices
+///
+void CMat_chain_dot(CMat *dst, const CMat *cmats, size_t count);
+///
+/// @brief dst = cmats[0] . cmats[1] ... cmats[count - 1] in the cheapest order without
+/// allocation (O(count^3) for the order)
+///
+/// the order of the products is the one with the fewest flops (dynamic programming on the sizes),
+/// every intermediate product get its own block of work so the independent ones (of the same
+/// depth in the tree of products) are computed concurrently, a product big enough for the
+/// threads of CMat_gemm is computed alone
 ///
 /// requirement:
-/// det != 0 && dst->nrow == dst->ncol
+/// 0 < count <= CMAT_CHAIN_MAX && cmats[i].ncol == cmats[i + 1].nrow
+/// dst->nrow == cmats[0].nrow && dst->ncol == cmats[count - 1].ncol
+/// dst don't overlap with the matrices of the chain
 ///
-/// @param cmat the matrix to get the inverse of and to get the result
-/// @return true if no error else false
+/// @param dst the resulted matrix
+/// @param cmats the matrices of the product
+/// @param count the number of matrices
+/// @param work a buffer of CMat_chain_work(cmats, count) CMatType
 ///
-bool CMat_inverse(CMat *cmat);
+void CMat_chain_dot_ws(CMat *dst, const CMat *cmats, size_t count, CMatType *work);
 
-#ifndef CMAT_NO_PRINT
 ///
-/// @brief print a matrix to the file f using the precision float_pres (allocate and free)
+/// @brief dst = cmat1 + cmat2 element by element (O(n*m))
 ///
-/// @param f the file to print to
-/// @param cmat the matrix to print
-/// @param float_pres the precision of the floating point value printing
+/// requirement:
+/// dst, cmat1 and cmat2 have the same size
 ///
-void CMat_fprint_pres(FILE *f, const CMat *cmat, size_t float_pres);
-#endif // CMAT_NO_PRINT
-
-// the default precision of printing of floating point value
-#define CMAT_FPRINT_DEFAULT_PRES 6
+/// @param dst the resulted matrix, can be cmat1 or cmat2
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
 ///
-/// @brief print a matrix to the file f using the precision CMAT_FPRINT_DEFAULT_PRES (allocate and
-/// free)
+void CMat_add(CMat *dst, const CMat *cmat1, const CMat *cmat2);
 ///
-/// @param f the file to print to
-/// @param cmat the matrix to print
+/// @brief dst = cmat1 - cmat2 element by element (O(n*m))
 ///
-#define CMat_fprint(f, cmat) CMat_fprint_pres(f, cmat, CMAT_FPRINT_DEFAULT_PRES)
+/// requirement:
+/// dst, cmat1 and cmat2 have the same size
 ///
-/// @brief print a matrix to stdout using the precision float_pres (allocate and free)
+/// @param dst the resulted matrix, can be cmat1 or cmat2
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
 ///
-/// @param cmat the matrix to print
-/// @param float_pres the precision of the floating point value printing
+void CMat_sub(CMat *dst, const CMat *cmat1, const CMat *cmat2);
 ///
-#define CMat_print_pres(cmat, pres) CMat_fprint_pres(stdout, cmat, pres)
+/// @brief dst = cmat1 * cmat2 element by element (Hadamard product) (O(n*m))
 ///
-/// @brief print a matrix to stdout using the precision CMAT_FPRINT_DEFAULT_PRES (allocate and free)
+/// requirement:
+/// dst, cmat1 and cmat2 have the same size
 ///
-/// @param cmat the matrix to print
+/// @param dst the resulted matrix, can be cmat1 or cmat2
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
 ///
-#define CMat_print(cmat) CMat_fprint(stdout, cmat)
-
-#endif // CMAT_H
-// #define CMAT_IMPL
-#ifdef CMAT_IMPL
-
-void CMat_init(CMat *cmat, size_t nrow, size_t ncol) {
-    cmat->data = CMAT_MALLOC(ncol * nrow, sizeof(*cmat->data));
+void CMat_mul(CMat *dst, const CMat *cmat1, const CMat *cmat2);
+///
+/// @brief dst = alpha * src (O(n*m))
+///
+/// requirement:
+/// dst and src have the same size
+///
+/// @param dst the resulted matrix, can be src
+/// @param alpha the scalar
+/// @param src the matrix to scale
+///
+void CMat_scale(CMat *dst, CMatType alpha, const CMat *src);
+///
+/// @brief dst += alpha * src (O(n*m))
+///
+/// requirement:
+/// dst and src have the same size
+///
+/// @param dst the matrix to accumulate into
+/// @param alpha the scalar
+/// @param src the matrix to add
+///
+void CMat_axpy(CMat *dst, CMatType alpha, const CMat *src);
+///
+/// @brief sum of every element of a matrix (O(n*m))
+///
+/// @param cmat the matrix to sum
+/// @return the sum
+///
+CMatType CMat_sum(const CMat *cmat);
+///
+/// @brief sum of cmat1 * cmat2 element by element (Frobenius inner product) (O(n*m))
+///
+/// requirement:
+/// cmat1 and cmat2 have the same size
+///
+/// @param cmat1 the first matrix
+/// @param cmat2 the second matrix
+/// @return the inner product
+///
+CMatType CMat_inner(const CMat *cmat1, const CMat *cmat2);
+///
+/// @brief Frobenius norm of a matrix (O(n*m))
+///
+/// @param cmat the matrix
+/// @return the square root of the sum of the square of every element
+///
+CMatType CMat_norm(const CMat *cmat);
+///
+/// @brief biggest absolute value of a matrix (O(n*m))
+///
+/// @param cmat the matrix
+/// @return max |cmat[row][col]|, 0 for an empty matrix
+///
+CMatType CMat_max_abs(const CMat *cmat);
+
+// define CMAT_EXPR_MAX_NODES before including cmat to change the biggest number of nodes of an
+// expression CMat_eval can evaluate
+#ifndef CMAT_EXPR_MAX_NODES
+#define CMAT_EXPR_MAX_NODES 32
+#endif // CMAT_EXPR_MAX_NODES
+// define CMAT_EXPR_CHUNK before including cmat to change the number of elements of every
+// intermediate result of CMat_eval (small enough for all of them to stay in the L1 cache)
+#ifndef CMAT_EXPR_CHUNK
+#define CMAT_EXPR_CHUNK 512
+#endif // CMAT_EXPR_CHUNK
+// the operation of a node of an element-wise expression
+typedef enum {
+    CMAT_EXPR_MAT,    // the elements of cmat
+    CMAT_EXPR_VIEW,   // the elements of view
+    CMAT_EXPR_SCALAR, // scalar for every element
+    CMAT_EXPR_ADD,    // lhs + rhs
+    CMAT_EXPR_SUB,    // lhs - rhs
+    CMAT_EXPR_MUL,    // lhs * rhs
+    CMAT_EXPR_SCALE,  // scalar * lhs
+} CMatExprOp;
+///
+/// @brief a node of an element-wise expression, built with the CMatExpr_* macros
+///
+///
+typedef struct CMatExpr {
+    CMatExprOp             op;     /// @memberof op the kind of the node
+    const CMat            *cmat;   /// @memberof cmat the matrix of a CMAT_EXPR_MAT
+    const CMatView        *view;   /// @memberof view the view of a CMAT_EXPR_VIEW
+    CMatType               scalar; /// @memberof scalar the scalar of a SCALAR or a SCALE node
+    const struct CMatExpr *lhs;    /// @memberof lhs the operand of an operation
+    const struct CMatExpr *rhs;    /// @memberof rhs the second operand of a binary operation
+} CMatExpr;
+///
+/// @brief the nodes of an expression, they are compound literals that live until the end of the
+/// enclosing block (no allocation)
+///
+/// example:
+/// // D = a * A + b * B - C in a single pass without temporary matrix
+/// CMat_eval(&D, CMatExpr_sub(CMatExpr_add(CMatExpr_scale(a, CMatExpr_mat(&A)),
+///                                          CMatExpr_scale(b, CMatExpr_mat(&B))),
+///                            CMatExpr_mat(&C)));
+/// // S = (A + A^T) / 2 without transposing A
+/// CMatView A_t = CMatView_transpose(&CMat_view(&A));
+/// CMat_eval(&S, CMatExpr_scale(0.5, CMatExpr_add(CMatExpr_mat(&A), CMatExpr_view(&A_t))));
+///
+#define CMatExpr_mat(_cmat) (&(const CMatExpr){.op = CMAT_EXPR_MAT, .cmat = (_cmat)})
+#define CMatExpr_view(_view) (&(const CMatExpr){.op = CMAT_EXPR_VIEW, .view = (_view)})
+#define CMatExpr_scalar(val) (&(const CMatExpr){.op = CMAT_EXPR_SCALAR, .scalar = (val)})
+#define CMatExpr_add(_lhs, _rhs)                                                                   \
+    (&(const CMatExpr){.op = CMAT_EXPR_ADD, .lhs = (_lhs), .rhs = (_rhs)})
+#define CMatExpr_sub(_lhs, _rhs)                                                                   \
+    (&(const CMatExpr){.op = CMAT_EXPR_SUB, .lhs = (_lhs), .rhs = (_rhs)})
+#define CMatExpr_mul(_lhs, _rhs)                                                                   \
+    (&(const CMatExpr){.op = CMAT_EXPR_MUL, .lhs = (_lhs), .rhs = (_rhs)})
+#define CMatExpr_scale(alpha, _lhs)                                                                \
+    (&(const CMatExpr){.op = CMAT_EXPR_SCALE, .scalar = (alpha), .lhs = (_lhs)})
+#define CMatExpr_neg(_lhs) CMatExpr_scale(-1, _lhs)
+///
+/// @brief dst = expr element by element in one pass (O(n*m*nodes)) (allocate and free)
+///
+/// every matrix of expr is read once and dst written once, the intermediate results are chunks
+/// of CMAT_EXPR_CHUNK elements computed by the element-wise kernels and kept in the L1 cache, a
+/// CMatExpr_view with cs != 1 (a transposed matrix) is gathered into a chunk
+///
+/// requirement:
+/// every matrix of expr has the size of dst, expr has at most CMAT_EXPR_MAX_NODES nodes
+///
+/// @param dst the resulted matrix, can be a matrix of expr (but not a view overlapping one)
+/// @param expr the root of the expression
+///
+void CMat_eval(CMat *dst, const CMatExpr *expr);
+
+///
+/// @brief the instruction set the kernels (dot, transpose, element-wise, reduction) use
+///
+/// define CMAT_NO_SIMD before including cmat to only have CMAT_ISA_SCALAR
+///
+///
+typedef enum {
+    CMAT_ISA_SCALAR = 0, /// portable C
+    CMAT_ISA_SSE2,       /// x86 SSE2
+    CMAT_ISA_AVX2,       /// x86 AVX2 and FMA
+    CMAT_ISA_AVX512,     /// x86 AVX-512F
+} CMatIsa;
+///
+/// @brief the best instruction set supported by the cpu (cpuid) and by the build
+///
+/// @return the best instruction set
+///
+CMatIsa CMat_isa_detect(void);
+///
+/// @brief the instruction set currently used by the kernels (the first call select
+/// CMat_isa_detect())
+///
+/// @return the instruction set in use
+///
+CMatIsa CMat_isa_get(void);
+///
+/// @brief force the instruction set used by the kernels (for testing or benchmarking)
+///
+/// warning:
+/// not thread safe, call it when no other thread use cmat
+///
+/// @param isa the wanted instruction set, lowered to CMat_isa_detect() if not supported
+/// @return the instruction set actually selected
+///
+CMatIsa CMat_isa_set(CMatIsa isa);
+///
+/// @brief the name of an instruction set ("scalar", "sse2", "avx2" or "avx512")
+///
+/// @param isa the instruction set
+/// @return a static string
+///
+const char *CMat_isa_name(CMatIsa isa);
+
+// define CMAT_NO_THREADS before including cmat to not use pthread, every kernel then run on the
+// calling thread
+//
+// define CMAT_PARALLEL_THRESHOLD before including cmat to change the default number of
+// multiply-add (m*n*k) under which CMat_gemm stay on the calling thread
+#ifndef CMAT_PARALLEL_THRESHOLD
+#define CMAT_PARALLEL_THRESHOLD (128 * 128 * 128)
+#endif // CMAT_PARALLEL_THRESHOLD
+
+///
+/// @brief set the number of threads the parallel kernels use (the calling thread included), the
+/// thread pool is created at the first parallel call and reused by every call after
+///
+/// warning:
+/// not thread safe, call it when no other thread use cmat
+///
+/// @param num_threads the number of threads, 0 for the number of cpus
+///
+void CMat_set_num_threads(size_t num_threads);
+///
+/// @brief the number of threads the parallel kernels use (the calling thread included)
+///
+/// @return the number of threads (1 if compiled with CMAT_NO_THREADS)
+///
+size_t CMat_get_num_threads(void);
+///
+/// @brief set the number of multiply-add (m*n*k) under which CMat_gemm stay on the calling thread
+/// so small products don't pay the synchronization
+///
+/// @param threshold the number of multiply-add
+///
+void CMat_set_parallel_threshold(size_t threshold);
+///
+/// @brief the number of multiply-add under which CMat_gemm stay on the calling thread
+///
+/// @return the threshold
+///
+size_t CMat_get_parallel_threshold(void);
+///
+/// @brief join the threads of the thread pool and free it (optional, the next parallel call create
+/// it again)
+///
+/// warning:
+/// not thread safe, call it when no other thread use cmat
+///
+void CMat_threads_deinit(void);
+
+// define CMAT_LU_NB before including cmat to change the width of the panels CMat_lu factorize
+// before updating the rest of the matrix with CMat_gemm
+#ifndef CMAT_LU_NB
+#define CMAT_LU_NB 64
+#endif // CMAT_LU_NB
+
+///
+/// @brief LU decomposition with partial pivoting in place: P . cmat = L . U (blocked) (O(n^3))
+///
+/// L is unit lower triangular and stored under the diagonal (its diagonal of 1 is not stored), U
+/// is upper triangular and stored on and above the diagonal, the row i was swapped with the row
+/// piv[i] at the step i (so piv[i] >= i)
+///
+/// example:
+/// CMatType arr[2][2] = {{1, 2}, {3, 4}};
+/// CMat     cmat      = CMat_from_2darr(arr);
+/// size_t   piv[2];
+/// CMat_lu(&cmat, piv);
+/// CMat_print(&cmat);
+/// output (piv = {1, 1}):
+/// --                 --
+/// | 3.000000 4.000000 |
+/// | 0.333333 0.666667 |
+/// --                 --
+///
+/// @param cmat the matrix to factorize, get L and U
+/// @param piv the pivots, should have space for min(cmat->nrow, cmat->ncol) element
+/// @return true if U have no zero on its diagonal else false (the matrix is singular, the
+/// factorization is still complete)
+///
+bool CMat_lu(CMat *cmat, size_t *piv);
+
+///
+/// @brief a LU factorization (see CMat_lu) kept to solve many systems with the same matrix
+///
+///
+typedef struct {
+    CMat    lu;       /// @memberof lu L under the diagonal and U on and above
+    size_t *piv;      /// @memberof piv the row swaps (see CMat_lu)
+    bool    singular; /// @memberof singular true if U have a zero on its diagonal
+} CMatLU;
+///
+/// @brief factorize a square matrix once so CMat_lu_solve cost O(n^2) per right hand side
+/// (O(n^3)) (allocate)
+///
+/// example:
+/// CMatLU lu;
+/// if (CMat_lu_factor(&lu, &a)) {
+///     CMat_lu_solve(&lu, &b1); // b1 = a^-1 . b1
+///     CMat_lu_solve(&lu, &b2); // b2 = a^-1 . b2
+/// }
+/// CMat_lu_deinit(&lu);
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param lu the factorization to initialize, need to be deinit with CMat_lu_deinit
+/// @param cmat the matrix to factorize (not modified)
+/// @return true if the matrix is not singular else false
+///
+bool CMat_lu_factor(CMatLU *lu, const CMat *cmat);
+///
+/// @brief free a factorization of CMat_lu_factor (O(1)) (free)
+///
+/// @param lu the factorization
+///
+void CMat_lu_deinit(CMatLU *lu);
+///
+/// @brief solve cmat . x = b in place for every column of b with the factorization of cmat
+/// (O(n^2) per column)
+///
+/// requirement:
+/// !lu->singular && b->nrow == lu->lu.nrow
+///
+/// @param lu the factorization of cmat
+/// @param b the right hand sides (one per column), get the solutions x
+///
+void CMat_lu_solve(const CMatLU *lu, CMat *b);
+///
+/// @brief solve cmat^T . x = b in place for every column of b with the factorization of cmat,
+/// the factors are read transposed (O(n^2) per column)
+///
+/// requirement:
+/// !lu->singular && b->nrow == lu->lu.nrow
+///
+/// @param lu the factorization of cmat
+/// @param b the right hand sides (one per column), get the solutions x
+///
+void CMat_lu_solve_transpose(const CMatLU *lu, CMat *b);
+///
+/// @brief refresh the factorization of cmat into the one of cmat + alpha * u . v^T (rank k
+/// update with u and v n x k, alpha = -1 for a downdate) (O(n^2*k)) (allocate and free)
+///
+/// the factors are updated column by column of u and v (Bennett) without new pivoting, so the
+/// accuracy can drift after many updates (see CMat_lu_drift)
+///
+/// requirement:
+/// !lu->singular && u->nrow == lu->lu.nrow && v->nrow == lu->lu.nrow && u->ncol == v->ncol
+///
+/// @param lu the factorization of cmat, get the one of the updated matrix
+/// @param alpha the scalar multiplying u . v^T
+/// @param u the left vectors (one per column)
+/// @param v the right vectors (one per column)
+/// @return false if a pivot of the updated factors is 0 (lu is then partially updated and marked
+/// singular, factorize the updated matrix again)
+///
+bool CMat_lu_update(CMatLU *lu, CMatType alpha, const CMat *u, const CMat *v);
+///
+/// @brief the relative residual |cmat . x - b| / |b| (max norm) of a solve of a fixed probe b
+/// with the factorization of cmat (O(n^2)) (allocate and free)
+///
+/// about the precision times the condition number right after the factorization, refactorize
+/// when it grow well above that after updates
+///
+/// @param lu the factorization of cmat
+/// @param cmat the matrix the factorization should be of
+/// @return the relative residual
+///
+CMatType CMat_lu_drift(const CMatLU *lu, const CMat *cmat);
+
+///
+/// @brief Cholesky decomposition in place: cmat = L . L^T for a symmetric positive definite
+/// matrix (blocked) (O(n^3))
+///
+/// only the lower triangle of cmat is read and L is stored in it, the upper triangle of the
+/// CMAT_LU_NB x CMAT_LU_NB blocks on the diagonal is overwritten (the rest of the upper triangle
+/// is not touched)
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param cmat the matrix to factorize, get L in its lower triangle
+/// @return true if the matrix is positive definite else false (cmat is then partially modified)
+///
+bool CMat_cholesky(CMat *cmat);
+///
+/// @brief a Cholesky factorization (see CMat_cholesky) kept to solve many systems with the same
+/// matrix
+///
+///
+typedef struct {
+    CMat l; /// @memberof l L in its lower triangle (the diagonal blocks' upper one is overwritten)
+} CMatCholesky;
+///
+/// @brief factorize a symmetric positive definite matrix once so CMat_cholesky_solve cost O(n^2)
+/// per right hand side (O(n^3)) (allocate)
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param chol the factorization to initialize, need to be deinit with CMat_cholesky_deinit
+/// @param cmat the matrix to factorize (not modified)
+/// @return true if the matrix is positive definite else false
+///
+bool CMat_cholesky_factor(CMatCholesky *chol, const CMat *cmat);
+///
+/// @brief free a factorization of CMat_cholesky_factor (O(1)) (free)
+///
+/// @param chol the factorization
+///
+void CMat_cholesky_deinit(CMatCholesky *chol);
+///
+/// @brief solve cmat . x = b in place for every column of b with the factorization of cmat
+/// (O(n^2) per column)
+///
+/// requirement:
+/// b->nrow == chol->l.nrow
+///
+/// @param chol the factorization of cmat
+/// @param b the right hand sides (one per column), get the solutions x
+///
+void CMat_cholesky_solve(const CMatCholesky *chol, CMat *b);
+///
+/// @brief refresh the factorization of cmat into the one of cmat + alpha * x . x^T (rank k
+/// update with x n x k, downdate if alpha < 0) with Givens like rotations of L (O(n^2*k))
+/// (allocate and free)
+///
+/// requirement:
+/// x->nrow == chol->l.nrow
+///
+/// @param chol the factorization of cmat, get the one of the updated matrix
+/// @param alpha the scalar multiplying x . x^T
+/// @param x the vectors (one per column)
+/// @return false if a downdate make the matrix not positive definite (chol is then partially
+/// updated, factorize the updated matrix again)
+///
+bool CMat_cholesky_update(CMatCholesky *chol, CMatType alpha, const CMat *x);
+///
+/// @brief the relative residual of a solve of a fixed probe with the factorization of cmat
+/// (O(n^2)) (allocate and free) (see CMat_lu_drift)
+///
+/// @param chol the factorization of cmat
+/// @param cmat the matrix the factorization should be of
+/// @return the relative residual
+///
+CMatType CMat_cholesky_drift(const CMatCholesky *chol, const CMat *cmat);
+
+///
+/// @brief solve cmat . x = b in place for every column of b (LU with partial pivoting) (O(n^3))
+/// (allocate and free)
+///
+/// to solve many times with the same cmat use CMat_lu_factor and CMat_lu_solve
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol && b->nrow == cmat->nrow
+///
+/// @param b the right hand sides (one per column), get the solutions x
+/// @param cmat the matrix of the system (not modified)
+/// @return true if cmat is not singular else false (b is not modified)
+///
+bool CMat_solve(CMat *b, const CMat *cmat);
+///
+/// @brief solve cmat . x = b in place for a view of any layout (O(n^3)) (allocate and free above
+/// CMAT_DET_STACK_MAX) (see CMat_solve)
+///
+/// example:
+/// // solve a^T . x = b
+/// CMatView_solve(&b, &CMatView_transpose(&CMat_view(&a)));
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol && b->nrow == cmat->nrow
+///
+/// @param b the right hand sides (one per column), get the solutions x
+/// @param cmat the view of the matrix of the system, read once into the factorization
+/// @return true if cmat is not singular else false (b is not modified)
+///
+bool CMatView_solve(CMat *b, const CMatView *cmat);
+
+// define CMAT_DET_STACK_MAX before including cmat to change the size under which CMat_det and
+// CMat_cofactor work on the stack instead of allocating
+#ifndef CMAT_DET_STACK_MAX
+#define CMAT_DET_STACK_MAX 16
+#endif // CMAT_DET_STACK_MAX
+
+///
+/// @brief cofactor of point row, col in matrix cmat (O(n^3)) (allocate and free above
+/// CMAT_DET_STACK_MAX)
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+/// row < cmat->nrow and col < cmat->ncol (so cmat isn't empty)
+///
+/// @param cmat the matrix we need to get the cofactor of
+/// @param row the row of point of the matrix we need to get the cofactor of
+/// @param col the col of point of the matrix we need to get the cofactor of
+/// @return the cofactor
+///
+CMatType CMat_cofactor(const CMat *cmat, size_t row, size_t col);
+///
+/// @brief determinant of matrix (LU decomposition with partial pivoting) (O(n^3)) (allocate and
+/// free above CMAT_DET_STACK_MAX)
+///
+/// example:
+/// CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
+/// CMat     cmat      = CMat_from_2darr(arr);
+/// CMatType det      = CMat_det(&cmat);
+/// printf("%lf\n", det);
+/// output:
+/// -35
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param cmat the matrix we need to get the determinant of
+/// @return the determinant
+///
+CMatType CMat_det(const CMat *cmat);
+// define CMAT_ADJ_RCOND_MIN before including cmat to change the reciprocal condition number (see
+// CMat_inverse_ws) under which CMat_adj use the cofactors instead of det(src) . inv(src)
+#ifndef CMAT_ADJ_RCOND_MIN
+#define CMAT_ADJ_RCOND_MIN 1e-8
+#endif // CMAT_ADJ_RCOND_MIN
+///
+/// @brief adjugate of matrix from its determinant and inverse (O(n^3)), from its cofactors if
+/// src is singular or ill conditioned (O(n^5)) (allocate and free if n > CMAT_DET_STACK_MAX)
+///
+/// requirement:
+/// src->nrow == src->ncol && dst->nrow == src->nrow && dst->ncol == src->ncol && dst != src
+///
+/// @param dst the destination of the adjugate
+/// @param src the matrix to get the adjugate of
+///
+void CMat_adj(CMat *dst, const CMat *src);
+
+///
+/// @brief inverse of matrix (LU with partial pivoting) (O(n^3)) (allocate and free if
+/// n > CMAT_DET_STACK_MAX)
+///
+/// example:
+/// CMatType arr[4][4] = {{-1, 0, 0, -2}, {1, 0, 5, -5}, {0, 1, 4, 0}, {0, 0, -5, 0}};
+/// CMat     cmat      = CMat_from_2darr(arr);
+///
+/// if (CMat_inverse(&cmat)) {
+///     CMat_print(&cmat);
+/// } else {
+///     printf("no inverse");
+/// }
+/// output:
+/// --                    --
+/// | -5/7   2/7   0   2/7 |
+/// |    0     0   1   4/5 |
+/// |    0     0   0  -1/5 |
+/// | -1/7  -1/7   0  -1/7 |
+/// --                    --
+///
+/// requirement:
+/// det != 0 && cmat->nrow == cmat->ncol
+///
+/// @param cmat the matrix to get the inverse of and to get the result
+/// @return true if no error else false
+///
+bool CMat_inverse(CMat *cmat);
+// the number of CMatType CMat_inverse_ws need in work for a n x n matrix
+#define CMAT_INVERSE_WORK(n) ((n) * ((n) < CMAT_LU_NB ? (n) : CMAT_LU_NB))
+///
+/// @brief inverse of matrix in place without allocation (blocked LU with partial pivoting then
+/// inverse of U and solve of inv(A) . L = inv(U)) (O(n^3))
+///
+/// example:
+/// size_t   piv[64];
+/// CMatType work[CMAT_INVERSE_WORK(64)];
+/// CMatType rcond;
+/// for (size_t i = 0; i < count; ++i) {
+///     if (!CMat_inverse_ws(&cmats[i], piv, work, &rcond) || rcond < 1e-12) {
+///         printf("matrix %zu is singular or ill conditioned", i);
+///     }
+/// }
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// warning:
+/// if the matrix is singular cmat hold its LU decomposition (see CMat_lu)
+///
+/// @param cmat the matrix to get the inverse of and to get the result
+/// @param piv a buffer of cmat->nrow pivots
+/// @param work a buffer of CMAT_INVERSE_WORK(cmat->nrow) CMatType
+/// @param rcond if not NULL get the reciprocal condition number 1 / (|cmat|_1 . |inv(cmat)|_1)
+/// in the 1 norm, close to 0 when cmat is ill conditioned (the inverse lose about
+/// -log10(rcond) digits) and 0 if it's singular
+/// @return true if the matrix is not singular else false
+///
+bool CMat_inverse_ws(CMat *cmat, size_t *piv, CMatType *work, CMatType *rcond);
+///
+/// @brief refresh the inverse of cmat into the one of cmat + alpha * u . v^T (rank k update with
+/// u and v n x k, alpha = -1 for a downdate) with the Sherman-Morrison-Woodbury formula
+/// (O(n^2*k)) (allocate and free)
+///
+/// inv = inv - alpha * inv . u . (I + alpha * v^T . inv . u)^-1 . v^T . inv, only a k x k
+/// matrix is factorized so it's much cheaper than CMat_inverse for k << n, the rounding errors
+/// accumulate over the updates (see CMat_inverse_drift)
+///
+/// example:
+/// // the row i of cmat become row: u is the col i of the identity and v = row - cmat[i]
+/// CMat_inverse_update(&inv, 1, &e_i, &diff);
+///
+/// requirement:
+/// inv->nrow == inv->ncol && u->nrow == inv->nrow && v->nrow == inv->nrow && u->ncol == v->ncol
+///
+/// @param inv the inverse of cmat, get the inverse of the updated matrix
+/// @param alpha the scalar multiplying u . v^T
+/// @param u the left vectors (one per column)
+/// @param v the right vectors (one per column)
+/// @return false if the updated matrix is singular (inv is then not modified)
+///
+bool CMat_inverse_update(CMat *inv, CMatType alpha, const CMat *u, const CMat *v);
+///
+/// @brief the relative residual |cmat . inv . b - b| / |b| (max norm) for a fixed probe b
+/// (O(n^2)) (allocate and free) (see CMat_lu_drift)
+///
+/// @param inv the inverse of cmat
+/// @param cmat the matrix inv should be the inverse of
+/// @return the relative residual
+///
+CMatType CMat_inverse_drift(const CMat *inv, const CMat *cmat);
+
+// define CMAT_QR_NB before including cmat to change the width of the panels of the Householder
+// reductions (CMat_qr, CMat_sym_eigen and CMat_svd) before updating the rest with gemm
+#ifndef CMAT_QR_NB
+#define CMAT_QR_NB 32
+#endif // CMAT_QR_NB
+// define CMAT_EIGEN_MAX_ITER before including cmat to change the number of QR iterations per
+// value after which CMat_sym_eigen and CMat_svd give up
+#ifndef CMAT_EIGEN_MAX_ITER
+#define CMAT_EIGEN_MAX_ITER 30
+#endif // CMAT_EIGEN_MAX_ITER
+
+///
+/// @brief the Householder QR decomposition of cmat in place (O(m*n^2)) (allocate and free)
+///
+/// cmat = Q . R with Q = H_1 ... H_k (k = min(m, n)) and H_i = I - tau[i] . v_i . v_i^T, R is
+/// stored on and above the diagonal and the v_i (with an implicit 1 on the diagonal) under it,
+/// the panels of CMAT_QR_NB cols are applied to the rest of the matrix with gemm
+///
+/// example:
+/// CMat_qr(&a, tau);
+/// CMat_qr_solve(&a, tau, &b); // least squares solution in the first a.ncol rows of b
+///
+/// @param cmat the matrix to decompose, get R and the reflectors
+/// @param tau a buffer of min(cmat->nrow, cmat->ncol) CMatType, get the scalars of the reflectors
+///
+void CMat_qr(CMat *cmat, CMatType *tau);
+///
+/// @brief b = Q . b or Q^T . b with Q the orthogonal factor of a CMat_qr (O(m*n*b->ncol))
+/// (allocate and free)
+///
+/// requirement:
+/// b->nrow == qr->nrow
+///
+/// @param qr the result of CMat_qr
+/// @param tau the scalars of the reflectors of CMat_qr
+/// @param b the matrix to multiply by Q and to get the result
+/// @param transpose true to multiply by Q^T
+///
+void CMat_qr_apply(const CMat *qr, const CMatType *tau, CMat *b, bool transpose);
+///
+/// @brief the first q->ncol cols of the orthogonal factor Q of a CMat_qr (allocate and free)
+///
+/// requirement:
+/// q->nrow == qr->nrow && q->ncol <= qr->nrow
+///
+/// @param q the matrix to get Q (q->ncol == qr->ncol for the thin Q)
+/// @param qr the result of CMat_qr
+/// @param tau the scalars of the reflectors of CMat_qr
+///
+void CMat_qr_q(CMat *q, const CMat *qr, const CMatType *tau);
+///
+/// @brief solve the least squares problem min |cmat . x - b| with a CMat_qr of cmat
+/// (allocate and free)
+///
+/// requirement:
+/// qr->nrow >= qr->ncol && b->nrow == qr->nrow
+///
+/// @param qr the result of CMat_qr
+/// @param tau the scalars of the reflectors of CMat_qr
+/// @param b the right hand sides, get x in its first qr->ncol rows and the residual in the rest
+/// (in the basis of Q)
+/// @return false if R is singular (b is then not modified)
+///
+bool CMat_qr_solve(const CMat *qr, const CMatType *tau, CMat *b);
+///
+/// @brief the eigenvalues and eigenvectors of the symmetric cmat (O(n^3)) (allocate and free)
+///
+/// cmat is reduced to a tridiagonal matrix by panels of CMAT_QR_NB cols (the rest is updated with
+/// gemm) then its eigenvalues are found by implicit QL, the whole matrix is read
+///
+/// requirement:
+/// cmat->nrow == cmat->ncol
+///
+/// @param cmat the symmetric matrix, get the eigenvectors in its cols if vectors (else destroyed)
+/// @param eig a buffer of cmat->nrow CMatType, get the eigenvalues in increasing order
+/// @param vectors true to compute the eigenvectors
+/// @return false if the iterations don't converge
+///
+bool CMat_sym_eigen(CMat *cmat, CMatType *eig, bool vectors);
+///
+/// @brief the singular value decomposition cmat = u . diag(s) . vt (O(m*n*min(m,n)))
+/// (allocate and free)
+///
+/// a QR first when cmat is far from square, then a reduction to a bidiagonal matrix by panels of
+/// CMAT_QR_NB (the rest is updated with gemm) and implicit shifted QR (Golub-Kahan)
+///
+/// requirement:
+/// with k = min(m, n): u is NULL or m x k, vt is NULL or k x n
+///
+/// @param cmat the matrix to decompose (destroyed)
+/// @param s a buffer of k CMatType, get the singular values in decreasing order
+/// @param u NULL or get the left singular vectors in its cols
+/// @param vt NULL or get the right singular vectors in its rows
+/// @return false if the iterations don't converge
+///
+bool CMat_svd(CMat *cmat, CMatType *s, CMat *u, CMat *vt);
+
+// closed form determinant of the 1x1 to 4x4 row-major matrix a (an array of CMatType or of
+// vectors), CMAT_MINOR2 is the 2x2 minor of the rows r0, r1 and the cols c0, c1 of a n x n matrix
+#define CMAT_MINOR2(a, n, r0, r1, c0, c1)                                                          \
+    ((a)[(r0) * (n) + (c0)] * (a)[(r1) * (n) + (c1)] -                                             \
+     (a)[(r0) * (n) + (c1)] * (a)[(r1) * (n) + (c0)])
+#define CMAT_DET1(a) ((a)[0])
+#define CMAT_DET2(a) CMAT_MINOR2(a, 2, 0, 1, 0, 1)
+#define CMAT_DET3(a)                                                                               \
+    ((a)[0] * CMAT_MINOR2(a, 3, 1, 2, 1, 2) - (a)[1] * CMAT_MINOR2(a, 3, 1, 2, 0, 2) +             \
+     (a)[2] * CMAT_MINOR2(a, 3, 1, 2, 0, 1))
+#define CMAT_DET4(a)                                                                               \
+    (CMAT_MINOR2(a, 4, 0, 1, 0, 1) * CMAT_MINOR2(a, 4, 2, 3, 2, 3) -                               \
+     CMAT_MINOR2(a, 4, 0, 1, 0, 2) * CMAT_MINOR2(a, 4, 2, 3, 1, 3) +                               \
+     CMAT_MINOR2(a, 4, 0, 1, 0, 3) * CMAT_MINOR2(a, 4, 2, 3, 1, 2) +                               \
+     CMAT_MINOR2(a, 4, 0, 1, 1, 2) * CMAT_MINOR2(a, 4, 2, 3, 0, 3) -                               \
+     CMAT_MINOR2(a, 4, 0, 1, 1, 3) * CMAT_MINOR2(a, 4, 2, 3, 0, 2) +                               \
+     CMAT_MINOR2(a, 4, 0, 1, 2, 3) * CMAT_MINOR2(a, 4, 2, 3, 0, 1))
+// inverse (the transposed cofactors divided by det) and determinant of the 1x1 to 4x4 row-major
+// matrix a, T is the type of the elements (CMatType or a vector of them) and inv must not be a
+// or overlap it since a is still read after the first elements of inv are written
+#define CMAT_INVERSE1(T, inv, a, det)                                                              \
+    do {                                                                                           \
+        (det)    = CMAT_DET1(a);                                                                   \
+        (inv)[0] = 1 / (det);                                                                      \
+    } while (0)
+#define CMAT_INVERSE2(T, inv, a, det)                                                              \
+    do {                                                                                           \
+        (det)    = CMAT_DET2(a);                                                                   \
+        T r_     = 1 / (det);                                                                      \
+        (inv)[0] = (a)[3] * r_;                                                                    \
+        (inv)[1] = -(a)[1] * r_;                                                                   \
+        (inv)[2] = -(a)[2] * r_;                                                                   \
+        (inv)[3] = (a)[0] * r_;                                                                    \
+    } while (0)
+#define CMAT_INVERSE3(T, inv, a, det)                                                              \
+    do {                                                                                           \
+        T c0_    = CMAT_MINOR2(a, 3, 1, 2, 1, 2);                                                  \
+        T c1_    = -CMAT_MINOR2(a, 3, 1, 2, 0, 2);                                                 \
+        T c2_    = CMAT_MINOR2(a, 3, 1, 2, 0, 1);                                                  \
+        (det)    = (a)[0] * c0_ + (a)[1] * c1_ + (a)[2] * c2_;                                     \
+        T r_     = 1 / (det);                                                                      \
+        (inv)[0] = c0_ * r_;                                                                       \
+        (inv)[1] = -CMAT_MINOR2(a, 3, 0, 2, 1, 2) * r_;                                            \
+        (inv)[2] = CMAT_MINOR2(a, 3, 0, 1, 1, 2) * r_;                                             \
+        (inv)[3] = c1_ * r_;                                                                       \
+        (inv)[4] = CMAT_MINOR2(a, 3, 0, 2, 0, 2) * r_;                                             \
+        (inv)[5] = -CMAT_MINOR2(a, 3, 0, 1, 0, 2) * r_;                                            \
+        (inv)[6] = c2_ * r_;                                                                       \
+        (inv)[7] = -CMAT_MINOR2(a, 3, 0, 2, 0, 1) * r_;                                            \
+        (inv)[8] = CMAT_MINOR2(a, 3, 0, 1, 0, 1) * r_;                                             \
+    } while (0)
+#define CMAT_INVERSE4(T, inv, a, det)                                                              \
+    do {                                                                                           \
+        T s0_ = CMAT_MINOR2(a, 4, 0, 1, 0, 1);                                                     \
+        T s1_ = CMAT_MINOR2(a, 4, 0, 1, 0, 2);                                                     \
+        T s2_ = CMAT_MINOR2(a, 4, 0, 1, 0, 3);                                                     \
+        T s3_ = CMAT_MINOR2(a, 4, 0, 1, 1, 2);                                                     \
+        T s4_ = CMAT_MINOR2(a, 4, 0, 1, 1, 3);                                                     \
+        T s5_ = CMAT_MINOR2(a, 4, 0, 1, 2, 3);                                                     \
+        T c0_ = CMAT_MINOR2(a, 4, 2, 3, 0, 1);                                                     \
+        T c1_ = CMAT_MINOR2(a, 4, 2, 3, 0, 2);                                                     \
+        T c2_ = CMAT_MINOR2(a, 4, 2, 3, 0, 3);                                                     \
+        T c3_ = CMAT_MINOR2(a, 4, 2, 3, 1, 2);                                                     \
+        T c4_ = CMAT_MINOR2(a, 4, 2, 3, 1, 3);                                                     \
+        T c5_ = CMAT_MINOR2(a, 4, 2, 3, 2, 3);                                                     \
+        (det) = s0_ * c5_ - s1_ * c4_ + s2_ * c3_ + s3_ * c2_ - s4_ * c1_ + s5_ * c0_;             \
+        T r_  = 1 / (det);                                                                         \
+        (inv)[0]  = ((a)[5] * c5_ - (a)[6] * c4_ + (a)[7] * c3_) * r_;                             \
+        (inv)[1]  = (-(a)[1] * c5_ + (a)[2] * c4_ - (a)[3] * c3_) * r_;                            \
+        (inv)[2]  = ((a)[13] * s5_ - (a)[14] * s4_ + (a)[15] * s3_) * r_;                          \
+        (inv)[3]  = (-(a)[9] * s5_ + (a)[10] * s4_ - (a)[11] * s3_) * r_;                          \
+        (inv)[4]  = (-(a)[4] * c5_ + (a)[6] * c2_ - (a)[7] * c1_) * r_;                            \
+        (inv)[5]  = ((a)[0] * c5_ - (a)[2] * c2_ + (a)[3] * c1_) * r_;                             \
+        (inv)[6]  = (-(a)[12] * s5_ + (a)[14] * s2_ - (a)[15] * s1_) * r_;                         \
+        (inv)[7]  = ((a)[8] * s5_ - (a)[10] * s2_ + (a)[11] * s1_) * r_;                           \
+        (inv)[8]  = ((a)[4] * c4_ - (a)[5] * c2_ + (a)[7] * c0_) * r_;                             \
+        (inv)[9]  = (-(a)[0] * c4_ + (a)[1] * c2_ - (a)[3] * c0_) * r_;                            \
+        (inv)[10] = ((a)[12] * s4_ - (a)[13] * s2_ + (a)[15] * s0_) * r_;                          \
+        (inv)[11] = (-(a)[8] * s4_ + (a)[9] * s2_ - (a)[11] * s0_) * r_;                           \
+        (inv)[12] = (-(a)[4] * c3_ + (a)[5] * c1_ - (a)[6] * c0_) * r_;                            \
+        (inv)[13] = ((a)[0] * c3_ - (a)[1] * c1_ + (a)[2] * c0_) * r_;                             \
+        (inv)[14] = (-(a)[12] * s3_ + (a)[13] * s1_ - (a)[14] * s0_) * r_;                         \
+        (inv)[15] = ((a)[8] * s3_ - (a)[9] * s1_ + (a)[10] * s0_) * r_;                            \
+    } while (0)
+
+// matrices of a size known at compile time that live on the stack (no nrow, ncol or stride), the
+// static inline functions are unrolled so the compiler can keep the whole matrix in registers,
+// dst can be a source of every function
+//
+// example:
+// CMat4x4 transform = {{{1, 0, 0, 1}, {0, 1, 0, 2}, {0, 0, 1, 3}, {0, 0, 0, 1}}};
+// CMat4x1 point     = {{{1}, {1}, {1}, {1}}};
+// CMat4x4_dot4x1(&point, &transform, &point);
+// CMat4x4_inverse(&transform, &transform);
+//
+// CMatRxC with the element wise CMatRxC_add, _sub, _scale and the sum of products _inner
+#define CMAT_DEFINE_FIXED(R, C)                                                                    \
+    typedef struct {                                                                               \
+        CMatType data[R][C];                                                                       \
+    } CMat##R##x##C;                                                                               \
+    static inline void CMat##R##x##C##_add(CMat##R##x##C *dst, const CMat##R##x##C *cmat1,         \
+                                           const CMat##R##x##C *cmat2) {                           \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < R; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < C; ++col) {                         \
+                dst->data[row][col] = cmat1->data[row][col] + cmat2->data[row][col];               \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static inline void CMat##R##x##C##_sub(CMat##R##x##C *dst, const CMat##R##x##C *cmat1,         \
+                                           const CMat##R##x##C *cmat2) {                           \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < R; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < C; ++col) {                         \
+                dst->data[row][col] = cmat1->data[row][col] - cmat2->data[row][col];               \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static inline void CMat##R##x##C##_scale(CMat##R##x##C *dst, CMatType alpha,                   \
+                                             const CMat##R##x##C *src) {                           \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < R; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < C; ++col) {                         \
+                dst->data[row][col] = alpha * src->data[row][col];                                 \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static inline CMatType CMat##R##x##C##_inner(const CMat##R##x##C *cmat1,                       \
+                                                 const CMat##R##x##C *cmat2) {                     \
+        CMatType sum = 0;                                                                          \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < R; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < C; ++col) {                         \
+                sum += cmat1->data[row][col] * cmat2->data[row][col];                              \
+            }                                                                                      \
+        }                                                                                          \
+        return sum;                                                                                \
+    }
+// the square CMatNxN with CMatNxN_identity, _transpose, _det and _inverse (closed form with the
+// cofactors, false if the matrix is singular and dst is unchanged)
+#define CMAT_DEFINE_FIXED_SQUARE(N)                                                                \
+    static inline void CMat##N##x##N##_identity(CMat##N##x##N *dst) {                              \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < N; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < N; ++col) {                         \
+                dst->data[row][col] = row == col;                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static inline void CMat##N##x##N##_transpose(CMat##N##x##N *dst, const CMat##N##x##N *src) {   \
+        CMat##N##x##N res;                                                                         \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < N; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < N; ++col) {                         \
+                res.data[col][row] = src->data[row][col];                                          \
+            }                                                                                      \
+        }                                                                                          \
+        *dst = res;                                                                                \
+    }                                                                                              \
+    static inline CMatType CMat##N##x##N##_det(const CMat##N##x##N *cmat) {                        \
+        const CMatType *a = &cmat->data[0][0];                                                     \
+        return CMAT_DET##N(a);                                                                     \
+    }                                                                                              \
+    static inline bool CMat##N##x##N##_inverse(CMat##N##x##N *dst, const CMat##N##x##N *src) {     \
+        const CMatType *a = &src->data[0][0];                                                      \
+        CMat##N##x##N   res;                                                                       \
+        CMatType        det;                                                                       \
+        CMAT_INVERSE##N(CMatType, &res.data[0][0], a, det);                                        \
+        if (det == 0) { return false; }                                                            \
+        *dst = res;                                                                                \
+        return true;                                                                               \
+    }
+// the product CMatMxK_name of a CMatMxK by a CMatKxN into a CMatMxN
+#define CMAT_DEFINE_FIXED_DOT(M, K, N, name)                                                       \
+    static inline void CMat##M##x##K##_##name(CMat##M##x##N *dst, const CMat##M##x##K *cmat1,      \
+                                              const CMat##K##x##N *cmat2) {                        \
+        CMat##M##x##N res;                                                                         \
+        _Pragma("GCC unroll 4") for (size_t row = 0; row < M; ++row) {                             \
+            _Pragma("GCC unroll 4") for (size_t col = 0; col < N; ++col) {                         \
+                CMatType sum = cmat1->data[row][0] * cmat2->data[0][col];                          \
+                _Pragma("GCC unroll 4") for (size_t p = 1; p < K; ++p) {                           \
+                    sum += cmat1->data[row][p] * cmat2->data[p][col];                              \
+                }                                                                                  \
+                res.data[row][col] = sum;                                                          \
+            }                                                                                      \
+        }                                                                                          \
+        *dst = res;                                                                                \
+    }
+
+CMAT_DEFINE_FIXED(2, 2)
+CMAT_DEFINE_FIXED(3, 3)
+CMAT_DEFINE_FIXED(4, 4)
+CMAT_DEFINE_FIXED(2, 1)
+CMAT_DEFINE_FIXED(3, 1)
+CMAT_DEFINE_FIXED(4, 1)
+CMAT_DEFINE_FIXED_SQUARE(2)
+CMAT_DEFINE_FIXED_SQUARE(3)
+CMAT_DEFINE_FIXED_SQUARE(4)
+CMAT_DEFINE_FIXED_DOT(2, 2, 2, dot)
+CMAT_DEFINE_FIXED_DOT(3, 3, 3, dot)
+CMAT_DEFINE_FIXED_DOT(4, 4, 4, dot)
+CMAT_DEFINE_FIXED_DOT(2, 2, 1, dot2x1)
+CMAT_DEFINE_FIXED_DOT(3, 3, 1, dot3x1)
+CMAT_DEFINE_FIXED_DOT(4, 4, 1, dot4x1)
+
+///
+/// @brief create a matrix from a fixed size matrix without heap allocating (O(1))
+///
+/// example:
+/// CMat3x3 fixed = {{{1, 2, 3}, {4, 5, 6}, {7, 8, 10}}};
+/// CMat    cmat  = CMat_from_fixed(&fixed);
+/// CMat_print(&cmat);
+///
+/// @param fixed a pointer to the fixed size matrix (CMat3x3, CMat4x1, ...)
+/// @return a stack allocated matrix that share the data of fixed
+///
+#define CMat_from_fixed(fixed) CMat_from_2darr((fixed)->data)
+
+// the max number of rows and cols of the matrices of a CMatBatch
+#define CMAT_BATCH_MAX 4
+///
+/// @brief count matrices of the same shape stored by element (structure of arrays) so a vector of
+/// the batch kernels hold the same element of consecutive matrices, the element (row, col) of the
+/// matrix idx is at data[(row * ncol + col) * stride + idx]
+///
+///
+typedef struct {
+    CMatType *data;   /// @memberof data the nrow * ncol * stride elements
+    size_t    nrow;   /// @memberof nrow the rows of each matrix
+    size_t    ncol;   /// @memberof ncol the cols of each matrix
+    size_t    count;  /// @memberof count the number of matrices
+    size_t    stride; /// @memberof stride the step between elements (a multiple of 8 >= count)
+} CMatBatch;
+///
+/// @brief init a batch of count nrow x ncol matrices, the elements are aligned on CMAT_ALIGN
+/// bytes and initialized to 0 (allocate)
+///
+/// requirement:
+/// nrow <= CMAT_BATCH_MAX && ncol <= CMAT_BATCH_MAX
+///
+/// @param batch the batch to init
+/// @param nrow the rows of each matrix
+/// @param ncol the cols of each matrix
+/// @param count the number of matrices
+///
+void CMatBatch_init(CMatBatch *batch, size_t nrow, size_t ncol, size_t count);
+///
+/// @brief deinit a batch of CMatBatch_init (free)
+///
+/// @param batch the batch to deinit
+///
+void CMatBatch_deinit(CMatBatch *batch);
+///
+/// @brief get the element (row, col) of the matrix idx of a batch
+///
+/// @param batch the batch to get the element from
+/// @param idx the index of the matrix
+/// @param row the row of the element
+/// @param col the col of the element
+/// @return the element
+///
+#define CMatBatch_at(batch, idx, row, col)                                                         \
+    ((batch)->data[((row) * (batch)->ncol + (col)) * (batch)->stride + (idx)])
+///
+/// @brief copy a matrix in the matrix idx of a batch (O(n^2))
+///
+/// requirement:
+/// idx < batch->count && src->nrow == batch->nrow && src->ncol == batch->ncol
+///
+/// @param batch the batch to copy to
+/// @param idx the index of the matrix
+/// @param src the matrix to copy
+///
+void CMatBatch_set(CMatBatch *batch, size_t idx, const CMat *src);
+///
+/// @brief copy the matrix idx of a batch in a matrix (O(n^2))
+///
+/// requirement:
+/// idx < batch->count && dst->nrow == batch->nrow && dst->ncol == batch->ncol
+///
+/// @param dst the matrix to get the copy
+/// @param batch the batch to copy from
+/// @param idx the index of the matrix
+///
+void CMatBatch_get(CMat *dst, const CMatBatch *batch, size_t idx);
+///
+/// @brief matrix product of every matrix of 2 batches (unrolled for 2x2, 3x3 and 4x4) (O(count))
+///
+/// example:
+/// CMatBatch a, b, c;
+/// CMatBatch_init(&a, 4, 4, count); // the transforms
+/// CMatBatch_init(&b, 4, 1, count); // the points
+/// CMatBatch_init(&c, 4, 1, count);
+/// ...
+/// CMatBatch_dot(&c, &a, &b); // c[i] = a[i] . b[i]
+///
+/// requirement:
+/// cmat1->count == cmat2->count && dst->count == cmat1->count && cmat1->ncol == cmat2->nrow &&
+/// dst->nrow == cmat1->nrow && dst->ncol == cmat2->ncol && (dst is cmat1 or cmat2 or dst don't
+/// overlap them)
+///
+/// @param dst the batch to get the result
+/// @param cmat1 the batch of the left matrices
+/// @param cmat2 the batch of the right matrices
+///
+void CMatBatch_dot(CMatBatch *dst, const CMatBatch *cmat1, const CMatBatch *cmat2);
+///
+/// @brief determinant of every matrix of a batch (closed form) (O(count))
+///
+/// requirement:
+/// batch->nrow == batch->ncol
+///
+/// @param det an array of batch->count CMatType to get the determinants
+/// @param batch the batch of matrices
+///
+void CMatBatch_det(CMatType *det, const CMatBatch *batch);
+///
+/// @brief inverse of every matrix of a batch (closed form with the cofactors) (O(count))
+///
+/// requirement:
+/// src->nrow == src->ncol && dst->nrow == src->nrow && dst->ncol == src->ncol &&
+/// dst->count == src->count && (dst == src or dst don't overlap src)
+///
+/// warning:
+/// the inverse of a singular matrix is not finite (inf or nan)
+///
+/// @param dst the batch to get the inverses
+/// @param src the batch of matrices
+/// @param det if not NULL an array of src->count CMatType to get the determinants
+/// @return the number of singular matrices (det == 0)
+///
+size_t CMatBatch_inverse(CMatBatch *dst, const CMatBatch *src, CMatType *det);
+
+// define CMAT_SPARSE_INDEX before including cmat to change the type of the row and col indices of
+// the sparse matrices (the products read an index per non zero, a smaller one read less memory)
+#ifndef CMAT_SPARSE_INDEX
+#define CMAT_SPARSE_INDEX uint32_t
+#endif // CMAT_SPARSE_INDEX
+typedef CMAT_SPARSE_INDEX CMatIndex;
+///
+/// @brief a sparse matrix of coordinates (COO): the nnz non zeros in any order, the duplicates are
+/// summed, to build a matrix before converting it to CSR or CSC
+///
+///
+typedef struct {
+    CMatType  *values;   /// @memberof values the nnz values
+    CMatIndex *row_idx;  /// @memberof row_idx the nnz rows
+    CMatIndex *col_idx;  /// @memberof col_idx the nnz cols
+    size_t     nrow;     /// @memberof nrow the number of row
+    size_t     ncol;     /// @memberof ncol the number of col
+    size_t     nnz;      /// @memberof nnz the number of non zeros
+    size_t     capacity; /// @memberof capacity the number of non zeros the arrays can hold
+} CMatCoo;
+///
+/// @brief a sparse matrix of compressed sparse rows (CSR): the non zeros of the row i are
+/// values[row_ptr[i], row_ptr[i + 1]) in the cols col_idx[row_ptr[i], row_ptr[i + 1]) (increasing)
+///
+///
+typedef struct {
+    CMatType  *values;  /// @memberof values the nnz values
+    CMatIndex *col_idx; /// @memberof col_idx the nnz cols
+    size_t    *row_ptr; /// @memberof row_ptr the nrow + 1 offsets of the rows in values and col_idx
+    size_t     nrow;    /// @memberof nrow the number of row
+    size_t     ncol;    /// @memberof ncol the number of col
+    size_t     nnz;     /// @memberof nnz the number of non zeros
+} CMatCsr;
+///
+/// @brief a sparse matrix of compressed sparse cols (CSC): the non zeros of the col j are
+/// values[col_ptr[j], col_ptr[j + 1]) in the rows row_idx[col_ptr[j], col_ptr[j + 1]) (increasing)
+///
+///
+typedef struct {
+    CMatType  *values;  /// @memberof values the nnz values
+    CMatIndex *row_idx; /// @memberof row_idx the nnz rows
+    size_t    *col_ptr; /// @memberof col_ptr the ncol + 1 offsets of the cols in values and row_idx
+    size_t     nrow;    /// @memberof nrow the number of row
+    size_t     ncol;    /// @memberof ncol the number of col
+    size_t     nnz;     /// @memberof nnz the number of non zeros
+} CMatCsc;
+///
+/// @brief init an empty COO matrix (O(1)) (allocate)
+///
+/// example:
+/// CMatCoo coo;
+/// CMatCoo_init(&coo, 1000, 1000, 0);
+/// for (size_t i = 0; i < 1000; ++i) {
+///     CMatCoo_push(&coo, i, i, 2);
+///     if (i > 0) { CMatCoo_push(&coo, i, i - 1, -1); }
+/// }
+/// CMatCsr csr;
+/// CMatCsr_from_coo(&csr, &coo);
+/// CMatCoo_deinit(&coo);
+///
+/// @param coo the matrix to init
+/// @param nrow the number of row
+/// @param ncol the number of col
+/// @param capacity the number of non zeros to allocate for (it grow when needed)
+///
+void CMatCoo_init(CMatCoo *coo, size_t nrow, size_t ncol, size_t capacity);
+///
+/// @brief deinit a COO matrix (free)
+///
+/// @param coo the matrix to deinit
+///
+void CMatCoo_deinit(CMatCoo *coo);
+///
+/// @brief add a non zero to a COO matrix (amortized O(1)) (allocate when full)
+///
+/// @param coo the matrix
+/// @param row the row of the value
+/// @param col the col of the value
+/// @param val the value (summed with the other values at the same position)
+///
+void CMatCoo_push(CMatCoo *coo, size_t row, size_t col, CMatType val);
+///
+/// @brief init a COO matrix with the non zeros of a dense one (O(n*m)) (allocate)
+///
+/// @param coo the matrix to init
+/// @param src the dense matrix
+///
+void CMatCoo_from_dense(CMatCoo *coo, const CMat *src);
+///
+/// @brief dst = the dense matrix of a COO matrix (O(n*m + nnz))
+///
+/// requirement:
+/// dst has the size of coo
+///
+/// @param dst the dense matrix
+/// @param coo the sparse matrix
+///
+void CMatCoo_to_dense(CMat *dst, const CMatCoo *coo);
+///
+/// @brief init a CSR matrix from a COO one, the duplicates are summed (O(nnz + n + m))
+/// (allocate)
+///
+/// @param csr the matrix to init
+/// @param coo the COO matrix
+///
+void CMatCsr_from_coo(CMatCsr *csr, const CMatCoo *coo);
+///
+/// @brief init a CSR matrix with the non zeros of a dense one (O(n*m)) (allocate)
+///
+/// @param csr the matrix to init
+/// @param src the dense matrix
+///
+void CMatCsr_from_dense(CMatCsr *csr, const CMat *src);
+///
+/// @brief init a CSR matrix from a CSC one (O(nnz + n + m)) (allocate)
+///
+/// @param csr the matrix to init
+/// @param csc the CSC matrix
+///
+void CMatCsr_from_csc(CMatCsr *csr, const CMatCsc *csc);
+///
+/// @brief dst = the dense matrix of a CSR matrix (O(n*m + nnz))
+///
+/// requirement:
+/// dst has the size of csr
+///
+/// @param dst the dense matrix
+/// @param csr the sparse matrix
+///
+void CMatCsr_to_dense(CMat *dst, const CMatCsr *csr);
+///
+/// @brief deinit a CSR matrix (free)
+///
+/// @param csr the matrix to deinit
+///
+void CMatCsr_deinit(CMatCsr *csr);
+///
+/// @brief dst = alpha * a . b + beta * dst with a sparse (O(nnz * b->ncol)), the rows of dst are
+/// split between the threads with the same number of non zeros (see CMat_set_num_threads), b of 1
+/// col is a sparse matrix vector product (SpMV)
+///
+/// example:
+/// CMat x, y;
+/// CMat_init(&x, csr.ncol, 1);
+/// CMat_init(&y, csr.nrow, 1);
+/// CMatCsr_gemm(&y, 1, &csr, &x, 0);
+///
+/// requirement:
+/// a->ncol == b->nrow && dst->nrow == a->nrow && dst->ncol == b->ncol
+/// dst is not b
+///
+/// @param dst the result
+/// @param alpha the scalar of the product
+/// @param a the sparse matrix
+/// @param b the dense matrix
+/// @param beta the scalar of dst, if 0 dst is not read (NaN are not propagated)
+///
+void CMatCsr_gemm(CMat *dst, CMatType alpha, const CMatCsr *a, const CMat *b, CMatType beta);
+///
+/// @brief dst = a . b with a sparse (O(nnz * b->ncol)) (see CMatCsr_gemm)
+///
+/// @param dst the result
+/// @param a the sparse matrix
+/// @param b the dense matrix
+///
+void CMatCsr_dot(CMat *dst, const CMatCsr *a, const CMat *b);
+///
+/// @brief init a CSC matrix from a COO one, the duplicates are summed (O(nnz + n + m))
+/// (allocate)
+///
+/// @param csc the matrix to init
+/// @param coo the COO matrix
+///
+void CMatCsc_from_coo(CMatCsc *csc, const CMatCoo *coo);
+///
+/// @brief init a CSC matrix with the non zeros of a dense one (O(n*m)) (allocate)
+///
+/// @param csc the matrix to init
+/// @param src the dense matrix
+///
+void CMatCsc_from_dense(CMatCsc *csc, const CMat *src);
+///
+/// @brief init a CSC matrix from a CSR one (O(nnz + n + m)) (allocate)
+///
+/// @param csc the matrix to init
+/// @param csr the CSR matrix
+///
+void CMatCsc_from_csr(CMatCsc *csc, const CMatCsr *csr);
+///
+/// @brief dst = the dense matrix of a CSC matrix (O(n*m + nnz))
+///
+/// requirement:
+/// dst has the size of csc
+///
+/// @param dst the dense matrix
+/// @param csc the sparse matrix
+///
+void CMatCsc_to_dense(CMat *dst, const CMatCsc *csc);
+///
+/// @brief deinit a CSC matrix (free)
+///
+/// @param csc the matrix to deinit
+///
+void CMatCsc_deinit(CMatCsc *csc);
+///
+/// @brief dst = alpha * a . b + beta * dst with a sparse (O(nnz * b->ncol)), every col of a is
+/// added to the rows of dst so the cols of dst are split between the threads and a b of 1 col
+/// stay on the calling thread (a CSR matrix is faster for a SpMV)
+///
+/// requirement:
+/// a->ncol == b->nrow && dst->nrow == a->nrow && dst->ncol == b->ncol
+/// dst is not b
+///
+/// @param dst the result
+/// @param alpha the scalar of the product
+/// @param a the sparse matrix
+/// @param b the dense matrix
+/// @param beta the scalar of dst, if 0 dst is not read (NaN are not propagated)
+///
+void CMatCsc_gemm(CMat *dst, CMatType alpha, const CMatCsc *a, const CMat *b, CMatType beta);
+///
+/// @brief dst = a . b with a sparse (O(nnz * b->ncol)) (see CMatCsc_gemm)
+///
+/// @param dst the result
+/// @param a the sparse matrix
+/// @param b the dense matrix
+///
+void CMatCsc_dot(CMat *dst, const CMatCsc *a, const CMat *b);
+
+///
+/// @brief a diagonal matrix: the n elements of the diagonal
+///
+///
+typedef struct {
+    CMatType *data; /// @memberof data the n elements of the diagonal
+    size_t    n;    /// @memberof n the number of row and col
+} CMatDiag;
+///
+/// @brief a packed triangular matrix: only the n * (n + 1) / 2 elements of the triangle are stored
+/// row after row (the row i of an upper one is its cols i to n - 1, of a lower one its cols 0 to i)
+///
+///
+typedef struct {
+    CMatType *data;  /// @memberof data the n * (n + 1) / 2 elements of the triangle
+    size_t    n;     /// @memberof n the number of row and col
+    bool      upper; /// @memberof upper true if the elements under the diagonal are 0
+} CMatTri;
+///
+/// @brief a banded matrix: the row i only has the kl + ku + 1 elements of the cols i - kl to
+/// i + ku, stored row after row (the elements of the cols out of the matrix are not used)
+///
+///
+typedef struct {
+    CMatType *data; /// @memberof data the nrow * (kl + ku + 1) elements of the band
+    size_t    nrow; /// @memberof nrow the number of row
+    size_t    ncol; /// @memberof ncol the number of col
+    size_t    kl;   /// @memberof kl the number of diagonals under the diagonal
+    size_t    ku;   /// @memberof ku the number of diagonals above the diagonal
+} CMatBand;
+///
+/// @brief a packed symmetric matrix: only the n * (n + 1) / 2 elements of the lower triangle are
+/// stored row after row (the row i is its cols 0 to i)
+///
+///
+typedef struct {
+    CMatType *data; /// @memberof data the n * (n + 1) / 2 elements of the lower triangle
+    size_t    n;    /// @memberof n the number of row and col
+} CMatSym;
+
+///
+/// @brief init a n x n diagonal matrix (O(1)) (allocate)
+///
+/// @param diag the matrix to init
+/// @param n the number of row and col
+///
+void CMatDiag_init(CMatDiag *diag, size_t n);
+///
+/// @brief deinit a diagonal matrix (free)
+///
+/// @param diag the matrix to deinit
+///
+#define CMatDiag_deinit(diag) (CMAT_FREE((diag)->data))
+///
+/// @brief init a diagonal matrix with the diagonal of a square dense one (O(n)) (allocate)
+///
+/// @param diag the matrix to init
+/// @param src the dense matrix
+///
+void CMatDiag_from_dense(CMatDiag *diag, const CMat *src);
+///
+/// @brief dst = the dense matrix of a diagonal matrix (O(n^2))
+///
+/// requirement:
+/// dst->nrow == dst->ncol == diag->n
+///
+/// @param dst the dense matrix
+/// @param diag the diagonal matrix
+///
+void CMatDiag_to_dense(CMat *dst, const CMatDiag *diag);
+///
+/// @brief dst = diag . b, scale every row of b (O(n*m))
+///
+/// requirement:
+/// b->nrow == diag->n && dst has the size of b
+///
+/// @param dst the result, can be b
+/// @param diag the diagonal matrix
+/// @param b the dense matrix
+///
+void CMatDiag_dot(CMat *dst, const CMatDiag *diag, const CMat *b);
+///
+/// @brief dst = b . diag, scale every col of b (O(n*m))
+///
+/// requirement:
+/// b->ncol == diag->n && dst has the size of b
+///
+/// @param dst the result, can be b
+/// @param b the dense matrix
+/// @param diag the diagonal matrix
+///
+void CMatDiag_dot_right(CMat *dst, const CMat *b, const CMatDiag *diag);
+///
+/// @brief inverse a diagonal matrix in place (O(n))
+///
+/// @param diag the matrix to inverse
+/// @return false if an element of the diagonal is 0 (diag is not modified)
+///
+bool CMatDiag_inverse(CMatDiag *diag);
+///
+/// @brief solve diag . x = b in place (O(n*m))
+///
+/// @param b the right side, replaced by x
+/// @param diag the diagonal matrix
+/// @return false if an element of the diagonal is 0 (b is not modified)
+///
+bool CMatDiag_solve(CMat *b, const CMatDiag *diag);
+///
+/// @brief determinant of a diagonal matrix, the product of the diagonal (O(n))
+///
+/// @param diag the matrix
+/// @return the determinant
+///
+CMatType CMatDiag_det(const CMatDiag *diag);
+
+///
+/// @brief get a pointer to an element of the triangle of a triangular matrix (O(1))
+///
+/// requirement:
+/// row <= col if tri->upper else row >= col
+///
+/// @param tri the triangular matrix
+/// @param row the row of the element
+/// @param col the col of the element
+///
+#define CMatTri_pat(tri, row, col)                                                                 \
+    ((tri)->data + ((tri)->upper ? (row) * (2 * (tri)->n - (row) - 1) / 2 + (col)                  \
+                                 : (row) * ((row) + 1) / 2 + (col)))
+///
+/// @brief get an element of the triangle of a triangular matrix (O(1)) (see CMatTri_pat)
+///
+#define CMatTri_at(tri, row, col) (*CMatTri_pat(tri, row, col))
+///
+/// @brief init a n x n triangular matrix (O(1)) (allocate)
+///
+/// @param tri the matrix to init
+/// @param n the number of row and col
+/// @param upper true for an upper triangular matrix, false for a lower one
+///
+void CMatTri_init(CMatTri *tri, size_t n, bool upper);
+///
+/// @brief deinit a triangular matrix (free)
+///
+/// @param tri the matrix to deinit
+///
+#define CMatTri_deinit(tri) (CMAT_FREE((tri)->data))
+///
+/// @brief init a triangular matrix with the upper or lower triangle of a square dense one
+/// (O(n^2)) (allocate)
+///
+/// @param tri the matrix to init
+/// @param src the dense matrix
+/// @param upper true to take the upper triangle, false for the lower one
+///
+void CMatTri_from_dense(CMatTri *tri, const CMat *src, bool upper);
+///
+/// @brief dst = the dense matrix of a triangular matrix (O(n^2))
+///
+/// requirement:
+/// dst->nrow == dst->ncol == tri->n
+///
+/// @param dst the dense matrix
+/// @param tri the triangular matrix
+///
+void CMatTri_to_dense(CMat *dst, const CMatTri *tri);
+///
+/// @brief dst = tri . b (O(n^2*m)), half the multiply-add of a dense product
+///
+/// requirement:
+/// b->nrow == tri->n && dst has the size of b
+///
+/// @param dst the result, can be b
+/// @param tri the triangular matrix
+/// @param b the dense matrix
+///
+void CMatTri_dot(CMat *dst, const CMatTri *tri, const CMat *b);
+///
+/// @brief solve tri . x = b in place by forward (lower) or back (upper) substitution (O(n^2*m))
+///
+/// example:
+/// // solve a . x = b from the Cholesky factor l of a (a = l . l^T)
+/// CMatTri_solve(&b, &l);
+/// CMatTri_solve_transpose(&b, &l);
+///
+/// @param b the right side, replaced by x
+/// @param tri the triangular matrix
+/// @return false if an element of the diagonal is 0 (b is not modified)
+///
+bool CMatTri_solve(CMat *b, const CMatTri *tri);
+///
+/// @brief solve tri^T . x = b in place without transposing tri (O(n^2*m)) (see CMatTri_solve)
+///
+/// @param b the right side, replaced by x
+/// @param tri the triangular matrix
+/// @return false if an element of the diagonal is 0 (b is not modified)
+///
+bool CMatTri_solve_transpose(CMat *b, const CMatTri *tri);
+///
+/// @brief determinant of a triangular matrix, the product of the diagonal (O(n))
+///
+/// @param tri the matrix
+/// @return the determinant
+///
+CMatType CMatTri_det(const CMatTri *tri);
+
+///
+/// @brief get a pointer to an element of the band of a banded matrix (O(1))
+///
+/// requirement:
+/// row <= col + band->kl && col <= row + band->ku
+///
+/// @param band the banded matrix
+/// @param row the row of the element
+/// @param col the col of the element
+///
+#define CMatBand_pat(band, row, col)                                                               \
+    ((band)->data + (row) * ((band)->kl + (band)->ku + 1) + (band)->kl + (col) - (row))
+///
+/// @brief get an element of the band of a banded matrix (O(1)) (see CMatBand_pat)
+///
+#define CMatBand_at(band, row, col) (*CMatBand_pat(band, row, col))
+///
+/// @brief init a banded matrix of 0 (O(n*(kl+ku))) (allocate)
+///
+/// example:
+/// // a tridiagonal matrix
+/// CMatBand band;
+/// CMatBand_init(&band, n, n, 1, 1);
+///
+/// @param band the matrix to init
+/// @param nrow the number of row
+/// @param ncol the number of col
+/// @param kl the number of diagonals under the diagonal
+/// @param ku the number of diagonals above the diagonal
+///
+void CMatBand_init(CMatBand *band, size_t nrow, size_t ncol, size_t kl, size_t ku);
+///
+/// @brief deinit a banded matrix (free)
+///
+/// @param band the matrix to deinit
+///
+#define CMatBand_deinit(band) (CMAT_FREE((band)->data))
+///
+/// @brief init a banded matrix with the band of a dense one (O(n*(kl+ku))) (allocate)
+///
+/// @param band the matrix to init
+/// @param src the dense matrix
+/// @param kl the number of diagonals under the diagonal
+/// @param ku the number of diagonals above the diagonal
+///
+void CMatBand_from_dense(CMatBand *band, const CMat *src, size_t kl, size_t ku);
+///
+/// @brief dst = the dense matrix of a banded matrix (O(n*m))
+///
+/// requirement:
+/// dst has the size of band
+///
+/// @param dst the dense matrix
+/// @param band the banded matrix
+///
+void CMatBand_to_dense(CMat *dst, const CMatBand *band);
+///
+/// @brief dst = band . b (O(n*(kl+ku)*m))
+///
+/// requirement:
+/// band->ncol == b->nrow && dst->nrow == band->nrow && dst->ncol == b->ncol
+/// dst is not b
+///
+/// @param dst the result
+/// @param band the banded matrix
+/// @param b the dense matrix
+///
+void CMatBand_dot(CMat *dst, const CMatBand *band, const CMat *b);
+
+///
+/// @brief get a pointer to an element of the lower triangle of a symmetric matrix (O(1))
+///
+/// requirement:
+/// row >= col (the element (col, row) is the same)
+///
+/// @param sym the symmetric matrix
+/// @param row the row of the element
+/// @param col the col of the element
+///
+#define CMatSym_pat(sym, row, col) ((sym)->data + (row) * ((row) + 1) / 2 + (col))
+///
+/// @brief get an element of the lower triangle of a symmetric matrix (O(1)) (see CMatSym_pat)
+///
+#define CMatSym_at(sym, row, col) (*CMatSym_pat(sym, row, col))
+///
+/// @brief init a n x n symmetric matrix (O(1)) (allocate)
+///
+/// @param sym the matrix to init
+/// @param n the number of row and col
+///
+void CMatSym_init(CMatSym *sym, size_t n);
+///
+/// @brief deinit a symmetric matrix (free)
+///
+/// @param sym the matrix to deinit
+///
+#define CMatSym_deinit(sym) (CMAT_FREE((sym)->data))
+///
+/// @brief init a symmetric matrix with the lower triangle of a square dense one (O(n^2))
+/// (allocate)
+///
+/// @param sym the matrix to init
+/// @param src the dense matrix, its upper triangle is not read
+///
+void CMatSym_from_dense(CMatSym *sym, const CMat *src);
+///
+/// @brief dst = the dense matrix of a symmetric matrix (O(n^2))
+///
+/// requirement:
+/// dst->nrow == dst->ncol == sym->n
+///
+/// @param dst the dense matrix
+/// @param sym the symmetric matrix
+///
+void CMatSym_to_dense(CMat *dst, const CMatSym *sym);
+///
+/// @brief dst = sym . b (O(n^2*m)), every stored element is read once and used for its two
+/// positions
+///
+/// requirement:
+/// b->nrow == sym->n && dst has the size of b
+/// dst is not b
+///
+/// @param dst the result
+/// @param sym the symmetric matrix
+/// @param b the dense matrix
+///
+void CMatSym_dot(CMat *dst, const CMatSym *sym, const CMat *b);
+
+// define CMAT_INSTRUMENT before including cmat to count the calls, the time, the flops and the
+// sizes of the calls of the functions of CMatStatFunc and the allocations of CMAT_MALLOC (without
+// it nothing of the instrumentation is compiled)
+#ifdef CMAT_INSTRUMENT
+// the instrumented functions, only the outermost call is counted (the gemm of CMat_lu are part of
+// CMat_lu) so the sum of the times is the time spent in cmat
+typedef enum {
+    CMAT_STAT_GEMM,
+    CMAT_STAT_DOT,
+    CMAT_STAT_STRASSEN,
+    CMAT_STAT_VIEW_GEMM,
+    CMAT_STAT_VIEW_COPY,
+    CMAT_STAT_CHAIN_DOT,
+    CMAT_STAT_TRANSPOSE,
+    CMAT_STAT_TRANSPOSE_INPLACE,
+    CMAT_STAT_ADD,
+    CMAT_STAT_SUB,
+    CMAT_STAT_MUL,
+    CMAT_STAT_SCALE,
+    CMAT_STAT_AXPY,
+    CMAT_STAT_SUM,
+    CMAT_STAT_INNER,
+    CMAT_STAT_MAX_ABS,
+    CMAT_STAT_EVAL,
+    CMAT_STAT_LU,
+    CMAT_STAT_LU_SOLVE,
+    CMAT_STAT_LU_UPDATE,
+    CMAT_STAT_CHOLESKY,
+    CMAT_STAT_CHOLESKY_SOLVE,
+    CMAT_STAT_CHOLESKY_UPDATE,
+    CMAT_STAT_SOLVE,
+    CMAT_STAT_DET,
+    CMAT_STAT_INVERSE,
+    CMAT_STAT_INVERSE_WS,
+    CMAT_STAT_INVERSE_UPDATE,
+    CMAT_STAT_QR,
+    CMAT_STAT_SYM_EIGEN,
+    CMAT_STAT_SVD,
+    CMAT_STAT_ADJ,
+    CMAT_STAT_BATCH_DOT,
+    CMAT_STAT_BATCH_DET,
+    CMAT_STAT_BATCH_INVERSE,
+    CMAT_STAT_CSR_GEMM,
+    CMAT_STAT_CSC_GEMM,
+    CMAT_STAT_TRI_DOT,
+    CMAT_STAT_TRI_SOLVE,
+    CMAT_STAT_BAND_DOT,
+    CMAT_STAT_SYM_DOT,
+    CMAT_STAT_COUNT,
+} CMatStatFunc;
+// the number of buckets of the size histograms, the bucket i count the calls on 2^i to
+// 2^(i + 1) - 1 elements (the last one also count every bigger call)
+#define CMAT_STAT_HIST_SIZE 32
+///
+/// @brief the counters of a function, the flops are the nominal count of the dense algorithm
+/// (2/3 n^3 for a LU) and the size of a call is the number of elements of its result
+///
+///
+typedef struct {
+    uint64_t calls;                     /// @memberof calls the number of calls
+    uint64_t ns;                        /// @memberof ns the time spent in the calls in ns
+    uint64_t flops;                     /// @memberof flops the flops of the calls
+    uint64_t hist[CMAT_STAT_HIST_SIZE]; /// @memberof hist the calls per size bucket
+} CMatStat;
+///
+/// @brief the counters of every counted function and of the allocations
+///
+///
+typedef struct {
+    CMatStat funcs[CMAT_STAT_COUNT]; /// @memberof funcs the counters indexed by CMatStatFunc
+    uint64_t alloc_calls;            /// @memberof alloc_calls the allocations done with CMAT_MALLOC
+    uint64_t alloc_bytes;            /// @memberof alloc_bytes the bytes allocated with CMAT_MALLOC
+} CMatStats;
+// called after every counted call with its time, flops and size
+typedef void (*CMatStatHook)(void *ctx, CMatStatFunc func, uint64_t ns, uint64_t flops,
+                             size_t size);
+///
+/// @brief get a snapshot of the counters (every counter is updated atomically, the calls of other
+/// threads can happen during the copy) (O(1))
+///
+/// example:
+/// CMatStats stats;
+/// CMat_stats_get(&stats);
+/// printf("%" PRIu64 " ns in CMat_dot\n", stats.funcs[CMAT_STAT_DOT].ns);
+///
+/// @param stats the counters
+///
+void CMat_stats_get(CMatStats *stats);
+///
+/// @brief set every counter to 0 (O(1))
+///
+void CMat_stats_reset(void);
+///
+/// @brief set the function called after every counted call (from the thread of the call)
+///
+/// warning:
+/// not thread safe, call it when no other thread use cmat
+///
+/// @param hook the function to call or NULL to remove it
+/// @param ctx the context given to hook
+///
+void CMat_stats_set_hook(CMatStatHook hook, void *ctx);
+///
+/// @brief the name of an instrumented function
+///
+/// @param func the function
+/// @return the name of the function (like "CMat_dot")
+///
+const char *CMat_stat_name(CMatStatFunc func);
+#ifndef CMAT_NO_PRINT
+///
+/// @brief print the counters of every called function and the allocations to the file f
+///
+/// @param f the file to print to
+///
+void CMat_stats_fprint(FILE *f);
+#endif // CMAT_NO_PRINT
+#endif // CMAT_INSTRUMENT
+
+#ifndef CMAT_NO_PRINT
+///
+/// @brief print a matrix to the file f using the precision float_pres (allocate and free)
+///
+/// @param f the file to print to
+/// @param cmat the matrix to print
+/// @param float_pres the precision of the floating point value printing
+///
+void CMat_fprint_pres(FILE *f, const CMat *cmat, size_t float_pres);
+#endif // CMAT_NO_PRINT
+
+// the default precision of printing of floating point value
+#define CMAT_FPRINT_DEFAULT_PRES 6
+///
+/// @brief print a matrix to the file f using the precision CMAT_FPRINT_DEFAULT_PRES (allocate and
+/// free)
+///
+/// @param f the file to print to
+/// @param cmat the matrix to print
+///
+#define CMat_fprint(f, cmat) CMat_fprint_pres(f, cmat, CMAT_FPRINT_DEFAULT_PRES)
+///
+/// @brief print a matrix to stdout using the precision float_pres (allocate and free)
+///
+/// @param cmat the matrix to print
+/// @param float_pres the precision of the floating point value printing
+///
+#define CMat_print_pres(cmat, pres) CMat_fprint_pres(stdout, cmat, pres)
+///
+/// @brief print a matrix to stdout using the precision CMAT_FPRINT_DEFAULT_PRES (allocate and free)
+///
+/// @param cmat the matrix to print
+///
+#define CMat_print(cmat) CMat_fprint(stdout, cmat)
+
+#ifndef CMAT_NO_PRINT
+// the version of the binary format written by CMat_write
+#define CMAT_BIN_VERSION 1
+// the size of CMatBinHeader, the data of CMat_write follow it
+#define CMAT_BIN_HEADER_SIZE 64
+///
+/// @brief the type of the elements of a binary matrix
+///
+///
+typedef enum {
+    CMAT_BIN_F64  = 1, /// double (CMat)
+    CMAT_BIN_F32  = 2, /// float (CMatf)
+    CMAT_BIN_I32  = 3, /// int32_t (CMati32)
+    CMAT_BIN_C64  = 4, /// float _Complex (CMatcf)
+    CMAT_BIN_C128 = 5, /// double _Complex (CMatcd)
+} CMatBinType;
+// the byte order of a binary matrix
+#define CMAT_BIN_LITTLE 1
+#define CMAT_BIN_BIG 2
+///
+/// @brief the header of the binary format of CMat_write, the nrow rows of stride elements start
+/// offset bytes after the beginning of the header (a multiple of CMAT_ALIGN so the data of a
+/// mapped file are aligned like the ones of CMat_init_aligned, a file with an offset that isn't a
+/// multiple of elem_size is rejected)
+///
+/// the checksum is 4 interleaved FNV-1a of 64 bits rotated left by 27 after every word (the word i
+/// go to the lane i % 4, is read little endian and the last one is padded with 0), the lanes and
+/// the size in bytes are then folded by a FNV-1a: it doesn't depend on the byte order of the
+/// machine and run at the speed of the memory
+///
+typedef struct {
+    char     magic[4];     /// @memberof magic "CMAT"
+    uint8_t  version;      /// @memberof version CMAT_BIN_VERSION
+    uint8_t  type;         /// @memberof type the CMatBinType of the elements
+    uint8_t  elem_size;    /// @memberof elem_size the size of an element in bytes
+    uint8_t  endian;       /// @memberof endian CMAT_BIN_LITTLE or CMAT_BIN_BIG for the header too
+    uint64_t nrow;         /// @memberof nrow the number of row
+    uint64_t ncol;         /// @memberof ncol the number of col
+    uint64_t stride;       /// @memberof stride the number of element between 2 rows (>= ncol)
+    uint64_t offset;       /// @memberof offset the offset of the data from the header
+    uint64_t checksum;     /// @memberof checksum the checksum of the nrow * stride elements
+    uint8_t  reserved[16]; /// @memberof reserved 0
+} CMatBinHeader;
+///
+/// @brief write a matrix to the file f in the binary format (see CMatBinHeader) in the byte order
+/// of the machine and without the padding of the rows (O(n))
+///
+/// example:
+/// FILE *f = fopen("weights.cmat", "wb");
+/// CMat_write(f, &weights);
+/// fclose(f);
+///
+/// @param f the file to write to (opened in binary mode)
+/// @param cmat the matrix to write
+/// @return false if a write failed
+///
+bool CMat_write(FILE *f, const CMat *cmat);
+///
+/// @brief read a matrix written by CMat_write from the file f, the elements are swapped if the
+/// byte order of the file isn't the one of the machine (O(n)) (allocate)
+///
+/// requirement:
+/// cmat need to be deinitialized with CMat_deinit
+///
+/// @param f the file to read from (opened in binary mode) after the matrix on success
+/// @param cmat an non initialize matrix we went to initiliaze with the stride of the file
+/// @return false if the file isn't a matrix of CMatType, is truncated or the checksum is wrong
+/// (cmat is not initialized)
+///
+bool CMat_read(FILE *f, CMat *cmat);
+///
+/// @brief write a matrix to the file at path with CMat_write (O(n))
+///
+/// @param path the path of the file (created or truncated)
+/// @param cmat the matrix to write
+/// @return false if the file can't be opened or a write failed
+///
+bool CMat_save(const char *path, const CMat *cmat);
+///
+/// @brief read the matrix of the file at path with CMat_read (O(n)) (allocate)
+///
+/// requirement:
+/// cmat need to be deinitialized with CMat_deinit
+///
+/// @param path the path of the file
+/// @param cmat an non initialize matrix we went to initiliaze
+/// @return false if the file can't be opened or CMat_read failed
+///
+bool CMat_load(const char *path, CMat *cmat);
+
+///
+/// @brief a file mapped in memory by CMat_mmap
+///
+///
+typedef struct {
+    void  *addr;   /// @memberof addr the beginning of the mapping (or of the allocation)
+    size_t size;   /// @memberof size the size of the mapping
+    bool   mapped; /// @memberof mapped false if the file was read in an allocation instead
+} CMatMap;
+///
+/// @brief map the file at path written by CMat_write in memory and initialize cmat as a view of
+/// its data without copying: the pages are read by the OS when they are first touched (O(1)) or
+/// when verify is true when the checksum is checked (O(n))
+///
+/// the mapping is private: writing to cmat doesn't change the file (the written pages are copied)
+/// on a system without mmap or if the byte order of the file isn't the one of the machine, the file
+/// is read in an allocation with CMat_read (O(n)) (allocate)
+///
+/// example:
+/// CMatMap map;
+/// CMat    weights;
+/// if (!CMat_mmap(&map, &weights, "weights.cmat", false)) { return 1; }
+/// CMat_dot(&out, &weights, &in);
+/// CMat_munmap(&map);
+///
+/// requirement:
+/// cmat must not be deinitialized, CMat_munmap release it
+///
+/// @param map the mapping to initialize
+/// @param cmat an non initialize matrix we went to initiliaze as a view of the mapping
+/// @param path the path of the file
+/// @param verify if true check the checksum (read the whole file)
+/// @return false if the file can't be mapped, isn't a matrix of CMatType, is truncated or the
+/// checksum is wrong
+///
+bool CMat_mmap(CMatMap *map, CMat *cmat, const char *path, bool verify);
+///
+/// @brief unmap a file mapped by CMat_mmap, the matrices viewing it become invalid (O(1)) (free)
+///
+/// @param map the mapping
+///
+void CMat_munmap(CMatMap *map);
+
+// the default number of significant digits of CMat_csv_write (enough to read back the same double)
+#define CMAT_CSV_DEFAULT_PRES 17
+///
+/// @brief write the rows of a matrix to the file f as text, the values of a row separated by delim
+/// like printf "%.*g" with precision significant digits and the rows by '\n' (O(n))
+///
+/// the values are formatted in a buffer written every 64KiB, a matrix bigger than the memory can
+/// be written row block by row block (each call append its rows)
+///
+/// example:
+/// CMat_csv_write(f, &cmat, ',', CMAT_CSV_DEFAULT_PRES);  // CSV
+/// CMat_csv_write(f, &cmat, '\t', 6);                     // TSV
+///
+/// requirement:
+/// 1 <= precision <= 17
+///
+/// @param f the file to write to
+/// @param cmat the matrix to write (can be a view)
+/// @param delim the separator of the values (',', '\t', ' ' or ';' ...)
+/// @param precision the number of significant digits
+/// @return false if a write failed
+///
+bool CMat_csv_write(FILE *f, const CMat *cmat, char delim, int precision);
+
+///
+/// @brief a reader of the rows of a CSV, TSV or whitespace separated file by blocks (with a
+/// buffer of a few lines so files bigger than the memory can be read)
+///
+/// the values are decimal floating point numbers (like strtod, "nan" and "inf" too, but a
+/// hexadecimal number like "0x10" is an error) with optional spaces around them, the lines ends
+/// with '\n' or "\r\n" and the empty lines are skipped,
+/// with delim ' ' the values are separated by any number of spaces and tabs
+///
+/// example:
+/// CMatCsvReader reader;
+/// CMat_csv_reader_init(&reader, f, ',');
+/// CMat_csv_reader_skip(&reader, 1);  // the header
+/// CMat block;
+/// CMat_init(&block, 1024, CMat_csv_reader_ncol(&reader));
+/// for (size_t nrow; (nrow = CMat_csv_reader_read(&reader, &block));) {
+///     CMat rows = CMat_from_submat(&block, 0, 0, nrow, block.ncol);
+///     process(&rows);
+/// }
+/// if (reader.error) { printf("error at line %zu\n", reader.line); }
+/// CMat_deinit(&block);
+/// CMat_csv_reader_deinit(&reader);
+///
+///
+typedef struct {
+    FILE  *f;     /// @memberof f the file read
+    char  *buf;   /// @memberof buf the text read and not parsed is buf[begin, end)
+    size_t size;  /// @memberof size the size of buf
+    size_t begin; /// @memberof begin the beginning of the next line in buf
+    size_t end;   /// @memberof end the end of the text read in buf
+    size_t line;  /// @memberof line the number of the line (from 1) of the next or the wrong row
+    char   delim; /// @memberof delim the separator of the values
+    bool   eof;   /// @memberof eof true if the end of f was read
+    bool   error; /// @memberof error true if a row can't be parsed or a read failed
+} CMatCsvReader;
+///
+/// @brief initialize a reader of the rows of the file f (O(1)) (allocate)
+///
+/// warning:
+/// the reader read f ahead, f must not be used by something else until CMat_csv_reader_deinit
+///
+/// @param reader the reader to initialize
+/// @param f the file to read
+/// @param delim the separator of the values (',', '\t' or ';' ... or ' ' for any spaces)
+///
+void CMat_csv_reader_init(CMatCsvReader *reader, FILE *f, char delim);
+///
+/// @brief deinitialize a reader and seek f back to the first line not read if f is seekable (O(1))
+/// (free)
+///
+/// @param reader the reader to deinitialize
+///
+void CMat_csv_reader_deinit(CMatCsvReader *reader);
+///
+/// @brief skip lines (like a header) without parsing them (O(size of the lines))
+///
+/// @param reader the reader
+/// @param nline the number of lines to skip
+/// @return the number of lines skipped (less than nline at the end of the file)
+///
+size_t CMat_csv_reader_skip(CMatCsvReader *reader, size_t nline);
+///
+/// @brief the number of values of the next row without reading it (O(size of the line))
+///
+/// @param reader the reader
+/// @return the number of values or 0 at the end of the file
+///
+size_t CMat_csv_reader_ncol(CMatCsvReader *reader);
+///
+/// @brief read the next rows of the file in the rows of dst until dst is full or the end of the
+/// file (O(n))
+///
+/// @param reader the reader
+/// @param dst the matrix to read in (can be a view), a row of the file must have dst->ncol values
+/// @return the number of rows read, less than dst->nrow at the end of the file or on an error
+/// (reader->error is true and reader->line is the line of the wrong row)
+///
+size_t CMat_csv_reader_read(CMatCsvReader *reader, CMat *dst);
+///
+/// @brief read exactly dst->nrow rows of the file f in dst (O(n)) (allocate and free)
+///
+/// example:
+/// CMatType arr[3][4];
+/// CMat     cmat = CMat_from_2darr(arr);
+/// CMat_csv_read(f, &cmat, ',');
+///
+/// warning:
+/// f is read ahead, after the call f is after the rows only if f is seekable
+///
+/// @param f the file to read
+/// @param dst the matrix to read in (can be a view)
+/// @param delim the separator of the values
+/// @return false if the file has less rows, a row doesn't have dst->ncol values or can't be parsed
+///
+bool CMat_csv_read(FILE *f, CMat *dst, char delim);
+#endif // CMAT_NO_PRINT
+
+// define CMAT_NO_TYPES before including cmat to only have the matrices of double (CMat)
+#ifndef CMAT_NO_TYPES
+///
+/// @brief declare the matrix family X of elements of type T: the element type X##Type, the matrix
+/// X (like CMat) and the functions X##_init, X##_add, X##_sub, X##_mul, X##_scale, X##_axpy,
+/// X##_sum, X##_inner, X##_transpose, X##_gemm and X##_dot that work like the CMat ones with
+/// kernels specialized for T, plus X##_from_d and X##_to_d to convert from and to a CMat (like a C
+/// cast, the real part for complex)
+///
+/// CMat_at, CMat_pat, CMat_iterate, CMat_iterate2 and CMat_iterate3 work on every family, the
+/// decompositions (LU, Cholesky, det, inverse, adjugate) and the printing are only for CMat
+///
+/// example:
+/// CMatfType arr[2][2] = {{1, 2}, {3, 4}};
+/// CMatf     a         = CMatf_from_2darr(arr);
+/// CMatf     b;
+/// CMatf_init(&b, 2, 2);
+/// CMatf_dot(&b, &a, &a);
+/// CMatf_deinit(&b);
+///
+#define CMAT_DECLARE_TYPE(X, T)                                                                    \
+    typedef T X##Type;                                                                             \
+    typedef struct {                                                                               \
+        X##Type *data;                                                                             \
+        size_t   nrow;                                                                             \
+        size_t   ncol;                                                                             \
+        size_t   stride;                                                                           \
+    } X;                                                                                           \
+    void    X##_init(X *cmat, size_t nrow, size_t ncol);                                           \
+    void    X##_from_d(X *dst, const CMat *src);                                                   \
+    void    X##_to_d(CMat *dst, const X *src);                                                     \
+    void    X##_add(X *dst, const X *cmat1, const X *cmat2);                                       \
+    void    X##_sub(X *dst, const X *cmat1, const X *cmat2);                                       \
+    void    X##_mul(X *dst, const X *cmat1, const X *cmat2);                                       \
+    void    X##_scale(X *dst, X##Type alpha, const X *src);                                        \
+    void    X##_axpy(X *dst, X##Type alpha, const X *src);                                         \
+    X##Type X##_sum(const X *cmat);                                                                \
+    X##Type X##_inner(const X *cmat1, const X *cmat2);                                             \
+    void    X##_transpose(X *dst, const X *src);                                                   \
+    void    X##_gemm(X *dst, X##Type alpha, const X *cmat1, const X *cmat2, X##Type beta);         \
+    void    X##_dot(X *dst, const X *cmat1, const X *cmat2);
+
+// create a matrix of the family X from an array without heap allocating (see CMat_from_arr)
+#define CMAT_FROM_ARR(X, arr, _nrow, _ncol)                                                        \
+    ((X){.data = (X##Type *)arr, .ncol = _ncol, .nrow = _nrow, .stride = _ncol})
+// create a matrix of the family X from a 2d array without heap allocating (see CMat_from_2darr)
+#define CMAT_FROM_2DARR(X, arr)                                                                    \
+    CMAT_FROM_ARR(X, arr, sizeof(*arr) ? sizeof(arr) / sizeof(*arr) : 0,                           \
+                  sizeof(*arr) ? sizeof(*arr) / sizeof(**arr) : 0)
+
+// matrices of float (half the memory bandwidth and twice the SIMD lanes of CMat)
+CMAT_DECLARE_TYPE(CMatf, float)
+#define CMatf_deinit(cmat) CMat_deinit(cmat)
+#define CMatf_from_arr(arr, _nrow, _ncol) CMAT_FROM_ARR(CMatf, arr, _nrow, _ncol)
+#define CMatf_from_2darr(arr) CMAT_FROM_2DARR(CMatf, arr)
+
+// matrices of int32_t (an overflow is undefined behavior like for the arithmetic of int32_t)
+CMAT_DECLARE_TYPE(CMati32, int32_t)
+#define CMati32_deinit(cmat) CMat_deinit(cmat)
+#define CMati32_from_arr(arr, _nrow, _ncol) CMAT_FROM_ARR(CMati32, arr, _nrow, _ncol)
+#define CMati32_from_2darr(arr) CMAT_FROM_2DARR(CMati32, arr)
+
+// matrices of float _Complex
+CMAT_DECLARE_TYPE(CMatcf, float _Complex)
+#define CMatcf_deinit(cmat) CMat_deinit(cmat)
+#define CMatcf_from_arr(arr, _nrow, _ncol) CMAT_FROM_ARR(CMatcf, arr, _nrow, _ncol)
+#define CMatcf_from_2darr(arr) CMAT_FROM_2DARR(CMatcf, arr)
+
+// matrices of double _Complex
+CMAT_DECLARE_TYPE(CMatcd, double _Complex)
+#define CMatcd_deinit(cmat) CMat_deinit(cmat)
+#define CMatcd_from_arr(arr, _nrow, _ncol) CMAT_FROM_ARR(CMatcd, arr, _nrow, _ncol)
+#define CMatcd_from_2darr(arr) CMAT_FROM_2DARR(CMatcd, arr)
+
+#ifndef CMAT_NO_PRINT
+// declare X##_write, X##_read, X##_save, X##_load and X##_mmap for the family X (see CMat_write,
+// CMat_read, CMat_save, CMat_load and CMat_mmap), the type of the file must be the one of X##Type
+#define CMAT_DECLARE_TYPE_IO(X)                                                                    \
+    bool X##_write(FILE *f, const X *cmat);                                                        \
+    bool X##_read(FILE *f, X *cmat);                                                               \
+    bool X##_save(const char *path, const X *cmat);                                                \
+    bool X##_load(const char *path, X *cmat);                                                      \
+    bool X##_mmap(CMatMap *map, X *cmat, const char *path, bool verify);
+CMAT_DECLARE_TYPE_IO(CMatf)
+CMAT_DECLARE_TYPE_IO(CMati32)
+CMAT_DECLARE_TYPE_IO(CMatcf)
+CMAT_DECLARE_TYPE_IO(CMatcd)
+#endif // CMAT_NO_PRINT
+
+// matrices of double are CMat
+typedef CMatType CMatdType;
+typedef CMat     CMatd;
+#define CMatd_init CMat_init
+#define CMatd_deinit CMat_deinit
+#define CMatd_from_arr CMat_from_arr
+#define CMatd_from_2darr CMat_from_2darr
+#define CMatd_add CMat_add
+#define CMatd_sub CMat_sub
+#define CMatd_mul CMat_mul
+#define CMatd_scale CMat_scale
+#define CMatd_axpy CMat_axpy
+#define CMatd_sum CMat_sum
+#define CMatd_inner CMat_inner
+#define CMatd_transpose CMat_transpose
+#define CMatd_gemm CMat_gemm
+#define CMatd_dot CMat_dot
+#ifndef CMAT_NO_PRINT
+#define CMatd_write CMat_write
+#define CMatd_read CMat_read
+#define CMatd_save CMat_save
+#define CMatd_load CMat_load
+#define CMatd_mmap CMat_mmap
+#endif // CMAT_NO_PRINT
+#endif // CMAT_NO_TYPES
+
+#endif // CMAT_H
+// #define CMAT_IMPL
+#ifdef CMAT_IMPL
+
+#include <float.h>
+#include <math.h>
+
+#ifdef CMAT_INSTRUMENT
+#include <time.h>
+
+static CMatStats    cmat_stats;
+static CMatStatHook cmat_stat_hook     = NULL;
+static void        *cmat_stat_hook_ctx = NULL;
+// the number of instrumented calls in progress in the thread
+static _Thread_local size_t cmat_stat_depth = 0;
+
+static uint64_t cmat_stat_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+// the start time of an outermost call (0 for a nested call)
+static uint64_t cmat_stat_begin(void) { return cmat_stat_depth++ == 0 ? cmat_stat_now() : 0; }
+static void     cmat_stat_end(CMatStatFunc func, uint64_t start, double flops, size_t size) {
+    if (--cmat_stat_depth != 0) { return; }
+
+    uint64_t  ns     = cmat_stat_now() - start;
+    size_t    bucket = 0;
+    CMatStat *stat   = &cmat_stats.funcs[func];
+    while (bucket + 1 < CMAT_STAT_HIST_SIZE && size >> (bucket + 1) != 0) { ++bucket; }
+    __atomic_fetch_add(&stat->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->flops, (uint64_t)flops, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->hist[bucket], 1, __ATOMIC_RELAXED);
+    if (cmat_stat_hook) { cmat_stat_hook(cmat_stat_hook_ctx, func, ns, (uint64_t)flops, size); }
+}
+// count the call of the enclosing function from CMAT_STAT_BEGIN to CMAT_STAT_END
+#define CMAT_STAT_BEGIN() uint64_t cmat_stat_start = cmat_stat_begin()
+#define CMAT_STAT_END(func, flops, size) cmat_stat_end(func, cmat_stat_start, flops, size)
+
+void CMat_stats_get(CMatStats *stats) {
+    // every counter is an uint64_t
+    const uint64_t *src = (const uint64_t *)&cmat_stats;
+    uint64_t       *dst = (uint64_t *)stats;
+    for (size_t i = 0; i < sizeof(CMatStats) / sizeof(uint64_t); ++i) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+void CMat_stats_reset(void) {
+    uint64_t *counters = (uint64_t *)&cmat_stats;
+    for (size_t i = 0; i < sizeof(CMatStats) / sizeof(uint64_t); ++i) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+}
+void CMat_stats_set_hook(CMatStatHook hook, void *ctx) {
+    cmat_stat_hook     = hook;
+    cmat_stat_hook_ctx = ctx;
+}
+const char *CMat_stat_name(CMatStatFunc func) {
+    static const char *names[CMAT_STAT_COUNT] = {
+        [CMAT_STAT_GEMM]              = "CMat_gemm",
+        [CMAT_STAT_DOT]               = "CMat_dot",
+        [CMAT_STAT_STRASSEN]          = "CMat_strassen",
+        [CMAT_STAT_VIEW_GEMM]         = "CMatView_gemm",
+        [CMAT_STAT_VIEW_COPY]         = "CMatView_copy",
+        [CMAT_STAT_CHAIN_DOT]         = "CMat_chain_dot",
+        [CMAT_STAT_TRANSPOSE]         = "CMat_transpose",
+        [CMAT_STAT_TRANSPOSE_INPLACE] = "CMat_transpose_inplace",
+        [CMAT_STAT_ADD]               = "CMat_add",
+        [CMAT_STAT_SUB]               = "CMat_sub",
+        [CMAT_STAT_MUL]               = "CMat_mul",
+        [CMAT_STAT_SCALE]             = "CMat_scale",
+        [CMAT_STAT_AXPY]              = "CMat_axpy",
+        [CMAT_STAT_SUM]               = "CMat_sum",
+        [CMAT_STAT_INNER]             = "CMat_inner",
+        [CMAT_STAT_MAX_ABS]           = "CMat_max_abs",
+        [CMAT_STAT_EVAL]              = "CMat_eval",
+        [CMAT_STAT_LU]                = "CMat_lu",
+        [CMAT_STAT_LU_SOLVE]          = "CMat_lu_solve",
+        [CMAT_STAT_LU_UPDATE]         = "CMat_lu_update",
+        [CMAT_STAT_CHOLESKY]          = "CMat_cholesky",
+        [CMAT_STAT_CHOLESKY_SOLVE]    = "CMat_cholesky_solve",
+        [CMAT_STAT_CHOLESKY_UPDATE]   = "CMat_cholesky_update",
+        [CMAT_STAT_SOLVE]             = "CMat_solve",
+        [CMAT_STAT_DET]               = "CMat_det",
+        [CMAT_STAT_INVERSE]           = "CMat_inverse",
+        [CMAT_STAT_INVERSE_WS]        = "CMat_inverse_ws",
+        [CMAT_STAT_INVERSE_UPDATE]    = "CMat_inverse_update",
+        [CMAT_STAT_QR]                = "CMat_qr",
+        [CMAT_STAT_SYM_EIGEN]         = "CMat_sym_eigen",
+        [CMAT_STAT_SVD]               = "CMat_svd",
+        [CMAT_STAT_ADJ]               = "CMat_adj",
+        [CMAT_STAT_BATCH_DOT]         = "CMatBatch_dot",
+        [CMAT_STAT_BATCH_DET]         = "CMatBatch_det",
+        [CMAT_STAT_BATCH_INVERSE]     = "CMatBatch_inverse",
+        [CMAT_STAT_CSR_GEMM]          = "CMatCsr_gemm",
+        [CMAT_STAT_CSC_GEMM]          = "CMatCsc_gemm",
+        [CMAT_STAT_TRI_DOT]           = "CMatTri_dot",
+        [CMAT_STAT_TRI_SOLVE]         = "CMatTri_solve",
+        [CMAT_STAT_BAND_DOT]          = "CMatBand_dot",
+        [CMAT_STAT_SYM_DOT]           = "CMatSym_dot",
+    };
+    return func < CMAT_STAT_COUNT ? names[func] : "unknown";
+}
+#ifndef CMAT_NO_PRINT
+void CMat_stats_fprint(FILE *f) {
+    CMatStats stats;
+    CMat_stats_get(&stats);
+
+    fprintf(f, "%-24s %12s %14s %10s %10s  %s\n", "function", "calls", "ns", "ns/call",
+            "GFLOP/s", "calls by log2(size)");
+    for (size_t i = 0; i < CMAT_STAT_COUNT; ++i) {
+        const CMatStat *stat = &stats.funcs[i];
+        if (stat->calls == 0) { continue; }
+
+        fprintf(f, "%-24s %12" PRIu64 " %14" PRIu64 " %10.1f %10.3f ", CMat_stat_name(i),
+                stat->calls, stat->ns, (double)stat->ns / stat->calls,
+                stat->ns ? (double)stat->flops / stat->ns : 0.0);
+        for (size_t b = 0; b < CMAT_STAT_HIST_SIZE; ++b) {
+            if (stat->hist[b]) { fprintf(f, " %zu:%" PRIu64, b, stat->hist[b]); }
+        }
+        fputc('\n', f);
+    }
+    fprintf(f, "CMAT_MALLOC: %" PRIu64 " allocations of %" PRIu64 " bytes\n", stats.alloc_calls,
+            stats.alloc_bytes);
+}
+#endif // CMAT_NO_PRINT
+#else
+#define CMAT_STAT_BEGIN()
+#define CMAT_STAT_END(func, flops, size)
+#endif // CMAT_INSTRUMENT
+
+// every allocation of the implementation go through it so CMAT_INSTRUMENT can count them
+static void *cmat_malloc(size_t num_elem, size_t size_elem) {
+    void *ptr = CMAT_MALLOC(num_elem, size_elem);
+#ifdef CMAT_INSTRUMENT
+    if (ptr) {
+        __atomic_fetch_add(&cmat_stats.alloc_calls, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cmat_stats.alloc_bytes, num_elem * size_elem, __ATOMIC_RELAXED);
+    }
+#endif // CMAT_INSTRUMENT
+    return ptr;
+}
+
+void CMat_init(CMat *cmat, size_t nrow, size_t ncol) {
+    cmat->data = cmat_malloc(ncol * nrow, sizeof(*cmat->data));
     CMAT_ASSERT(cmat->data, "malloc failed");
 
-    cmat->nrow   = nrow;
-    cmat->ncol   = ncol;
-    cmat->stride = ncol;
+    cmat->nrow   = nrow;
+    cmat->ncol   = ncol;
+    cmat->stride = ncol;
+}
+
+void CMat_identity(CMat *dst) {
+    CMAT_ASSERT(dst->nrow == dst->ncol, "row and col don't match");
+    CMat_iterate(dst, row, col, val, {
+        if (row == col) {
+            *val = 1;
+        } else {
+            *val = 0;
+        }
+    });
+}
+
+// round x up to a multiple of a
+#define CMAT_ROUND_UP(x, a) (((x) + (a) - 1) / (a) * (a))
+#define CMAT_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define CMAT_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static void *cmat_heap_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return cmat_malloc(size, 1);
+}
+static void cmat_heap_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    CMAT_FREE(ptr);
+}
+const CMatAllocator CMat_heap_allocator = {.alloc = cmat_heap_alloc, .free = cmat_heap_free};
+
+void CMat_init_with(CMat *cmat, size_t nrow, size_t ncol, const CMatAllocator *alloc) {
+    cmat->data = alloc->alloc(alloc->ctx, nrow * ncol * sizeof(*cmat->data));
+    CMAT_ASSERT(cmat->data, "alloc failed");
+
+    cmat->nrow   = nrow;
+    cmat->ncol   = ncol;
+    cmat->stride = ncol;
+}
+void CMat_deinit_with(CMat *cmat, const CMatAllocator *alloc) {
+    alloc->free(alloc->ctx, cmat->data, cmat->nrow * cmat->ncol * sizeof(*cmat->data));
+}
+
+size_t CMat_aligned_stride(size_t ncol) {
+    size_t stride = CMAT_ROUND_UP(ncol, CMAT_ALIGN / sizeof(CMatType));
+    if (stride != 0 && stride * sizeof(CMatType) % CMAT_STRIDE_AVOID == 0) {
+        stride += CMAT_ALIGN / sizeof(CMatType);
+    }
+    return stride;
+}
+void CMat_init_aligned(CMat *cmat, size_t nrow, size_t ncol) {
+    size_t stride = CMat_aligned_stride(ncol);
+    // the pointer to free is stored just before the data
+    void *raw = cmat_malloc(nrow * stride * sizeof(CMatType) + sizeof(void *) + CMAT_ALIGN, 1);
+    CMAT_ASSERT(raw, "malloc failed");
+    cmat->data = (CMatType *)CMAT_ROUND_UP((uintptr_t)raw + sizeof(void *), CMAT_ALIGN);
+    ((void **)cmat->data)[-1] = raw;
+
+    cmat->nrow   = nrow;
+    cmat->ncol   = ncol;
+    cmat->stride = stride;
+}
+void CMat_deinit_aligned(CMat *cmat) { CMAT_FREE(((void **)cmat->data)[-1]); }
+
+static void *cmat_arena_alloc(void *ctx, size_t size) {
+    CMatArena *arena = ctx;
+    uintptr_t  start = CMAT_ROUND_UP((uintptr_t)arena->buf + arena->used, CMAT_ALIGN);
+    size_t     end   = start - (uintptr_t)arena->buf + size;
+    if (end > arena->size) { return NULL; }
+
+    arena->used = end;
+    arena->peak = CMAT_MAX(arena->peak, end);
+    return (void *)start;
+}
+static void cmat_arena_free(void *ctx, void *ptr, size_t size) {
+    CMatArena     *arena = ctx;
+    unsigned char *bytes = ptr;
+    // only the last allocation can be given back (the temporaries are freed in reverse order)
+    if (bytes + size == arena->buf + arena->used) { arena->used = bytes - arena->buf; }
+}
+void CMat_arena_init(CMatArena *arena, void *buf, size_t size) {
+    arena->owned = buf == NULL;
+    if (arena->owned) {
+        buf = cmat_malloc(size, 1);
+        CMAT_ASSERT(buf, "malloc failed");
+    }
+    arena->buf  = buf;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+}
+void CMat_arena_deinit(CMatArena *arena) {
+    if (arena->owned) { CMAT_FREE(arena->buf); }
+}
+CMatAllocator CMat_arena_allocator(CMatArena *arena) {
+    return (CMatAllocator){.alloc = cmat_arena_alloc, .free = cmat_arena_free, .ctx = arena};
+}
+
+static void *cmat_block_pool_alloc(void *ctx, size_t size) {
+    CMatBlockPool *pool  = ctx;
+    void          *block = pool->free_list;
+    if (size > pool->block_size || block == NULL) { return NULL; }
+
+    pool->free_list = *(void **)block;
+    return block;
+}
+static void cmat_block_pool_free(void *ctx, void *ptr, size_t size) {
+    CMatBlockPool *pool = ctx;
+    (void)size;
+    if (ptr == NULL) { return; }
+
+    *(void **)ptr   = pool->free_list;
+    pool->free_list = ptr;
+}
+void CMat_block_pool_init(CMatBlockPool *pool, void *buf, size_t block_size, size_t num_blocks) {
+    pool->owned = buf == NULL;
+    if (pool->owned) {
+        buf = cmat_malloc(CMAT_BLOCK_POOL_SIZE(block_size, num_blocks), 1);
+        CMAT_ASSERT(buf, "malloc failed");
+    }
+    pool->buf        = buf;
+    pool->block_size = CMAT_ROUND_UP(CMAT_MAX(block_size, sizeof(void *)), CMAT_ALIGN);
+    pool->free_list  = NULL;
+
+    // chain the blocks from the last so the first block is allocated first
+    unsigned char *first = (unsigned char *)CMAT_ROUND_UP((uintptr_t)buf, CMAT_ALIGN);
+    for (size_t i = num_blocks; i-- > 0;) {
+        cmat_block_pool_free(pool, first + i * pool->block_size, pool->block_size);
+    }
+}
+void CMat_block_pool_deinit(CMatBlockPool *pool) {
+    if (pool->owned) { CMAT_FREE(pool->buf); }
+}
+CMatAllocator CMat_block_pool_allocator(CMatBlockPool *pool) {
+    return (CMatAllocator){
+        .alloc = cmat_block_pool_alloc, .free = cmat_block_pool_free, .ctx = pool};
+}
+
+// the allocator of the temporaries of the thread, NULL for CMat_heap_allocator
+static _Thread_local const CMatAllocator *cmat_scratch_allocator = NULL;
+
+const CMatAllocator *CMat_set_scratch_allocator(const CMatAllocator *alloc) {
+    const CMatAllocator *prev = cmat_scratch_allocator;
+    cmat_scratch_allocator    = alloc;
+    return prev ? prev : &CMat_heap_allocator;
+}
+static const CMatAllocator *cmat_scratch(void) {
+    return cmat_scratch_allocator ? cmat_scratch_allocator : &CMat_heap_allocator;
+}
+// allocate a temporary that need to be freed by cmat_scratch_free with the same size
+static void *cmat_scratch_alloc(size_t size) {
+    void *ptr = cmat_scratch()->alloc(cmat_scratch()->ctx, size);
+    CMAT_ASSERT(ptr, "scratch alloc failed");
+    return ptr;
+}
+static void cmat_scratch_free(void *ptr, size_t size) {
+    cmat_scratch()->free(cmat_scratch()->ctx, ptr, size);
+}
+
+#if !defined(CMAT_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CMAT_X86_SIMD
+#include <immintrin.h>
+#define CMAT_TARGET_SSE2 __attribute__((target("sse2")))
+#define CMAT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CMAT_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif // CMAT_X86_SIMD
+
+// biggest register tile of every micro-kernel (mr * nr)
+#define CMAT_GEMM_TILE_MAX 256
+_Static_assert(CMAT_GEMM_MR * CMAT_GEMM_NR <= CMAT_GEMM_TILE_MAX,
+               "CMAT_GEMM_MR * CMAT_GEMM_NR is bigger than the biggest register tile");
+// biggest block of every transpose kernel (tb)
+#define CMAT_TRANSPOSE_BLOCK_MAX 8
+
+// the kernels of an instruction set, every one work on contiguous memory, the CMat functions
+// split the matrices into rows
+typedef struct {
+    CMatIsa isa; // the instruction set of the kernels
+    size_t  mr;  // rows of the gemm register tile
+    size_t  nr;  // cols of the gemm register tile
+    // dst = alpha * a . b + beta * dst for a mr x nr tile from packed micro-panels
+    void (*gemm_ukernel)(size_t kc, CMatType alpha, const CMatType *a, const CMatType *b,
+                         CMatType beta, CMatType *c, size_t rsc, size_t csc);
+    size_t tb; // size of the square block transpose_block work on
+    void (*transpose_block)(CMatType *dst, size_t rsd, const CMatType *src, size_t rss);
+    void (*add)(size_t n, CMatType *dst, const CMatType *a, const CMatType *b);
+    void (*sub)(size_t n, CMatType *dst, const CMatType *a, const CMatType *b);
+    void (*mul)(size_t n, CMatType *dst, const CMatType *a, const CMatType *b);
+    void (*scale)(size_t n, CMatType *dst, CMatType alpha, const CMatType *src);
+    void (*axpy)(size_t n, CMatType *dst, CMatType alpha, const CMatType *src);
+    CMatType (*sum)(size_t n, const CMatType *src);
+    CMatType (*dot)(size_t n, const CMatType *a, const CMatType *b);
+    CMatType (*max_abs)(size_t n, const CMatType *src);
+} CMatKernels;
+
+// store alpha * ab + beta * c for a m x n tile, beta == 0 should not read c (it can be
+// uninitialized)
+static void cmat_gemm_store_tile(size_t m, size_t n, CMatType alpha, const CMatType *ab,
+                                 size_t ldab, CMatType beta, CMatType *c, size_t rsc,
+                                 size_t csc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            CMatType *cij = c + i * rsc + j * csc;
+            *cij = (beta == 0) ? alpha * ab[i * ldab + j] : alpha * ab[i * ldab + j] + beta * *cij;
+        }
+    }
+}
+
+// compute alpha * a . b + beta * c for a CMAT_GEMM_MR x CMAT_GEMM_NR tile of c where a is a packed
+// micro-panel of CMAT_GEMM_MR rows and b a packed micro-panel of CMAT_GEMM_NR columns
+static void cmat_gemm_ukernel_scalar(size_t kc, CMatType alpha, const CMatType *restrict a,
+                                     const CMatType *restrict b, CMatType beta,
+                                     CMatType *restrict c, size_t rsc, size_t csc) {
+    CMatType ab[CMAT_GEMM_MR][CMAT_GEMM_NR] = {{0}};
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t i = 0; i < CMAT_GEMM_MR; ++i) {
+            for (size_t j = 0; j < CMAT_GEMM_NR; ++j) { ab[i][j] += a[i] * b[j]; }
+        }
+        a += CMAT_GEMM_MR;
+        b += CMAT_GEMM_NR;
+    }
+    cmat_gemm_store_tile(CMAT_GEMM_MR, CMAT_GEMM_NR, alpha, ab[0], CMAT_GEMM_NR, beta, c, rsc,
+                         csc);
+}
+static void cmat_transpose_block_scalar(CMatType *dst, size_t rsd, const CMatType *src,
+                                        size_t rss) {
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) { dst[j * rsd + i] = src[i * rss + j]; }
+    }
+}
+static void cmat_add_scalar(size_t n, CMatType *dst, const CMatType *a, const CMatType *b) {
+    for (size_t i = 0; i < n; ++i) { dst[i] = a[i] + b[i]; }
+}
+static void cmat_sub_scalar(size_t n, CMatType *dst, const CMatType *a, const CMatType *b) {
+    for (size_t i = 0; i < n; ++i) { dst[i] = a[i] - b[i]; }
+}
+static void cmat_mul_scalar(size_t n, CMatType *dst, const CMatType *a, const CMatType *b) {
+    for (size_t i = 0; i < n; ++i) { dst[i] = a[i] * b[i]; }
+}
+static void cmat_scale_scalar(size_t n, CMatType *dst, CMatType alpha, const CMatType *src) {
+    for (size_t i = 0; i < n; ++i) { dst[i] = alpha * src[i]; }
+}
+static void cmat_axpy_scalar(size_t n, CMatType *dst, CMatType alpha, const CMatType *src) {
+    for (size_t i = 0; i < n; ++i) { dst[i] += alpha * src[i]; }
+}
+static CMatType cmat_sum_scalar(size_t n, const CMatType *src) {
+    CMatType sum = 0;
+    for (size_t i = 0; i < n; ++i) { sum += src[i]; }
+    return sum;
+}
+static CMatType cmat_dot_scalar(size_t n, const CMatType *a, const CMatType *b) {
+    CMatType sum = 0;
+    for (size_t i = 0; i < n; ++i) { sum += a[i] * b[i]; }
+    return sum;
+}
+static CMatType cmat_max_abs_scalar(size_t n, const CMatType *src) {
+    CMatType max = 0;
+    for (size_t i = 0; i < n; ++i) {
+        CMatType x = src[i] < 0 ? -src[i] : src[i];
+        if (x > max) { max = x; }
+    }
+    return max;
+}
+
+static const CMatKernels cmat_kernels_scalar = {
+    .isa             = CMAT_ISA_SCALAR,
+    .mr              = CMAT_GEMM_MR,
+    .nr              = CMAT_GEMM_NR,
+    .gemm_ukernel    = cmat_gemm_ukernel_scalar,
+    .tb              = 4,
+    .transpose_block = cmat_transpose_block_scalar,
+    .add             = cmat_add_scalar,
+    .sub             = cmat_sub_scalar,
+    .mul             = cmat_mul_scalar,
+    .scale           = cmat_scale_scalar,
+    .axpy            = cmat_axpy_scalar,
+    .sum             = cmat_sum_scalar,
+    .dot             = cmat_dot_scalar,
+    .max_abs         = cmat_max_abs_scalar,
+};
+
+#ifdef CMAT_X86_SIMD
+// scalar iterations until ptr + i is aligned on a vector so the vector loop after it load and
+// store whole vectors, every operand is then aligned if they all share the alignment of ptr (like
+// the rows of the matrices of CMat_init_aligned)
+#define CMAT_VEC_PEEL(isa, i, n, ptr, stmt)                                                        \
+    for (; (i) < (n) && (uintptr_t)((ptr) + (i)) % sizeof(cmat_veca_##isa) != 0; ++(i)) { stmt }
+
+// element-wise and reduction kernels of W lanes written with gcc vector extensions, the same source
+// compile to the instruction set of target, reductions use 4 accumulators to hide the latency
+#define CMAT_DEFINE_VEC_KERNELS(isa, target, W)                                                    \
+    typedef CMatType cmat_vec_##isa __attribute__((vector_size((W) * sizeof(CMatType)),           \
+                                                   aligned(sizeof(CMatType)), may_alias));         \
+    typedef long long cmat_veci_##isa __attribute__((vector_size((W) * sizeof(CMatType)),          \
+                                                     aligned(sizeof(CMatType)), may_alias));       \
+    typedef CMatType cmat_veca_##isa                                                               \
+        __attribute__((vector_size((W) * sizeof(CMatType)), may_alias));                           \
+    target static void cmat_add_##isa(size_t n, CMatType *dst, const CMatType *a,                  \
+                                      const CMatType *b) {                                         \
+        size_t i = 0;                                                                              \
+        CMAT_VEC_PEEL(isa, i, n, dst, dst[i] = a[i] + b[i];)                                       \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(cmat_veca_##isa *)(dst + i) =                                                        \
+                *(const cmat_vec_##isa *)(a + i) + *(const cmat_vec_##isa *)(b + i);               \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] + b[i]; }                                               \
+    }                                                                                              \
+    target static void cmat_sub_##isa(size_t n, CMatType *dst, const CMatType *a,                  \
+                                      const CMatType *b) {                                         \
+        size_t i = 0;                                                                              \
+        CMAT_VEC_PEEL(isa, i, n, dst, dst[i] = a[i] - b[i];)                                       \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(cmat_veca_##isa *)(dst + i) =                                                        \
+                *(const cmat_vec_##isa *)(a + i) - *(const cmat_vec_##isa *)(b + i);               \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] - b[i]; }                                               \
+    }                                                                                              \
+    target static void cmat_mul_##isa(size_t n, CMatType *dst, const CMatType *a,                  \
+                                      const CMatType *b) {                                         \
+        size_t i = 0;                                                                              \
+        CMAT_VEC_PEEL(isa, i, n, dst, dst[i] = a[i] * b[i];)                                       \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(cmat_veca_##isa *)(dst + i) =                                                        \
+                *(const cmat_vec_##isa *)(a + i) * *(const cmat_vec_##isa *)(b + i);               \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] * b[i]; }                                               \
+    }                                                                                              \
+    target static void cmat_scale_##isa(size_t n, CMatType *dst, CMatType alpha,                   \
+                                        const CMatType *src) {                                     \
+        size_t i = 0;                                                                              \
+        CMAT_VEC_PEEL(isa, i, n, dst, dst[i] = alpha * src[i];)                                    \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(cmat_veca_##isa *)(dst + i) = alpha * *(const cmat_vec_##isa *)(src + i);            \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = alpha * src[i]; }                                            \
+    }                                                                                              \
+    target static void cmat_axpy_##isa(size_t n, CMatType *dst, CMatType alpha,                    \
+                                       const CMatType *src) {                                      \
+        size_t i = 0;                                                                              \
+        CMAT_VEC_PEEL(isa, i, n, dst, dst[i] += alpha * src[i];)                                   \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(cmat_veca_##isa *)(dst + i) += alpha * *(const cmat_vec_##isa *)(src + i);           \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] += alpha * src[i]; }                                           \
+    }                                                                                              \
+    target static CMatType cmat_sum_##isa(size_t n, const CMatType *src) {                         \
+        cmat_vec_##isa acc[4] = {{0}};                                                             \
+        CMatType       sum    = 0;                                                                 \
+        size_t         i      = 0;                                                                 \
+        CMAT_VEC_PEEL(isa, i, n, src, sum += src[i];)                                              \
+        for (; i + 4 * (W) <= n; i += 4 * (W)) {                                                   \
+            for (size_t u = 0; u < 4; ++u) {                                                       \
+                acc[u] += *(const cmat_veca_##isa *)(src + i + u * (W));                           \
+            }                                                                                      \
+        }                                                                                          \
+        acc[0] += acc[1] + acc[2] + acc[3];                                                        \
+        for (size_t l = 0; l < (W); ++l) { sum += acc[0][l]; }                                     \
+        for (; i < n; ++i) { sum += src[i]; }                                                      \
+        return sum;                                                                                \
+    }                                                                                              \
+    target static CMatType cmat_dot_##isa(size_t n, const CMatType *a, const CMatType *b) {        \
+        cmat_vec_##isa acc[4] = {{0}};                                                             \
+        CMatType       sum    = 0;                                                                 \
+        size_t         i      = 0;                                                                 \
+        CMAT_VEC_PEEL(isa, i, n, a, sum += a[i] * b[i];)                                           \
+        for (; i + 4 * (W) <= n; i += 4 * (W)) {                                                   \
+            for (size_t u = 0; u < 4; ++u) {                                                       \
+                acc[u] += *(const cmat_veca_##isa *)(a + i + u * (W)) *                            \
+                          *(const cmat_vec_##isa *)(b + i + u * (W));                              \
+            }                                                                                      \
+        }                                                                                          \
+        acc[0] += acc[1] + acc[2] + acc[3];                                                        \
+        for (size_t l = 0; l < (W); ++l) { sum += acc[0][l]; }                                     \
+        for (; i < n; ++i) { sum += a[i] * b[i]; }                                                 \
+        return sum;                                                                                \
+    }                                                                                              \
+    target static CMatType cmat_max_abs_##isa(size_t n, const CMatType *src) {                     \
+        /* clear the sign bit to get the absolute value */                                         \
+        cmat_veci_##isa abs_mask = (cmat_veci_##isa){0} + 0x7fffffffffffffffLL;                    \
+        cmat_vec_##isa  max      = {0};                                                            \
+        CMatType        res      = 0;                                                              \
+        size_t          i        = 0;                                                              \
+        CMAT_VEC_PEEL(isa, i, n, src, if (fabs(src[i]) > res) { res = fabs(src[i]); })            \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            cmat_vec_##isa  x  = (cmat_vec_##isa)(*(const cmat_veci_##isa *)(src + i) & abs_mask); \
+            cmat_veci_##isa gt = x > max;                                                          \
+            max = (cmat_vec_##isa)((gt & (cmat_veci_##isa)x) | (~gt & (cmat_veci_##isa)max));      \
+        }                                                                                          \
+        for (size_t l = 0; l < (W); ++l) {                                                         \
+            if (max[l] > res) { res = max[l]; }                                                    \
+        }                                                                                          \
+        for (; i < n; ++i) {                                                                       \
+            CMatType x = src[i] < 0 ? -src[i] : src[i];                                            \
+            if (x > res) { res = x; }                                                              \
+        }                                                                                          \
+        return res;                                                                                \
+    }
+
+CMAT_DEFINE_VEC_KERNELS(sse2, CMAT_TARGET_SSE2, 2)
+CMAT_DEFINE_VEC_KERNELS(avx2, CMAT_TARGET_AVX2, 4)
+CMAT_DEFINE_VEC_KERNELS(avx512, CMAT_TARGET_AVX512, 8)
+
+// 4x4 register tile: 4 rows of 2 xmm accumulators
+CMAT_TARGET_SSE2 static void cmat_gemm_ukernel_sse2(size_t kc, CMatType alpha,
+                                                    const CMatType *restrict a,
+                                                    const CMatType *restrict b, CMatType beta,
+                                                    CMatType *restrict c, size_t rsc, size_t csc) {
+    __m128d acc[4][2];
+#pragma GCC unroll 4
+    for (size_t i = 0; i < 4; ++i) { acc[i][0] = acc[i][1] = _mm_setzero_pd(); }
+    for (size_t p = 0; p < kc; ++p) {
+        __m128d b0 = _mm_loadu_pd(b), b1 = _mm_loadu_pd(b + 2);
+#pragma GCC unroll 4
+        for (size_t i = 0; i < 4; ++i) {
+            __m128d ai = _mm_set1_pd(a[i]);
+            acc[i][0]  = _mm_add_pd(acc[i][0], _mm_mul_pd(ai, b0));
+            acc[i][1]  = _mm_add_pd(acc[i][1], _mm_mul_pd(ai, b1));
+        }
+        a += 4;
+        b += 4;
+    }
+    CMatType ab[4 * 4];
+#pragma GCC unroll 4
+    for (size_t i = 0; i < 4; ++i) {
+        _mm_storeu_pd(ab + i * 4, acc[i][0]);
+        _mm_storeu_pd(ab + i * 4 + 2, acc[i][1]);
+    }
+    cmat_gemm_store_tile(4, 4, alpha, ab, 4, beta, c, rsc, csc);
+}
+// 6x8 register tile: 6 rows of 2 ymm accumulators (12 of the 16 ymm registers)
+CMAT_TARGET_AVX2 static void cmat_gemm_ukernel_avx2(size_t kc, CMatType alpha,
+                                                    const CMatType *restrict a,
+                                                    const CMatType *restrict b, CMatType beta,
+                                                    CMatType *restrict c, size_t rsc, size_t csc) {
+    __m256d acc[6][2];
+#pragma GCC unroll 6
+    for (size_t i = 0; i < 6; ++i) { acc[i][0] = acc[i][1] = _mm256_setzero_pd(); }
+    for (size_t p = 0; p < kc; ++p) {
+        __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+#pragma GCC unroll 6
+        for (size_t i = 0; i < 6; ++i) {
+            __m256d ai = _mm256_broadcast_sd(a + i);
+            acc[i][0]  = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1]  = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += 6;
+        b += 8;
+    }
+    __m256d valpha = _mm256_set1_pd(alpha), vbeta = _mm256_set1_pd(beta);
+    if (csc != 1) {
+        CMatType ab[6 * 8];
+#pragma GCC unroll 6
+        for (size_t i = 0; i < 6; ++i) {
+            _mm256_storeu_pd(ab + i * 8, acc[i][0]);
+            _mm256_storeu_pd(ab + i * 8 + 4, acc[i][1]);
+        }
+        cmat_gemm_store_tile(6, 8, alpha, ab, 8, beta, c, rsc, csc);
+        return;
+    }
+#pragma GCC unroll 6
+    for (size_t i = 0; i < 6; ++i) {
+#pragma GCC unroll 2
+        for (size_t j = 0; j < 2; ++j) {
+            CMatType *cij = c + i * rsc + j * 4;
+            __m256d   res = _mm256_mul_pd(valpha, acc[i][j]);
+            if (beta != 0) { res = _mm256_fmadd_pd(vbeta, _mm256_loadu_pd(cij), res); }
+            _mm256_storeu_pd(cij, res);
+        }
+    }
+}
+// 12x16 register tile: 12 rows of 2 zmm accumulators (24 of the 32 zmm registers)
+CMAT_TARGET_AVX512 static void cmat_gemm_ukernel_avx512(size_t kc, CMatType alpha,
+                                                        const CMatType *restrict a,
+                                                        const CMatType *restrict b, CMatType beta,
+                                                        CMatType *restrict c, size_t rsc,
+                                                        size_t csc) {
+    __m512d acc[12][2];
+#pragma GCC unroll 12
+    for (size_t i = 0; i < 12; ++i) { acc[i][0] = acc[i][1] = _mm512_setzero_pd(); }
+    for (size_t p = 0; p < kc; ++p) {
+        __m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8);
+#pragma GCC unroll 12
+        for (size_t i = 0; i < 12; ++i) {
+            __m512d ai = _mm512_set1_pd(a[i]);
+            acc[i][0]  = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1]  = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += 12;
+        b += 16;
+    }
+    __m512d valpha = _mm512_set1_pd(alpha), vbeta = _mm512_set1_pd(beta);
+    if (csc != 1) {
+        CMatType ab[12 * 16];
+#pragma GCC unroll 12
+        for (size_t i = 0; i < 12; ++i) {
+            _mm512_storeu_pd(ab + i * 16, acc[i][0]);
+            _mm512_storeu_pd(ab + i * 16 + 8, acc[i][1]);
+        }
+        cmat_gemm_store_tile(12, 16, alpha, ab, 16, beta, c, rsc, csc);
+        return;
+    }
+#pragma GCC unroll 12
+    for (size_t i = 0; i < 12; ++i) {
+#pragma GCC unroll 2
+        for (size_t j = 0; j < 2; ++j) {
+            CMatType *cij = c + i * rsc + j * 8;
+            __m512d   res = _mm512_mul_pd(valpha, acc[i][j]);
+            if (beta != 0) { res = _mm512_fmadd_pd(vbeta, _mm512_loadu_pd(cij), res); }
+            _mm512_storeu_pd(cij, res);
+        }
+    }
+}
+
+// transpose a 2x2 block with 2 unpack
+CMAT_TARGET_SSE2 static void cmat_transpose_block_sse2(CMatType *dst, size_t rsd,
+                                                       const CMatType *src, size_t rss) {
+    __m128d r0 = _mm_loadu_pd(src), r1 = _mm_loadu_pd(src + rss);
+    _mm_storeu_pd(dst, _mm_unpacklo_pd(r0, r1));
+    _mm_storeu_pd(dst + rsd, _mm_unpackhi_pd(r0, r1));
+}
+// transpose a 4x4 block with 4 unpack and 4 lane permutation
+CMAT_TARGET_AVX2 static void cmat_transpose_block_avx2(CMatType *dst, size_t rsd,
+                                                       const CMatType *src, size_t rss) {
+    __m256d r0 = _mm256_loadu_pd(src), r1 = _mm256_loadu_pd(src + rss);
+    __m256d r2 = _mm256_loadu_pd(src + 2 * rss), r3 = _mm256_loadu_pd(src + 3 * rss);
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1); // r0[0] r1[0] r0[2] r1[2]
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1); // r0[1] r1[1] r0[3] r1[3]
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3); // r2[0] r3[0] r2[2] r3[2]
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3); // r2[1] r3[1] r2[3] r3[3]
+    _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + rsd, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * rsd, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * rsd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+// transpose a 8x8 block with 8 unpack and 2 rounds of 8 128-bit lane shuffles
+CMAT_TARGET_AVX512 static void cmat_transpose_block_avx512(CMatType *dst, size_t rsd,
+                                                           const CMatType *src, size_t rss) {
+    __m512d t[8], u[8];
+#pragma GCC unroll 4
+    for (size_t i = 0; i < 4; ++i) {
+        __m512d r0 = _mm512_loadu_pd(src + 2 * i * rss);
+        __m512d r1 = _mm512_loadu_pd(src + (2 * i + 1) * rss);
+        t[2 * i]     = _mm512_unpacklo_pd(r0, r1); // r0[0] r1[0] r0[2] r1[2] ... r0[6] r1[6]
+        t[2 * i + 1] = _mm512_unpackhi_pd(r0, r1); // r0[1] r1[1] r0[3] r1[3] ... r0[7] r1[7]
+    }
+    // u[0] = r0[0] r1[0] r0[4] r1[4] r2[0] r3[0] r2[4] r3[4], u[1] the same with 2 and 6
+    u[0] = _mm512_shuffle_f64x2(t[0], t[2], 0x88), u[1] = _mm512_shuffle_f64x2(t[0], t[2], 0xdd);
+    u[2] = _mm512_shuffle_f64x2(t[1], t[3], 0x88), u[3] = _mm512_shuffle_f64x2(t[1], t[3], 0xdd);
+    u[4] = _mm512_shuffle_f64x2(t[4], t[6], 0x88), u[5] = _mm512_shuffle_f64x2(t[4], t[6], 0xdd);
+    u[6] = _mm512_shuffle_f64x2(t[5], t[7], 0x88), u[7] = _mm512_shuffle_f64x2(t[5], t[7], 0xdd);
+    _mm512_storeu_pd(dst, _mm512_shuffle_f64x2(u[0], u[4], 0x88));
+    _mm512_storeu_pd(dst + rsd, _mm512_shuffle_f64x2(u[2], u[6], 0x88));
+    _mm512_storeu_pd(dst + 2 * rsd, _mm512_shuffle_f64x2(u[1], u[5], 0x88));
+    _mm512_storeu_pd(dst + 3 * rsd, _mm512_shuffle_f64x2(u[3], u[7], 0x88));
+    _mm512_storeu_pd(dst + 4 * rsd, _mm512_shuffle_f64x2(u[0], u[4], 0xdd));
+    _mm512_storeu_pd(dst + 5 * rsd, _mm512_shuffle_f64x2(u[2], u[6], 0xdd));
+    _mm512_storeu_pd(dst + 6 * rsd, _mm512_shuffle_f64x2(u[1], u[5], 0xdd));
+    _mm512_storeu_pd(dst + 7 * rsd, _mm512_shuffle_f64x2(u[3], u[7], 0xdd));
+}
+
+static const CMatKernels cmat_kernels_sse2 = {
+    .isa             = CMAT_ISA_SSE2,
+    .mr              = 4,
+    .nr              = 4,
+    .gemm_ukernel    = cmat_gemm_ukernel_sse2,
+    .tb              = 2,
+    .transpose_block = cmat_transpose_block_sse2,
+    .add             = cmat_add_sse2,
+    .sub             = cmat_sub_sse2,
+    .mul             = cmat_mul_sse2,
+    .scale           = cmat_scale_sse2,
+    .axpy            = cmat_axpy_sse2,
+    .sum             = cmat_sum_sse2,
+    .dot             = cmat_dot_sse2,
+    .max_abs         = cmat_max_abs_sse2,
+};
+static const CMatKernels cmat_kernels_avx2 = {
+    .isa             = CMAT_ISA_AVX2,
+    .mr              = 6,
+    .nr              = 8,
+    .gemm_ukernel    = cmat_gemm_ukernel_avx2,
+    .tb              = 4,
+    .transpose_block = cmat_transpose_block_avx2,
+    .add             = cmat_add_avx2,
+    .sub             = cmat_sub_avx2,
+    .mul             = cmat_mul_avx2,
+    .scale           = cmat_scale_avx2,
+    .axpy            = cmat_axpy_avx2,
+    .sum             = cmat_sum_avx2,
+    .dot             = cmat_dot_avx2,
+    .max_abs         = cmat_max_abs_avx2,
+};
+static const CMatKernels cmat_kernels_avx512 = {
+    .isa             = CMAT_ISA_AVX512,
+    .mr              = 12,
+    .nr              = 16,
+    .gemm_ukernel    = cmat_gemm_ukernel_avx512,
+    .tb              = 8,
+    .transpose_block = cmat_transpose_block_avx512,
+    .add             = cmat_add_avx512,
+    .sub             = cmat_sub_avx512,
+    .mul             = cmat_mul_avx512,
+    .scale           = cmat_scale_avx512,
+    .axpy            = cmat_axpy_avx512,
+    .sum             = cmat_sum_avx512,
+    .dot             = cmat_dot_avx512,
+    .max_abs         = cmat_max_abs_avx512,
+};
+#endif // CMAT_X86_SIMD
+
+// NULL until the first kernel is used, always read and written with __atomic so the threads doing
+// the first calls concurrently agree on the kernels
+static const CMatKernels *cmat_kernels = NULL;
+
+CMatIsa CMat_isa_detect(void) {
+#ifdef CMAT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) { return CMAT_ISA_AVX512; }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return CMAT_ISA_AVX2; }
+    if (__builtin_cpu_supports("sse2")) { return CMAT_ISA_SSE2; }
+#endif // CMAT_X86_SIMD
+    return CMAT_ISA_SCALAR;
+}
+// the kernels of isa lowered to CMat_isa_detect()
+static const CMatKernels *cmat_isa_kernels(CMatIsa isa) {
+    CMatIsa best = CMat_isa_detect();
+    if (isa > best) { isa = best; }
+
+    switch (isa) {
+#ifdef CMAT_X86_SIMD
+    case CMAT_ISA_AVX512: return &cmat_kernels_avx512;
+    case CMAT_ISA_AVX2: return &cmat_kernels_avx2;
+    case CMAT_ISA_SSE2: return &cmat_kernels_sse2;
+#endif // CMAT_X86_SIMD
+    default: return &cmat_kernels_scalar;
+    }
+}
+CMatIsa CMat_isa_set(CMatIsa isa) {
+    const CMatKernels *kern = cmat_isa_kernels(isa);
+    __atomic_store_n(&cmat_kernels, kern, __ATOMIC_RELEASE);
+    return kern->isa;
+}
+// the kernels of the selected instruction set
+static const CMatKernels *cmat_get_kernels(void) {
+    const CMatKernels *kern = __atomic_load_n(&cmat_kernels, __ATOMIC_ACQUIRE);
+    if (kern) { return kern; }
+
+    // first use: the first thread to publish its kernels win, CMat_isa_set is never overwritten
+    const CMatKernels *detected = cmat_isa_kernels(CMat_isa_detect());
+    kern                        = NULL;
+    if (__atomic_compare_exchange_n(&cmat_kernels, &kern, detected, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        return detected;
+    }
+    return kern;
+}
+CMatIsa CMat_isa_get(void) { return cmat_get_kernels()->isa; }
+const char *CMat_isa_name(CMatIsa isa) {
+    switch (isa) {
+    case CMAT_ISA_SSE2: return "sse2";
+    case CMAT_ISA_AVX2: return "avx2";
+    case CMAT_ISA_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// pack a mc x kc block of a into micro-panels of mr rows (the last one padded with zero)
+static void cmat_gemm_pack_a(CMatType *restrict dst, const CMatType *restrict a, ptrdiff_t rsa,
+                             ptrdiff_t csa, size_t mc, size_t kc, size_t mr) {
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t m = CMAT_MIN(mr, mc - ir);
+        for (size_t p = 0; p < kc; ++p) {
+            const CMatType *src = a + (ptrdiff_t)ir * rsa + (ptrdiff_t)p * csa;
+            size_t          i   = 0;
+            for (; i < m; ++i) { dst[i] = src[(ptrdiff_t)i * rsa]; }
+            for (; i < mr; ++i) { dst[i] = 0; }
+            dst += mr;
+        }
+    }
+}
+// pack a kc x nc block of b into micro-panels of nr columns (the last one padded with zero)
+static void cmat_gemm_pack_b(CMatType *restrict dst, const CMatType *restrict b, ptrdiff_t rsb,
+                             ptrdiff_t csb, size_t kc, size_t nc, size_t nr) {
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t n = CMAT_MIN(nr, nc - jr);
+        for (size_t p = 0; p < kc; ++p) {
+            const CMatType *src = b + (ptrdiff_t)p * rsb + (ptrdiff_t)jr * csb;
+            size_t          j   = 0;
+            for (; j < n; ++j) { dst[j] = src[(ptrdiff_t)j * csb]; }
+            for (; j < nr; ++j) { dst[j] = 0; }
+            dst += nr;
+        }
+    }
+}
+
+// multiply a packed mc x kc block by a packed kc x nc panel into c, partial tiles on the edges go
+// through a temporary tile so the micro-kernel only ever see full tiles
+static void cmat_gemm_macro_kernel(const CMatKernels *k, size_t mc, size_t nc, size_t kc,
+                                   CMatType alpha, const CMatType *pa, const CMatType *pb,
+                                   CMatType beta, CMatType *c, size_t rsc, size_t csc) {
+    for (size_t jr = 0; jr < nc; jr += k->nr) {
+        size_t n = CMAT_MIN(k->nr, nc - jr);
+        for (size_t ir = 0; ir < mc; ir += k->mr) {
+            size_t          m     = CMAT_MIN(k->mr, mc - ir);
+            const CMatType *a     = pa + ir * kc;
+            const CMatType *b     = pb + jr * kc;
+            CMatType       *ctile = c + ir * rsc + jr * csc;
+            if (m == k->mr && n == k->nr) {
+                k->gemm_ukernel(kc, alpha, a, b, beta, ctile, rsc, csc);
+                continue;
+            }
+            CMatType tmp[CMAT_GEMM_TILE_MAX];
+            k->gemm_ukernel(kc, alpha, a, b, 0, tmp, k->nr, 1);
+            cmat_gemm_store_tile(m, n, 1, tmp, k->nr, beta, ctile, rsc, csc);
+        }
+    }
+}
+
+// a task of a parallel job, worker is the index of the thread running it (0 is the calling thread)
+typedef void (*CMatTaskFn)(void *ctx, size_t task, size_t worker);
+
+static size_t cmat_parallel_threshold = CMAT_PARALLEL_THRESHOLD;
+
+void CMat_set_parallel_threshold(size_t threshold) { cmat_parallel_threshold = threshold; }
+size_t CMat_get_parallel_threshold(void) { return cmat_parallel_threshold; }
+
+#ifndef CMAT_NO_THREADS
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif // _WIN32
+
+// the tasks [begin, end) a thread still have to run, the owner pop from begin and the other threads
+// steal half of what is left from end
+typedef struct {
+    pthread_mutex_t lock;
+    size_t          begin;
+    size_t          end;
+    CMatType       *scratch;      // aligned on a cache line, reused by every job
+    void           *scratch_raw;  // the pointer to free
+    size_t          scratch_size; // number of CMatType in scratch
+} CMatWorkerSlot;
+
+static struct {
+    bool            init;
+    size_t          num_threads; // 0 until CMat_set_num_threads, then the calling thread included
+    pthread_t      *threads;
+    CMatWorkerSlot *slots;
+    pthread_mutex_t lock; // protect generation, shutdown and running
+    pthread_cond_t  wake; // signaled when a job start
+    pthread_cond_t  done; // signaled when the last worker finish a job
+    pthread_mutex_t busy; // held by the thread running a job so concurrent callers go serial
+    size_t          generation;
+    bool            shutdown;
+    size_t          running;
+    CMatTaskFn      fn;
+    void           *ctx;
+} cmat_pool;
+
+// protect the creation of the thread pool when several threads call cmat at the same time
+static pthread_mutex_t cmat_pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+// true in the worker threads and in a thread running a job so nested calls stay serial
+static _Thread_local bool cmat_in_pool = false;
+
+static size_t cmat_num_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (size_t)num_cpus : 1;
+#endif // _WIN32
+}
+
+// get a task of the current job for the thread self, from its own range first then stolen from
+// another thread, false when there is no task left
+static bool cmat_pool_next_task(size_t self, size_t *task) {
+    CMatWorkerSlot *own = &cmat_pool.slots[self];
+    pthread_mutex_lock(&own->lock);
+    bool found = own->begin < own->end;
+    if (found) { *task = own->begin++; }
+    pthread_mutex_unlock(&own->lock);
+    if (found) { return true; }
+
+    for (size_t i = 1; i < cmat_pool.num_threads; ++i) {
+        CMatWorkerSlot *victim = &cmat_pool.slots[(self + i) % cmat_pool.num_threads];
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->begin;
+        size_t end  = victim->end;
+        if (victim->begin < victim->end) { victim->end -= (left + 1) / 2; }
+        size_t begin = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+        if (begin >= end) { continue; }
+
+        *task = begin;
+        pthread_mutex_lock(&own->lock);
+        own->begin = begin + 1;
+        own->end   = end;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    return false;
+}
+static void cmat_pool_work(size_t self) {
+    size_t task;
+    while (cmat_pool_next_task(self, &task)) { cmat_pool.fn(cmat_pool.ctx, task, self); }
+}
+static void *cmat_pool_worker(void *arg) {
+    size_t self       = (size_t)(uintptr_t)arg;
+    size_t generation = 0;
+    cmat_in_pool      = true;
+    for (;;) {
+        pthread_mutex_lock(&cmat_pool.lock);
+        while (cmat_pool.generation == generation && !cmat_pool.shutdown) {
+            pthread_cond_wait(&cmat_pool.wake, &cmat_pool.lock);
+        }
+        generation    = cmat_pool.generation;
+        bool shutdown = cmat_pool.shutdown;
+        pthread_mutex_unlock(&cmat_pool.lock);
+        if (shutdown) { return NULL; }
+
+        cmat_pool_work(self);
+
+        pthread_mutex_lock(&cmat_pool.lock);
+        if (--cmat_pool.running == 0) { pthread_cond_signal(&cmat_pool.done); }
+        pthread_mutex_unlock(&cmat_pool.lock);
+    }
+}
+static void cmat_pool_init(void) {
+    if (cmat_pool.num_threads == 0) { cmat_pool.num_threads = cmat_num_cpus(); }
+    size_t num_threads = cmat_pool.num_threads;
+
+    cmat_pool.slots = cmat_malloc(num_threads, sizeof(*cmat_pool.slots));
+    CMAT_ASSERT(cmat_pool.slots, "malloc failed");
+    cmat_pool.threads = cmat_malloc(num_threads, sizeof(*cmat_pool.threads));
+    CMAT_ASSERT(cmat_pool.threads, "malloc failed");
+    for (size_t i = 0; i < num_threads; ++i) {
+        pthread_mutex_init(&cmat_pool.slots[i].lock, NULL);
+        cmat_pool.slots[i].begin        = 0;
+        cmat_pool.slots[i].end          = 0;
+        cmat_pool.slots[i].scratch      = NULL;
+        cmat_pool.slots[i].scratch_raw  = NULL;
+        cmat_pool.slots[i].scratch_size = 0;
+    }
+    pthread_mutex_init(&cmat_pool.lock, NULL);
+    pthread_mutex_init(&cmat_pool.busy, NULL);
+    pthread_cond_init(&cmat_pool.wake, NULL);
+    pthread_cond_init(&cmat_pool.done, NULL);
+    cmat_pool.generation = 0;
+    cmat_pool.shutdown   = false;
+    cmat_pool.running    = 0;
+    // thread 0 is the calling thread
+    for (size_t i = 1; i < num_threads; ++i) {
+        int err = pthread_create(&cmat_pool.threads[i], NULL, cmat_pool_worker,
+                                 (void *)(uintptr_t)i);
+        CMAT_ASSERT(err == 0, "pthread_create failed");
+        (void)err;
+    }
+    cmat_pool.init = true;
+}
+void CMat_threads_deinit(void) {
+    if (!cmat_pool.init) { return; }
+
+    pthread_mutex_lock(&cmat_pool.lock);
+    cmat_pool.shutdown = true;
+    pthread_cond_broadcast(&cmat_pool.wake);
+    pthread_mutex_unlock(&cmat_pool.lock);
+    for (size_t i = 1; i < cmat_pool.num_threads; ++i) { pthread_join(cmat_pool.threads[i], NULL); }
+
+    for (size_t i = 0; i < cmat_pool.num_threads; ++i) {
+        pthread_mutex_destroy(&cmat_pool.slots[i].lock);
+        CMAT_FREE(cmat_pool.slots[i].scratch_raw);
+    }
+    pthread_mutex_destroy(&cmat_pool.lock);
+    pthread_mutex_destroy(&cmat_pool.busy);
+    pthread_cond_destroy(&cmat_pool.wake);
+    pthread_cond_destroy(&cmat_pool.done);
+    CMAT_FREE(cmat_pool.slots);
+    CMAT_FREE(cmat_pool.threads);
+    cmat_pool.init = false;
+}
+void CMat_set_num_threads(size_t num_threads) {
+    CMat_threads_deinit();
+    cmat_pool.num_threads = num_threads ? num_threads : cmat_num_cpus();
+}
+size_t CMat_get_num_threads(void) {
+    if (cmat_pool.num_threads == 0) { cmat_pool.num_threads = cmat_num_cpus(); }
+    return cmat_pool.num_threads;
+}
+
+// a scratch buffer of at least size CMatType aligned on a cache line owned by worker, only valid in
+// a task run by cmat_pool_try_run and kept for the next jobs
+static CMatType *cmat_pool_scratch(size_t worker, size_t size) {
+    CMatWorkerSlot *slot = &cmat_pool.slots[worker];
+    if (slot->scratch_size < size) {
+        CMAT_FREE(slot->scratch_raw);
+        slot->scratch_raw = cmat_malloc(size + 8, sizeof(CMatType));
+        CMAT_ASSERT(slot->scratch_raw, "malloc failed");
+        slot->scratch      = (CMatType *)CMAT_ROUND_UP((uintptr_t)slot->scratch_raw, 64);
+        slot->scratch_size = size;
+    }
+    return slot->scratch;
+}
+
+// run the tasks [0, num_tasks) on the thread pool, false (and nothing run) if the pool have 1
+// thread, if called from a task or if another thread is already running a job
+static bool cmat_pool_try_run(size_t num_tasks, CMatTaskFn fn, void *ctx) {
+    if (cmat_in_pool || CMat_get_num_threads() <= 1 || num_tasks <= 1) { return false; }
+    pthread_mutex_lock(&cmat_pool_init_lock);
+    if (!cmat_pool.init) { cmat_pool_init(); }
+    pthread_mutex_unlock(&cmat_pool_init_lock);
+    if (pthread_mutex_trylock(&cmat_pool.busy) != 0) { return false; }
+    cmat_in_pool = true;
+
+    size_t num_threads = cmat_pool.num_threads;
+    pthread_mutex_lock(&cmat_pool.lock);
+    cmat_pool.fn  = fn;
+    cmat_pool.ctx = ctx;
+    for (size_t i = 0; i < num_threads; ++i) {
+        pthread_mutex_lock(&cmat_pool.slots[i].lock);
+        cmat_pool.slots[i].begin = num_tasks * i / num_threads;
+        cmat_pool.slots[i].end   = num_tasks * (i + 1) / num_threads;
+        pthread_mutex_unlock(&cmat_pool.slots[i].lock);
+    }
+    cmat_pool.running = num_threads - 1;
+    ++cmat_pool.generation;
+    pthread_cond_broadcast(&cmat_pool.wake);
+    pthread_mutex_unlock(&cmat_pool.lock);
+
+    cmat_pool_work(0);
+
+    pthread_mutex_lock(&cmat_pool.lock);
+    while (cmat_pool.running > 0) { pthread_cond_wait(&cmat_pool.done, &cmat_pool.lock); }
+    pthread_mutex_unlock(&cmat_pool.lock);
+
+    cmat_in_pool = false;
+    pthread_mutex_unlock(&cmat_pool.busy);
+    return true;
+}
+#else
+void   CMat_set_num_threads(size_t num_threads) { (void)num_threads; }
+size_t CMat_get_num_threads(void) { return 1; }
+void   CMat_threads_deinit(void) {}
+
+static CMatType *cmat_pool_scratch(size_t worker, size_t size) {
+    (void)worker;
+    (void)size;
+    return NULL;
+}
+static bool cmat_pool_try_run(size_t num_tasks, CMatTaskFn fn, void *ctx) {
+    (void)num_tasks;
+    (void)fn;
+    (void)ctx;
+    return false;
+}
+#endif // CMAT_NO_THREADS
+
+// c = alpha * a . b + beta * c without packing, for products too small to amortize it
+static void cmat_gemm_small(size_t m, size_t n, size_t k, CMatType alpha, const CMatType *a,
+                            ptrdiff_t rsa, ptrdiff_t csa, const CMatType *b, ptrdiff_t rsb,
+                            ptrdiff_t csb, CMatType beta, CMatType *c, size_t rsc, size_t csc) {
+    for (size_t i = 0; i < m; ++i) {
+        CMatType *c_row = c + i * rsc;
+        for (size_t j = 0; j < n; ++j) {
+            c_row[j * csc] = (beta == 0) ? 0 : beta * c_row[j * csc];
+        }
+        for (size_t p = 0; p < k; ++p) {
+            CMatType        x     = alpha * a[(ptrdiff_t)i * rsa + (ptrdiff_t)p * csa];
+            const CMatType *b_row = b + (ptrdiff_t)p * rsb;
+            for (size_t j = 0; j < n; ++j) { c_row[j * csc] += x * b_row[(ptrdiff_t)j * csb]; }
+        }
+    }
+}
+
+// a parallel gemm, every task compute a mc x nc tile of c with its own packing buffers
+typedef struct {
+    const CMatKernels *kern;
+    size_t             m, n, k;
+    CMatType           alpha;
+    const CMatType    *a;
+    ptrdiff_t          rsa, csa;
+    const CMatType    *b;
+    ptrdiff_t          rsb, csb;
+    CMatType           beta;
+    CMatType          *c;
+    size_t             rsc, csc;
+    size_t             mc;      // rows of a tile
+    size_t             nc;      // cols of a tile
+    size_t             kc;      // depth of the packed blocks
+    size_t             ntile_m; // number of tiles in a column of c
+} CMatGemmJob;
+
+static void cmat_gemm_tile_task(void *ctx, size_t task, size_t worker) {
+    const CMatGemmJob *job  = ctx;
+    const CMatKernels *kern = job->kern;
+    size_t             ic   = task % job->ntile_m * job->mc;
+    size_t             jc   = task / job->ntile_m * job->nc;
+    size_t             mc   = CMAT_MIN(job->mc, job->m - ic);
+    size_t             nc   = CMAT_MIN(job->nc, job->n - jc);
+
+    size_t    pa_size = CMAT_ROUND_UP(job->mc * job->kc, 8);
+    CMatType *pa      = cmat_pool_scratch(worker, pa_size + job->kc * job->nc);
+    CMatType *pb      = pa + pa_size;
+    for (size_t pc = 0; pc < job->k; pc += job->kc) {
+        size_t kc = CMAT_MIN(job->kc, job->k - pc);
+        cmat_gemm_pack_b(pb, job->b + (ptrdiff_t)pc * job->rsb + (ptrdiff_t)jc * job->csb,
+                         job->rsb, job->csb, kc, nc, kern->nr);
+        cmat_gemm_pack_a(pa, job->a + (ptrdiff_t)ic * job->rsa + (ptrdiff_t)pc * job->csa,
+                         job->rsa, job->csa, mc, kc, kern->mr);
+        cmat_gemm_macro_kernel(kern, mc, nc, kc, job->alpha, pa, pb, (pc == 0) ? job->beta : 1,
+                               job->c + ic * job->rsc + jc * job->csc, job->rsc, job->csc);
+    }
+}
+
+// c = alpha * a . b + beta * c where the element (i, j) of a matrix x is x[i * rsx + j * csx], so
+// a transposed operand is only a swap of its strides and a reversed one a negative stride (the
+// packing read any layout, c strides are positive)
+static void cmat_gemm_strided(size_t m, size_t n, size_t k, CMatType alpha, const CMatType *a,
+                              ptrdiff_t rsa, ptrdiff_t csa, const CMatType *b, ptrdiff_t rsb,
+                              ptrdiff_t csb, CMatType beta, CMatType *c, size_t rsc, size_t csc) {
+    if (m == 0 || n == 0) { return; }
+    if (k == 0 || alpha == 0 || m == 1 || n == 1 || m * n * k <= CMAT_GEMM_SMALL) {
+        cmat_gemm_small(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+        return;
+    }
+
+    const CMatKernels *kern = cmat_get_kernels();
+    // the cache blocks are rounded down to a multiple of the register tile
+    size_t mc_blk = CMAT_MAX(CMAT_GEMM_MC / kern->mr, 1) * kern->mr;
+    size_t nc_blk = CMAT_MAX(CMAT_GEMM_NC / kern->nr, 1) * kern->nr;
+    size_t mc_max = CMAT_MIN(mc_blk, CMAT_ROUND_UP(m, kern->mr));
+    size_t kc_max = CMAT_MIN(CMAT_GEMM_KC, k);
+    size_t nc_max = CMAT_MIN(nc_blk, CMAT_ROUND_UP(n, kern->nr));
+
+    if (m * n * k > cmat_parallel_threshold && CMat_get_num_threads() > 1) {
+        CMatGemmJob job = {.kern    = kern,
+                           .m       = m,
+                           .n       = n,
+                           .k       = k,
+                           .alpha   = alpha,
+                           .a       = a,
+                           .rsa     = rsa,
+                           .csa     = csa,
+                           .b       = b,
+                           .rsb     = rsb,
+                           .csb     = csb,
+                           .beta    = beta,
+                           .c       = c,
+                           .rsc     = rsc,
+                           .csc     = csc,
+                           .mc      = mc_max,
+                           .nc      = nc_max,
+                           .kc      = kc_max,
+                           .ntile_m = (m + mc_max - 1) / mc_max};
+        // narrow the tiles until every thread get a few of them, the work stealing balance the rest
+        size_t min_tiles = 4 * CMat_get_num_threads();
+        while (job.ntile_m * ((n + job.nc - 1) / job.nc) < min_tiles && job.nc > kern->nr) {
+            job.nc = CMAT_ROUND_UP(job.nc / 2, kern->nr);
+        }
+        if (cmat_pool_try_run(job.ntile_m * ((n + job.nc - 1) / job.nc), cmat_gemm_tile_task,
+                              &job)) {
+            return;
+        }
+    }
+
+    // both buffers start on a cache line (8 CMatType)
+    size_t    pa_size  = CMAT_ROUND_UP(mc_max * kc_max, 8);
+    size_t    buf_size = (pa_size + kc_max * nc_max + 8) * sizeof(CMatType);
+    CMatType *buf      = cmat_scratch_alloc(buf_size);
+    CMatType *pa       = (CMatType *)CMAT_ROUND_UP((uintptr_t)buf, 64);
+    CMatType *pb = pa + pa_size;
+
+    for (size_t jc = 0; jc < n; jc += nc_blk) {
+        size_t nc = CMAT_MIN(nc_blk, n - jc);
+        for (size_t pc = 0; pc < k; pc += CMAT_GEMM_KC) {
+            size_t kc = CMAT_MIN(CMAT_GEMM_KC, k - pc);
+            cmat_gemm_pack_b(pb, b + (ptrdiff_t)pc * rsb + (ptrdiff_t)jc * csb, rsb, csb, kc, nc,
+                             kern->nr);
+            // only the first block of k scale c by beta, the other accumulate
+            CMatType beta_pc = (pc == 0) ? beta : 1;
+            for (size_t ic = 0; ic < m; ic += mc_blk) {
+                size_t mc = CMAT_MIN(mc_blk, m - ic);
+                cmat_gemm_pack_a(pa, a + (ptrdiff_t)ic * rsa + (ptrdiff_t)pc * csa, rsa, csa, mc,
+                                 kc, kern->mr);
+                cmat_gemm_macro_kernel(kern, mc, nc, kc, alpha, pa, pb, beta_pc,
+                                       c + ic * rsc + jc * csc, rsc, csc);
+            }
+        }
+    }
+
+    cmat_scratch_free(buf, buf_size);
+}
+
+void CMat_gemm(CMat *dst, CMatType alpha, const CMat *cmat1, const CMat *cmat2, CMatType beta) {
+    CMAT_ASSERT(cmat1->nrow == dst->nrow, "a->nrow should match with dst->nrow");
+    CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "a->ncol should match with b->nrow");
+    CMAT_ASSERT(cmat2->ncol == dst->ncol, "b->ncol should match with dst->ncol");
+
+    CMAT_STAT_BEGIN();
+    cmat_gemm_strided(dst->nrow, dst->ncol, cmat1->ncol, alpha, cmat1->data, cmat1->stride, 1,
+                      cmat2->data, cmat2->stride, 1, beta, dst->data, dst->stride, 1);
+    CMAT_STAT_END(CMAT_STAT_GEMM, 2.0 * dst->nrow * dst->ncol * cmat1->ncol,
+                  dst->nrow * dst->ncol);
+}
+
+void CMat_dot(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
+    CMAT_STAT_BEGIN();
+    CMat_gemm(dst, 1, cmat1, cmat2, 0);
+    CMAT_STAT_END(CMAT_STAT_DOT, 2.0 * dst->nrow * dst->ncol * cmat1->ncol, dst->nrow * dst->ncol);
+}
+
+void CMatView_gemm(CMatView *dst, CMatType alpha, const CMatView *cmat1, const CMatView *cmat2,
+                   CMatType beta) {
+    CMAT_ASSERT(cmat1->nrow == dst->nrow, "a->nrow should match with dst->nrow");
+    CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "a->ncol should match with b->nrow");
+    CMAT_ASSERT(cmat2->ncol == dst->ncol, "b->ncol should match with dst->ncol");
+
+    CMAT_STAT_BEGIN();
+    CMatView c = *dst, a = *cmat1, b = *cmat2;
+    // the micro-kernel write the rows of c, a transposed dst compute c^T = b^T . a^T instead
+    if (c.cs != 1 && (c.rs == 1 || c.rs == -1)) {
+        CMatView tmp = CMatView_transpose(&b);
+        b            = CMatView_transpose(&a);
+        a            = tmp;
+        c            = CMatView_transpose(&c);
+    }
+    // c need positive strides: the same product with the rows or the cols of c in reverse order
+    if (c.rs < 0) {
+        c = CMatView_reverse_rows(&c);
+        a = CMatView_reverse_rows(&a);
+    }
+    if (c.cs < 0) {
+        c = CMatView_reverse_cols(&c);
+        b = CMatView_reverse_cols(&b);
+    }
+    cmat_gemm_strided(c.nrow, c.ncol, a.ncol, alpha, a.data, a.rs, a.cs, b.data, b.rs, b.cs, beta,
+                      c.data, (size_t)c.rs, (size_t)c.cs);
+    CMAT_STAT_END(CMAT_STAT_VIEW_GEMM, 2.0 * dst->nrow * dst->ncol * cmat1->ncol,
+                  dst->nrow * dst->ncol);
+}
+void CMatView_dot(CMatView *dst, const CMatView *cmat1, const CMatView *cmat2) {
+    CMatView_gemm(dst, 1, cmat1, cmat2, 0);
+}
+
+// define CMAT_TRANSPOSE_TILE before including cmat to change the size of the square tiles
+// CMat_transpose read and write so both fit in L1
+#ifndef CMAT_TRANSPOSE_TILE
+#define CMAT_TRANSPOSE_TILE 32
+#endif // CMAT_TRANSPOSE_TILE
+
+// transpose the tile src[row0:row_end, col0:col_end] into dst with blocks of the kernel
+static void cmat_transpose_tile(const CMatKernels *kern, CMat *dst, const CMat *src, size_t row0,
+                                size_t row_end, size_t col0, size_t col_end) {
+    size_t tb  = kern->tb;
+    size_t row = row0;
+    for (; row + tb <= row_end; row += tb) {
+        size_t col = col0;
+        for (; col + tb <= col_end; col += tb) {
+            kern->transpose_block(CMat_pat(dst, col, row), dst->stride, CMat_pat(src, row, col),
+                                  src->stride);
+        }
+        for (; col < col_end; ++col) {
+            for (size_t i = row; i < row + tb; ++i) { CMat_at(dst, col, i) = CMat_at(src, i, col); }
+        }
+    }
+    for (; row < row_end; ++row) {
+        for (size_t col = col0; col < col_end; ++col) {
+            CMat_at(dst, col, row) = CMat_at(src, row, col);
+        }
+    }
+}
+// cut the biggest side of src[row0:row_end, col0:col_end] in 2 until it fit in a tile so every
+// level of cache get blocks that fit in it (cache-oblivious)
+static void cmat_transpose_rec(const CMatKernels *kern, CMat *dst, const CMat *src, size_t row0,
+                               size_t row_end, size_t col0, size_t col_end) {
+    size_t nrow = row_end - row0, ncol = col_end - col0;
+    if (nrow <= CMAT_TRANSPOSE_TILE && ncol <= CMAT_TRANSPOSE_TILE) {
+        cmat_transpose_tile(kern, dst, src, row0, row_end, col0, col_end);
+    } else if (nrow >= ncol) {
+        size_t mid = row0 + CMAT_ROUND_UP(nrow / 2, CMAT_TRANSPOSE_TILE);
+        cmat_transpose_rec(kern, dst, src, row0, mid, col0, col_end);
+        cmat_transpose_rec(kern, dst, src, mid, row_end, col0, col_end);
+    } else {
+        size_t mid = col0 + CMAT_ROUND_UP(ncol / 2, CMAT_TRANSPOSE_TILE);
+        cmat_transpose_rec(kern, dst, src, row0, row_end, col0, mid);
+        cmat_transpose_rec(kern, dst, src, row0, row_end, mid, col_end);
+    }
+}
+
+void CMat_transpose(CMat *dst, const CMat *src) {
+    CMAT_ASSERT(dst->nrow == src->ncol, "dst->nrow should be == to src->ncol");
+    CMAT_ASSERT(dst->ncol == src->nrow, "dst->ncol should be == to src->nrow");
+
+    CMAT_STAT_BEGIN();
+    cmat_transpose_rec(cmat_get_kernels(), dst, src, 0, src->nrow, 0, src->ncol);
+    CMAT_STAT_END(CMAT_STAT_TRANSPOSE, 0, dst->nrow * dst->ncol);
+}
+
+// swap the nrow x ncol block a with the transpose of the ncol x nrow block b (both with the row
+// stride ld), if a == b (a square tile on the diagonal) only its upper triangle is swapped with
+// its lower triangle
+static void cmat_transpose_swap(const CMatKernels *kern, CMatType *a, CMatType *b, size_t ld,
+                                size_t nrow, size_t ncol) {
+    CMatType tmp[CMAT_TRANSPOSE_BLOCK_MAX * CMAT_TRANSPOSE_BLOCK_MAX];
+    size_t   tb   = kern->tb;
+    bool     diag = a == b;
+    size_t   row  = 0;
+    for (; row + tb <= nrow; row += tb) {
+        size_t col = diag ? row : 0;
+        for (; col + tb <= ncol; col += tb) {
+            CMatType *block_a = a + row * ld + col;
+            CMatType *block_b = b + col * ld + row;
+            kern->transpose_block(tmp, tb, block_a, ld);
+            if (block_a != block_b) { kern->transpose_block(block_a, ld, block_b, ld); }
+            for (size_t i = 0; i < tb; ++i) {
+                for (size_t j = 0; j < tb; ++j) { block_b[i * ld + j] = tmp[i * tb + j]; }
+            }
+        }
+        for (; col < ncol; ++col) {
+            for (size_t i = row; i < row + tb; ++i) {
+                CMatType temp   = a[i * ld + col];
+                a[i * ld + col] = b[col * ld + i];
+                b[col * ld + i] = temp;
+            }
+        }
+    }
+    for (; row < nrow; ++row) {
+        for (size_t col = diag ? row + 1 : 0; col < ncol; ++col) {
+            CMatType temp     = a[row * ld + col];
+            a[row * ld + col] = b[col * ld + row];
+            b[col * ld + row] = temp;
+        }
+    }
+}
+
+void CMat_transpose_inplace(CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "in place transpose only defined for square matrix");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n    = cmat->nrow;
+    // swap every tile of the upper triangle with its mirror (a tile on the diagonal with itself)
+    for (size_t row0 = 0; row0 < n; row0 += CMAT_TRANSPOSE_TILE) {
+        for (size_t col0 = row0; col0 < n; col0 += CMAT_TRANSPOSE_TILE) {
+            cmat_transpose_swap(kern, CMat_pat(cmat, row0, col0), CMat_pat(cmat, col0, row0),
+                                cmat->stride, CMAT_MIN(CMAT_TRANSPOSE_TILE, n - row0),
+                                CMAT_MIN(CMAT_TRANSPOSE_TILE, n - col0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_TRANSPOSE_INPLACE, 0, n * n);
+}
+
+void CMatView_copy(CMatView *dst, const CMatView *src) {
+    CMAT_ASSERT(dst->nrow == src->nrow && dst->ncol == src->ncol,
+                "dst and src should have the same size");
+
+    CMAT_STAT_BEGIN();
+    if (dst->cs == 1 && src->cs == 1) {
+        for (size_t row = 0; row < dst->nrow; ++row) {
+            CMatType       *d = CMatView_pat(dst, row, 0);
+            const CMatType *s = CMatView_pat(src, row, 0);
+            for (size_t col = 0; col < dst->ncol; ++col) { d[col] = s[col]; }
+        }
+    } else {
+        // by tiles so the side read across its rows stay in L1 (as CMat_transpose)
+        for (size_t row0 = 0; row0 < dst->nrow; row0 += CMAT_TRANSPOSE_TILE) {
+            size_t row_end = CMAT_MIN(row0 + CMAT_TRANSPOSE_TILE, dst->nrow);
+            for (size_t col0 = 0; col0 < dst->ncol; col0 += CMAT_TRANSPOSE_TILE) {
+                size_t col_end = CMAT_MIN(col0 + CMAT_TRANSPOSE_TILE, dst->ncol);
+                for (size_t row = row0; row < row_end; ++row) {
+                    for (size_t col = col0; col < col_end; ++col) {
+                        CMatView_at(dst, row, col) = CMatView_at(src, row, col);
+                    }
+                }
+            }
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_VIEW_COPY, 0, dst->nrow * dst->ncol);
+}
+
+// apply an element-wise kernel row by row (or once if every matrix is contiguous)
+#define CMAT_ELEMWISE3(kernel, dst, cmat1, cmat2)                                                  \
+    do {                                                                                           \
+        CMAT_ASSERT((dst)->nrow == (cmat1)->nrow && (dst)->nrow == (cmat2)->nrow,                  \
+                    "nrow don't match");                                                           \
+        CMAT_ASSERT((dst)->ncol == (cmat1)->ncol && (dst)->ncol == (cmat2)->ncol,                  \
+                    "ncol don't match");                                                           \
+        if ((dst)->stride == (dst)->ncol && (cmat1)->stride == (cmat1)->ncol &&                    \
+            (cmat2)->stride == (cmat2)->ncol) {                                                    \
+            kernel((dst)->nrow * (dst)->ncol, (dst)->data, (cmat1)->data, (cmat2)->data);          \
+        } else {                                                                                   \
+            for (size_t row = 0; row < (dst)->nrow; ++row) {                                       \
+                kernel((dst)->ncol, CMat_pat(dst, row, 0), CMat_pat(cmat1, row, 0),                \
+                       CMat_pat(cmat2, row, 0));                                                   \
+            }                                                                                      \
+        }                                                                                          \
+    } while (0)
+
+void CMat_add(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
+    CMAT_STAT_BEGIN();
+    CMAT_ELEMWISE3(cmat_get_kernels()->add, dst, cmat1, cmat2);
+    CMAT_STAT_END(CMAT_STAT_ADD, dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+void CMat_sub(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
+    CMAT_STAT_BEGIN();
+    CMAT_ELEMWISE3(cmat_get_kernels()->sub, dst, cmat1, cmat2);
+    CMAT_STAT_END(CMAT_STAT_SUB, dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+void CMat_mul(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
+    CMAT_STAT_BEGIN();
+    CMAT_ELEMWISE3(cmat_get_kernels()->mul, dst, cmat1, cmat2);
+    CMAT_STAT_END(CMAT_STAT_MUL, dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+void CMat_scale(CMat *dst, CMatType alpha, const CMat *src) {
+    CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    if (dst->stride == dst->ncol && src->stride == src->ncol) {
+        kern->scale(dst->nrow * dst->ncol, dst->data, alpha, src->data);
+    } else {
+        for (size_t row = 0; row < dst->nrow; ++row) {
+            kern->scale(dst->ncol, CMat_pat(dst, row, 0), alpha, CMat_pat(src, row, 0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_SCALE, dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+void CMat_axpy(CMat *dst, CMatType alpha, const CMat *src) {
+    CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    if (dst->stride == dst->ncol && src->stride == src->ncol) {
+        kern->axpy(dst->nrow * dst->ncol, dst->data, alpha, src->data);
+    } else {
+        for (size_t row = 0; row < dst->nrow; ++row) {
+            kern->axpy(dst->ncol, CMat_pat(dst, row, 0), alpha, CMat_pat(src, row, 0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_AXPY, 2.0 * dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+CMatType CMat_sum(const CMat *cmat) {
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    CMatType           sum  = 0;
+    if (cmat->stride == cmat->ncol) {
+        sum = kern->sum(cmat->nrow * cmat->ncol, cmat->data);
+    } else {
+        for (size_t row = 0; row < cmat->nrow; ++row) {
+            sum += kern->sum(cmat->ncol, CMat_pat(cmat, row, 0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_SUM, cmat->nrow * cmat->ncol, 1);
+    return sum;
+}
+CMatType CMat_inner(const CMat *cmat1, const CMat *cmat2) {
+    CMAT_ASSERT(cmat1->nrow == cmat2->nrow, "nrow don't match");
+    CMAT_ASSERT(cmat1->ncol == cmat2->ncol, "ncol don't match");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    CMatType           sum  = 0;
+    if (cmat1->stride == cmat1->ncol && cmat2->stride == cmat2->ncol) {
+        sum = kern->dot(cmat1->nrow * cmat1->ncol, cmat1->data, cmat2->data);
+    } else {
+        for (size_t row = 0; row < cmat1->nrow; ++row) {
+            sum += kern->dot(cmat1->ncol, CMat_pat(cmat1, row, 0), CMat_pat(cmat2, row, 0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_INNER, 2.0 * cmat1->nrow * cmat1->ncol, 1);
+    return sum;
+}
+CMatType CMat_norm(const CMat *cmat) { return sqrt(CMat_inner(cmat, cmat)); }
+CMatType CMat_max_abs(const CMat *cmat) {
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    CMatType           max  = 0;
+    if (cmat->stride == cmat->ncol) {
+        max = kern->max_abs(cmat->nrow * cmat->ncol, cmat->data);
+    } else {
+        for (size_t row = 0; row < cmat->nrow; ++row) {
+            CMatType row_max = kern->max_abs(cmat->ncol, CMat_pat(cmat, row, 0));
+            if (row_max > max) { max = row_max; }
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_MAX_ABS, cmat->nrow * cmat->ncol, 1);
+    return max;
+}
+
+// the postfix order of the nodes of an expression, every node push its result on a stack
+typedef struct {
+    const CMatExpr *nodes[CMAT_EXPR_MAX_NODES];
+    size_t          nnode;
+    size_t          depth;      // the biggest size of the stack
+    size_t          nop;        // the number of operations (flops per element)
+    bool            contiguous; // every matrix has stride == ncol
+} CMatExprProg;
+static void cmat_expr_compile(CMatExprProg *prog, const CMatExpr *expr, const CMat *dst,
+                              size_t sp) {
+    switch (expr->op) {
+    case CMAT_EXPR_MAT:
+        CMAT_ASSERT(expr->cmat->nrow == dst->nrow && expr->cmat->ncol == dst->ncol,
+                    "every matrix of the expression should have the size of dst");
+        prog->contiguous = prog->contiguous && expr->cmat->stride == expr->cmat->ncol;
+        break;
+    case CMAT_EXPR_VIEW:
+        CMAT_ASSERT(expr->view->nrow == dst->nrow && expr->view->ncol == dst->ncol,
+                    "every matrix of the expression should have the size of dst");
+        prog->contiguous = prog->contiguous && expr->view->cs == 1 &&
+                           expr->view->rs == (ptrdiff_t)expr->view->ncol;
+        break;
+    case CMAT_EXPR_SCALAR: break;
+    case CMAT_EXPR_SCALE:
+        cmat_expr_compile(prog, expr->lhs, dst, sp);
+        ++prog->nop;
+        break;
+    default:
+        cmat_expr_compile(prog, expr->lhs, dst, sp);
+        cmat_expr_compile(prog, expr->rhs, dst, sp + 1);
+        ++prog->nop;
+        break;
+    }
+    CMAT_ASSERT(prog->nnode < CMAT_EXPR_MAX_NODES, "too many nodes in the expression");
+    prog->nodes[prog->nnode++] = expr;
+    prog->depth                = CMAT_MAX(prog->depth, sp + 1);
+}
+// dst[0, n) = the expression on the elements [col, col + n) of the row of its matrices, the
+// result at the position i of the stack is in buf[i * CMAT_EXPR_CHUNK] (a matrix or a view of
+// contiguous rows is only pointed to) and the last node write in dst
+static void cmat_expr_run(const CMatKernels *kern, const CMatExprProg *prog, CMatType *buf,
+                          size_t row, size_t col, size_t n, CMatType *dst) {
+    const CMatType *stack[CMAT_EXPR_MAX_NODES];
+    size_t          sp = 0;
+    for (size_t i = 0; i < prog->nnode; ++i) {
+        const CMatExpr *expr = prog->nodes[i];
+        // a leaf push at sp, an operation replace its operands
+        size_t    pos = expr->op <= CMAT_EXPR_SCALAR  ? sp
+                        : expr->op == CMAT_EXPR_SCALE ? sp - 1
+                                                      : sp - 2;
+        CMatType *out = i + 1 == prog->nnode ? dst : buf + pos * CMAT_EXPR_CHUNK;
+        switch (expr->op) {
+        case CMAT_EXPR_MAT:
+            stack[pos] = CMat_pat(expr->cmat, row, col);
+            if (out == dst) {
+                for (size_t j = 0; j < n; ++j) { dst[j] = stack[pos][j]; }
+            }
+            break;
+        case CMAT_EXPR_VIEW:
+            stack[pos] = CMatView_pat(expr->view, row, col);
+            if (expr->view->cs != 1 || out == dst) {
+                for (size_t j = 0; j < n; ++j) {
+                    out[j] = stack[pos][(ptrdiff_t)j * expr->view->cs];
+                }
+                stack[pos] = out;
+            }
+            break;
+        case CMAT_EXPR_SCALAR:
+            for (size_t j = 0; j < n; ++j) { out[j] = expr->scalar; }
+            stack[pos] = out;
+            break;
+        case CMAT_EXPR_SCALE:
+            kern->scale(n, out, expr->scalar, stack[pos]);
+            stack[pos] = out;
+            break;
+        case CMAT_EXPR_ADD:
+            kern->add(n, out, stack[pos], stack[pos + 1]);
+            stack[pos] = out;
+            break;
+        case CMAT_EXPR_SUB:
+            kern->sub(n, out, stack[pos], stack[pos + 1]);
+            stack[pos] = out;
+            break;
+        case CMAT_EXPR_MUL:
+            kern->mul(n, out, stack[pos], stack[pos + 1]);
+            stack[pos] = out;
+            break;
+        }
+        sp = pos + 1;
+    }
+}
+void CMat_eval(CMat *dst, const CMatExpr *expr) {
+    CMAT_STAT_BEGIN();
+    CMatExprProg prog = {.contiguous = dst->stride == dst->ncol};
+    cmat_expr_compile(&prog, expr, dst, 0);
+
+    // contiguous matrices are a single row
+    size_t nrow = prog.contiguous ? 1 : dst->nrow;
+    size_t ncol = prog.contiguous ? dst->nrow * dst->ncol : dst->ncol;
+
+    const CMatKernels *kern     = cmat_get_kernels();
+    size_t             buf_size = prog.depth * CMAT_EXPR_CHUNK * sizeof(CMatType);
+    CMatType          *buf      = cmat_scratch_alloc(buf_size);
+    for (size_t row = 0; row < nrow; ++row) {
+        for (size_t col = 0; col < ncol; col += CMAT_EXPR_CHUNK) {
+            cmat_expr_run(kern, &prog, buf, row, col, CMAT_MIN(CMAT_EXPR_CHUNK, ncol - col),
+                          CMat_pat(dst, row, col));
+        }
+    }
+    cmat_scratch_free(buf, buf_size);
+    CMAT_STAT_END(CMAT_STAT_EVAL, (double)prog.nop * dst->nrow * dst->ncol, dst->nrow * dst->ncol);
+}
+
+// the 2 x 2 blocks of the even part of a matrix
+#define CMAT_QUADRANT(cmat, i, j, _nrow, _ncol)                                                    \
+    ((CMat){.data   = CMat_pat(cmat, (i) * (_nrow), (j) * (_ncol)),                              \
+            .nrow   = (_nrow),                                                                     \
+            .ncol   = (_ncol),                                                                     \
+            .stride = (cmat)->stride})
+
+static bool cmat_strassen_base(size_t m, size_t k, size_t n) {
+    return CMAT_MIN(m, CMAT_MIN(k, n)) < CMAT_MAX(CMAT_STRASSEN_CROSSOVER, 2);
+}
+size_t CMat_strassen_work(size_t m, size_t k, size_t n) {
+    // a level need X (the sums of cmat1 blocks then P1) and Y (the sums of cmat2 blocks)
+    size_t work = 0;
+    for (; !cmat_strassen_base(m, k, n); m /= 2, k /= 2, n /= 2) {
+        work += m / 2 * CMAT_MAX(k / 2, n / 2) + k / 2 * (n / 2);
+    }
+    return work;
+}
+// a level of Strassen-Winograd with the schedule of Boyer, Dumas, Pernet and Zhou (memory
+// efficient scheduling of Strassen-Winograd's matrix multiplication algorithm, 2009): the 7
+// products go in the blocks of c and the 2 temporaries X and Y, a block of the odd last row or col
+// is a gemm
+static void cmat_strassen_rec(const CMatKernels *kern, CMat *c, const CMat *a, const CMat *b,
+                              CMatType *work) {
+    size_t m = c->nrow, k = a->ncol, n = c->ncol;
+    if (cmat_strassen_base(m, k, n)) {
+        cmat_gemm_strided(m, n, k, 1, a->data, a->stride, 1, b->data, b->stride, 1, 0, c->data,
+                          c->stride, 1);
+        return;
+    }
+
+    size_t m2 = m / 2, k2 = k / 2, n2 = n / 2;
+    CMat   a11 = CMAT_QUADRANT(a, 0, 0, m2, k2), a12 = CMAT_QUADRANT(a, 0, 1, m2, k2);
+    CMat   a21 = CMAT_QUADRANT(a, 1, 0, m2, k2), a22 = CMAT_QUADRANT(a, 1, 1, m2, k2);
+    CMat   b11 = CMAT_QUADRANT(b, 0, 0, k2, n2), b12 = CMAT_QUADRANT(b, 0, 1, k2, n2);
+    CMat   b21 = CMAT_QUADRANT(b, 1, 0, k2, n2), b22 = CMAT_QUADRANT(b, 1, 1, k2, n2);
+    CMat   c11 = CMAT_QUADRANT(c, 0, 0, m2, n2), c12 = CMAT_QUADRANT(c, 0, 1, m2, n2);
+    CMat   c21 = CMAT_QUADRANT(c, 1, 0, m2, n2), c22 = CMAT_QUADRANT(c, 1, 1, m2, n2);
+    CMat   x   = {.data = work, .nrow = m2, .ncol = k2, .stride = k2};
+    CMat   p1  = {.data = work, .nrow = m2, .ncol = n2, .stride = n2};
+    CMat   y   = {.data = work + m2 * CMAT_MAX(k2, n2), .nrow = k2, .ncol = n2, .stride = n2};
+    work       = y.data + k2 * n2;
+
+    CMAT_ELEMWISE3(kern->sub, &x, &a11, &a21);       // S3 = A11 - A21
+    CMAT_ELEMWISE3(kern->sub, &y, &b22, &b12);       // T3 = B22 - B12
+    cmat_strassen_rec(kern, &c21, &x, &y, work);     // P7 = S3 . T3
+    CMAT_ELEMWISE3(kern->add, &x, &a21, &a22);       // S1 = A21 + A22
+    CMAT_ELEMWISE3(kern->sub, &y, &b12, &b11);       // T1 = B12 - B11
+    cmat_strassen_rec(kern, &c22, &x, &y, work);     // P5 = S1 . T1
+    CMAT_ELEMWISE3(kern->sub, &x, &x, &a11);         // S2 = S1 - A11
+    CMAT_ELEMWISE3(kern->sub, &y, &b22, &y);         // T2 = B22 - T1
+    cmat_strassen_rec(kern, &c12, &x, &y, work);     // P6 = S2 . T2
+    CMAT_ELEMWISE3(kern->sub, &x, &a12, &x);         // S4 = A12 - S2
+    cmat_strassen_rec(kern, &c11, &x, &b22, work);   // P3 = S4 . B22
+    cmat_strassen_rec(kern, &p1, &a11, &b11, work);  // P1 = A11 . B11
+    CMAT_ELEMWISE3(kern->add, &c12, &c12, &p1);      // U2 = P1 + P6
+    CMAT_ELEMWISE3(kern->add, &c21, &c21, &c12);     // U3 = U2 + P7
+    CMAT_ELEMWISE3(kern->add, &c12, &c12, &c22);     // U4 = U2 + P5
+    CMAT_ELEMWISE3(kern->add, &c22, &c22, &c21);     // U7 = U3 + P5 (C22)
+    CMAT_ELEMWISE3(kern->add, &c12, &c12, &c11);     // U5 = U4 + P3 (C12)
+    CMAT_ELEMWISE3(kern->sub, &y, &y, &b21);         // T4 = T2 - B21
+    cmat_strassen_rec(kern, &c11, &a22, &y, work);   // P4 = A22 . T4
+    CMAT_ELEMWISE3(kern->sub, &c21, &c21, &c11);     // U6 = U3 - P4 (C21)
+    cmat_strassen_rec(kern, &c11, &a12, &b21, work); // P2 = A12 . B21
+    CMAT_ELEMWISE3(kern->add, &c11, &c11, &p1);      // U1 = P1 + P2 (C11)
+
+    // the odd last col of a and row of b, then the odd last col and row of c
+    if (k % 2) {
+        cmat_gemm_strided(2 * m2, 2 * n2, 1, 1, CMat_pat(a, 0, k - 1), a->stride, 1,
+                          CMat_pat(b, k - 1, 0), b->stride, 1, 1, c->data, c->stride, 1);
+    }
+    if (n % 2) {
+        cmat_gemm_strided(2 * m2, 1, k, 1, a->data, a->stride, 1, CMat_pat(b, 0, n - 1),
+                          b->stride, 1, 0, CMat_pat(c, 0, n - 1), c->stride, 1);
+    }
+    if (m % 2) {
+        cmat_gemm_strided(1, n, k, 1, CMat_pat(a, m - 1, 0), a->stride, 1, b->data, b->stride,
+                          1, 0, CMat_pat(c, m - 1, 0), c->stride, 1);
+    }
+}
+void CMat_strassen_ws(CMat *dst, const CMat *cmat1, const CMat *cmat2, CMatType *work) {
+    CMAT_ASSERT(cmat1->nrow == dst->nrow, "cmat1->nrow should match with dst->nrow");
+    CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "cmat1->ncol should match with cmat2->nrow");
+    CMAT_ASSERT(cmat2->ncol == dst->ncol, "cmat2->ncol should match with dst->ncol");
+
+    CMAT_STAT_BEGIN();
+    cmat_strassen_rec(cmat_get_kernels(), dst, cmat1, cmat2, work);
+    CMAT_STAT_END(CMAT_STAT_STRASSEN, 2.0 * dst->nrow * dst->ncol * cmat1->ncol,
+                  dst->nrow * dst->ncol);
+}
+void CMat_strassen(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
+    size_t work_size = CMat_strassen_work(dst->nrow, cmat1->ncol, dst->ncol);
+    work_size        = CMAT_MAX(work_size, 1) * sizeof(CMatType);
+    CMatType *work   = cmat_scratch_alloc(work_size);
+    CMat_strassen_ws(dst, cmat1, cmat2, work);
+    cmat_scratch_free(work, work_size);
+}
+
+// a product of the tree of CMat_chain_dot, its operands are matrices of the chain or the results
+// of other nodes
+typedef struct {
+    const CMat *lhs, *rhs;
+    CMat        res;
+    size_t      level; // 1 + the level of its deepest operand (a matrix of the chain is 0)
+} CMatChainNode;
+// the nodes are in post order so an operand is always before its product and the last one is
+// the whole chain
+typedef struct {
+    CMatChainNode nodes[CMAT_CHAIN_MAX];
+    size_t        nnode;
+    size_t        nlevel;
+    size_t        work;  // the sum of the sizes of the results except the last one
+    double        flops; // the multiply-adds of the order
+    size_t        split[CMAT_CHAIN_MAX][CMAT_CHAIN_MAX]; // cmats[i..j] = [i..k] . [k+1..j]
+} CMatChainPlan;
+
+// add the nodes of cmats[i..j] to the plan, return its result (the matrix itself for i == j)
+static const CMat *cmat_chain_build(CMatChainPlan *plan, const CMat *cmats, size_t i, size_t j,
+                                    size_t *level) {
+    if (i == j) {
+        *level = 0;
+        return &cmats[i];
+    }
+    size_t         k = plan->split[i][j], lhs_level, rhs_level;
+    const CMat    *lhs = cmat_chain_build(plan, cmats, i, k, &lhs_level);
+    const CMat    *rhs = cmat_chain_build(plan, cmats, k + 1, j, &rhs_level);
+    CMatChainNode *node = &plan->nodes[plan->nnode++];
+    node->lhs           = lhs;
+    node->rhs           = rhs;
+    node->res           = (CMat){.nrow = lhs->nrow, .ncol = rhs->ncol, .stride = rhs->ncol};
+    node->level         = CMAT_MAX(lhs_level, rhs_level) + 1;
+    plan->nlevel        = CMAT_MAX(plan->nlevel, node->level);
+    *level              = node->level;
+    return &node->res;
+}
+// the classic O(count^3) dynamic program on the dims, cost[i][j] is the cheapest cmats[i..j]
+static void cmat_chain_plan(CMatChainPlan *plan, const CMat *cmats, size_t count) {
+    CMAT_ASSERT(count > 0 && count <= CMAT_CHAIN_MAX,
+                "the chain should have 1 to CMAT_CHAIN_MAX matrices");
+    size_t dims[CMAT_CHAIN_MAX + 1];
+    for (size_t i = 0; i < count; ++i) {
+        CMAT_ASSERT((i + 1 == count || cmats[i].ncol == cmats[i + 1].nrow),
+                    "the ncol of a matrix of the chain should match with the nrow of the next");
+        dims[i] = cmats[i].nrow;
+    }
+    dims[count] = cmats[count - 1].ncol;
+
+    double cost[CMAT_CHAIN_MAX][CMAT_CHAIN_MAX];
+    for (size_t i = 0; i < count; ++i) { cost[i][i] = 0; }
+    for (size_t len = 1; len < count; ++len) {
+        for (size_t i = 0; i + len < count; ++i) {
+            size_t j   = i + len;
+            cost[i][j] = INFINITY;
+            for (size_t k = i; k < j; ++k) {
+                double c = cost[i][k] + cost[k + 1][j] +
+                           (double)dims[i] * (double)dims[k + 1] * (double)dims[j + 1];
+                if (c < cost[i][j]) {
+                    cost[i][j]        = c;
+                    plan->split[i][j] = k;
+                }
+            }
+        }
+    }
+
+    size_t level;
+    plan->nnode  = 0;
+    plan->nlevel = 0;
+    plan->flops  = cost[0][count - 1];
+    cmat_chain_build(plan, cmats, 0, count - 1, &level);
+    plan->work = 0;
+    for (size_t i = 0; i + 1 < plan->nnode; ++i) {
+        plan->work += plan->nodes[i].res.nrow * plan->nodes[i].res.ncol;
+    }
+}
+
+size_t CMat_chain_work(const CMat *cmats, size_t count) {
+    CMatChainPlan plan;
+    cmat_chain_plan(&plan, cmats, count);
+    return plan.work;
+}
+
+// res = lhs . rhs with the internal gemm so a product done by a worker isn't counted again as
+// a CMat_dot under CMAT_INSTRUMENT
+static void cmat_chain_node_dot(CMatChainNode *node) {
+    cmat_gemm_strided(node->res.nrow, node->res.ncol, node->lhs->ncol, 1, node->lhs->data,
+                      (ptrdiff_t)node->lhs->stride, 1, node->rhs->data,
+                      (ptrdiff_t)node->rhs->stride, 1, 0, node->res.data, node->res.stride, 1);
+}
+// the nodes of a level computed concurrently, each with a serial gemm
+typedef struct {
+    CMatChainNode *nodes[CMAT_CHAIN_MAX];
+    size_t         count;
+} CMatChainJob;
+static void cmat_chain_task(void *ctx, size_t task, size_t worker) {
+    (void)worker;
+    CMatChainNode *node = ((CMatChainJob *)ctx)->nodes[task];
+    cmat_chain_node_dot(node);
+}
+
+void CMat_chain_dot_ws(CMat *dst, const CMat *cmats, size_t count, CMatType *work) {
+    CMAT_STAT_BEGIN();
+    CMatChainPlan plan;
+    cmat_chain_plan(&plan, cmats, count);
+    CMAT_ASSERT(dst->nrow == cmats[0].nrow && dst->ncol == cmats[count - 1].ncol,
+                "dst should be cmats[0].nrow x cmats[count - 1].ncol");
+
+    if (count == 1) {
+        CMat_iterate2(dst, &cmats[0], row, col, d, s, *d = *s;);
+    } else {
+        for (size_t i = 0; i + 1 < plan.nnode; ++i) {
+            plan.nodes[i].res.data = work;
+            work += plan.nodes[i].res.nrow * plan.nodes[i].res.ncol;
+        }
+        plan.nodes[plan.nnode - 1].res = *dst;
+    }
+
+    for (size_t level = 1; level <= plan.nlevel; ++level) {
+        // the products big enough to be threaded by the gemm are computed one after the other,
+        // the smaller ones of the level together
+        CMatChainJob job = {.count = 0};
+        for (size_t i = 0; i < plan.nnode; ++i) {
+            CMatChainNode *node = &plan.nodes[i];
+            if (node->level != level) { continue; }
+            if (node->res.nrow * node->res.ncol * node->lhs->ncol > cmat_parallel_threshold) {
+                cmat_chain_node_dot(node);
+            } else {
+                job.nodes[job.count++] = node;
+            }
+        }
+        if (!cmat_pool_try_run(job.count, cmat_chain_task, &job)) {
+            for (size_t i = 0; i < job.count; ++i) { cmat_chain_task(&job, i, 0); }
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_CHAIN_DOT, 2.0 * plan.flops, dst->nrow * dst->ncol);
+}
+void CMat_chain_dot(CMat *dst, const CMat *cmats, size_t count) {
+    size_t    work_size = CMAT_MAX(CMat_chain_work(cmats, count), 1) * sizeof(CMatType);
+    CMatType *work      = cmat_scratch_alloc(work_size);
+    CMat_chain_dot_ws(dst, cmats, count, work);
+    cmat_scratch_free(work, work_size);
+}
+
+// swap the columns [col_start, col_end) of the rows row1 and row2
+static void cmat_swap_rows(CMat *cmat, size_t row1, size_t row2, size_t col_start, size_t col_end) {
+    CMatType *a = CMat_pat(cmat, row1, 0), *b = CMat_pat(cmat, row2, 0);
+    for (size_t col = col_start; col < col_end; ++col) {
+        CMatType temp = a[col];
+        a[col]        = b[col];
+        b[col]        = temp;
+    }
+}
+
+// unblocked LU of the panel cmat[start:, start:start + width], the rows are only swapped inside the
+// panel
+static bool cmat_lu_panel(CMat *cmat, size_t *piv, size_t start, size_t width) {
+    const CMatKernels *kern    = cmat_get_kernels();
+    size_t             end     = start + width;
+    bool               regular = true;
+    for (size_t i = start; i < end; ++i) {
+        size_t   pivot     = i;
+        CMatType pivot_abs = fabs(CMat_at(cmat, i, i));
+        for (size_t row = i + 1; row < cmat->nrow; ++row) {
+            CMatType x = fabs(CMat_at(cmat, row, i));
+            if (x > pivot_abs) {
+                pivot     = row;
+                pivot_abs = x;
+            }
+        }
+        piv[i] = pivot;
+        if (pivot_abs == 0) {
+            regular = false;
+            continue;
+        }
+        if (pivot != i) { cmat_swap_rows(cmat, i, pivot, start, end); }
+
+        CMatType inv = 1 / CMat_at(cmat, i, i);
+        for (size_t row = i + 1; row < cmat->nrow; ++row) {
+            CMatType l = CMat_at(cmat, row, i) *= inv;
+            kern->axpy(end - i - 1, CMat_pat(cmat, row, i + 1), -l, CMat_pat(cmat, i, i + 1));
+        }
+    }
+    return regular;
+}
+
+bool CMat_lu(CMat *cmat, size_t *piv) {
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern    = cmat_get_kernels();
+    size_t             m       = cmat->nrow;
+    size_t             n       = cmat->ncol;
+    size_t             mn      = CMAT_MIN(m, n);
+    bool               regular = true;
+
+    for (size_t j = 0; j < mn; j += CMAT_LU_NB) {
+        size_t jb = CMAT_MIN(CMAT_LU_NB, mn - j);
+        regular &= cmat_lu_panel(cmat, piv, j, jb);
+
+        // apply the swaps of the panel to the columns on its left and on its right
+        for (size_t i = j; i < j + jb; ++i) {
+            if (piv[i] == i) { continue; }
+            cmat_swap_rows(cmat, i, piv[i], 0, j);
+            cmat_swap_rows(cmat, i, piv[i], j + jb, n);
+        }
+        if (j + jb >= n) { continue; }
+
+        // U12 = L11^-1 . A12
+        for (size_t row = j + 1; row < j + jb; ++row) {
+            for (size_t i = j; i < row; ++i) {
+                kern->axpy(n - j - jb, CMat_pat(cmat, row, j + jb), -CMat_at(cmat, row, i),
+                           CMat_pat(cmat, i, j + jb));
+            }
+        }
+        // A22 -= L21 . U12
+        if (j + jb < m) {
+            CMat l21 = {.data = CMat_pat(cmat, j + jb, j), .nrow = m - j - jb, .ncol = jb,
+                        .stride = cmat->stride};
+            CMat u12 = {.data = CMat_pat(cmat, j, j + jb), .nrow = jb, .ncol = n - j - jb,
+                        .stride = cmat->stride};
+            CMat a22 = {.data = CMat_pat(cmat, j + jb, j + jb), .nrow = m - j - jb,
+                        .ncol = n - j - jb, .stride = cmat->stride};
+            CMat_gemm(&a22, -1, &l21, &u12, 1);
+        }
+    }
+    // max(m, n) . min(m, n)^2 - min(m, n)^3 / 3
+    CMAT_STAT_END(CMAT_STAT_LU, ((double)CMAT_MAX(m, n) - mn / 3.0) * mn * mn, m * n);
+    return regular;
+}
+
+// define CMAT_TRSM_NB before including cmat to change the size of the diagonal blocks the
+// triangular solves do by substitution before updating the rest with gemm
+#ifndef CMAT_TRSM_NB
+#define CMAT_TRSM_NB 64
+#endif // CMAT_TRSM_NB
+
+// solve t . x = b in place for the n x n triangular matrix t where t[i][j] is t[i * rst + j * cst]
+// (so a transposed t is a swap of the strides), lower or upper, with a diagonal of 1 if unit
+static void cmat_trsm(bool lower, bool unit, const CMatType *t, size_t rst, size_t cst, size_t n,
+                      CMat *b) {
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             nrhs = b->ncol;
+    for (size_t blk = 0; blk < n; blk += CMAT_TRSM_NB) {
+        size_t jb = CMAT_MIN(CMAT_TRSM_NB, n - blk);
+        // lower go down from the first block, upper go up from the last one
+        size_t i0 = lower ? blk : n - blk - jb;
+        size_t i1 = i0 + jb;
+
+        for (size_t k = 0; k < jb; ++k) {
+            size_t row = lower ? i0 + k : i1 - 1 - k;
+            size_t lo  = lower ? i0 : row + 1;
+            size_t hi  = lower ? row : i1;
+            for (size_t i = lo; i < hi; ++i) {
+                kern->axpy(nrhs, CMat_pat(b, row, 0), -t[row * rst + i * cst], CMat_pat(b, i, 0));
+            }
+            if (!unit) {
+                CMatType *b_row = CMat_pat(b, row, 0);
+                kern->scale(nrhs, b_row, 1 / t[row * (rst + cst)], b_row);
+            }
+        }
+
+        // remove the solved block from the rows still to solve
+        if (lower && i1 < n) {
+            cmat_gemm_strided(n - i1, nrhs, jb, -1, t + i1 * rst + i0 * cst, rst, cst,
+                              CMat_pat(b, i0, 0), b->stride, 1, 1, CMat_pat(b, i1, 0), b->stride,
+                              1);
+        } else if (!lower && i0 > 0) {
+            cmat_gemm_strided(i0, nrhs, jb, -1, t + i0 * cst, rst, cst, CMat_pat(b, i0, 0),
+                              b->stride, 1, 1, b->data, b->stride, 1);
+        }
+    }
+}
+
+bool CMat_lu_factor(CMatLU *lu, const CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "LU only defined for square matrix");
+
+    CMat_init(&lu->lu, cmat->nrow, cmat->ncol);
+    CMat_iterate2(&lu->lu, cmat, row, col, dst, src, *dst = *src;);
+    lu->piv = cmat_malloc(cmat->nrow, sizeof(*lu->piv));
+    CMAT_ASSERT(lu->piv, "malloc failed");
+
+    lu->singular = !CMat_lu(&lu->lu, lu->piv);
+    return !lu->singular;
+}
+void CMat_lu_deinit(CMatLU *lu) {
+    CMat_deinit(&lu->lu);
+    CMAT_FREE(lu->piv);
+}
+void CMat_lu_solve(const CMatLU *lu, CMat *b) {
+    CMAT_ASSERT(b->nrow == lu->lu.nrow, "b->nrow should match with the size of the matrix");
+    CMAT_ASSERT(!lu->singular, "the matrix is singular");
+
+    CMAT_STAT_BEGIN();
+    size_t n = lu->lu.nrow;
+    // b = P . b
+    for (size_t i = 0; i < n; ++i) {
+        if (lu->piv[i] != i) { cmat_swap_rows(b, i, lu->piv[i], 0, b->ncol); }
+    }
+    cmat_trsm(true, true, lu->lu.data, lu->lu.stride, 1, n, b);
+    cmat_trsm(false, false, lu->lu.data, lu->lu.stride, 1, n, b);
+    CMAT_STAT_END(CMAT_STAT_LU_SOLVE, 2.0 * n * n * b->ncol, b->nrow * b->ncol);
+}
+void CMat_lu_solve_transpose(const CMatLU *lu, CMat *b) {
+    CMAT_ASSERT(b->nrow == lu->lu.nrow, "b->nrow should match with the size of the matrix");
+    CMAT_ASSERT(!lu->singular, "the matrix is singular");
+
+    CMAT_STAT_BEGIN();
+    size_t n = lu->lu.nrow;
+    // cmat^T = U^T . L^T . P so U^T and L^T are the factors with swapped strides
+    cmat_trsm(true, false, lu->lu.data, 1, lu->lu.stride, n, b);
+    cmat_trsm(false, true, lu->lu.data, 1, lu->lu.stride, n, b);
+    // b = P^T . b
+    for (size_t i = n; i-- > 0;) {
+        if (lu->piv[i] != i) { cmat_swap_rows(b, i, lu->piv[i], 0, b->ncol); }
+    }
+    CMAT_STAT_END(CMAT_STAT_LU_SOLVE, 2.0 * n * n * b->ncol, b->nrow * b->ncol);
+}
+bool CMat_lu_update(CMatLU *lu, CMatType alpha, const CMat *u, const CMat *v) {
+    CMAT_ASSERT(u->nrow == lu->lu.nrow && v->nrow == lu->lu.nrow,
+                "u->nrow and v->nrow should match with the size of the matrix");
+    CMAT_ASSERT(u->ncol == v->ncol, "u and v should have the same number of col");
+    CMAT_ASSERT(!lu->singular, "the matrix is singular");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    CMat              *a    = &lu->lu;
+    size_t             n    = a->nrow;
+    size_t             size = 2 * n * sizeof(CMatType);
+    CMatType          *x    = cmat_scratch_alloc(CMAT_MAX(size, 1));
+    CMatType          *y    = x + n;
+    for (size_t c = 0; c < u->ncol && !lu->singular; ++c) {
+        // P . (cmat + x . y^T) = L . U + (P . x) . y^T
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = alpha * CMat_at(u, i, c);
+            y[i] = CMat_at(v, i, c);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            CMatType temp = x[i];
+            x[i]          = x[lu->piv[i]];
+            x[lu->piv[i]] = temp;
+        }
+        // Bennett: the step j fix the col j of L and the row j of U then remove them from x and y
+        for (size_t j = 0; j < n; ++j) {
+            CMatType *u_row = CMat_pat(a, j, 0);
+            u_row[j] += x[j] * y[j];
+            if (u_row[j] == 0) {
+                lu->singular = true;
+                break;
+            }
+            y[j] /= u_row[j];
+            for (size_t i = j + 1; i < n; ++i) {
+                x[i] -= x[j] * CMat_at(a, i, j);
+                CMat_at(a, i, j) += y[j] * x[i];
+            }
+            // U[j][k] += x[j] * y[k] then y[k] -= y[j] * U[j][k]
+            kern->axpy(n - j - 1, u_row + j + 1, x[j], y + j + 1);
+            kern->axpy(n - j - 1, y + j + 1, -y[j], u_row + j + 1);
+        }
+    }
+    cmat_scratch_free(x, CMAT_MAX(size, 1));
+    CMAT_STAT_END(CMAT_STAT_LU_UPDATE, 4.0 * n * n * u->ncol, n * n);
+    return !lu->singular;
+}
+
+// unblocked Cholesky of the diagonal block cmat[start:start + width, start:start + width] already
+// updated by the columns on its left
+static bool cmat_cholesky_block(CMat *cmat, size_t start, size_t width) {
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t j = start; j < start + width; ++j) {
+        CMatType *row_j = CMat_pat(cmat, j, start);
+        CMatType  d     = CMat_at(cmat, j, j) - kern->dot(j - start, row_j, row_j);
+        if (!(d > 0)) { return false; }
+        CMatType l_jj        = sqrt(d);
+        CMat_at(cmat, j, j) = l_jj;
+        for (size_t i = j + 1; i < start + width; ++i) {
+            CMatType *row_i     = CMat_pat(cmat, i, start);
+            CMat_at(cmat, i, j) = (CMat_at(cmat, i, j) - kern->dot(j - start, row_i, row_j)) / l_jj;
+        }
+    }
+    return true;
+}
+
+bool CMat_cholesky(CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "Cholesky only defined for square matrix");
+
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n    = cmat->nrow;
+    size_t             ld   = cmat->stride;
+    bool               spd  = true;
+    for (size_t j = 0; spd && j < n; j += CMAT_LU_NB) {
+        size_t    jb  = CMAT_MIN(CMAT_LU_NB, n - j);
+        CMatType *l10 = CMat_pat(cmat, j, 0);
+        // A11 -= L10 . L10^T (the whole block so its upper triangle is overwritten, only its lower
+        // triangle is used)
+        cmat_gemm_strided(jb, jb, j, -1, l10, ld, 1, l10, 1, ld, 1, CMat_pat(cmat, j, j), ld, 1);
+        spd = cmat_cholesky_block(cmat, j, jb);
+        if (!spd || j + jb >= n) { continue; }
+
+        // A21 -= L20 . L10^T
+        cmat_gemm_strided(n - j - jb, jb, j, -1, CMat_pat(cmat, j + jb, 0), ld, 1, l10, 1, ld, 1,
+                          CMat_pat(cmat, j + jb, j), ld, 1);
+        // L21 = A21 . L11^-T, row by row: L11 . l^T = a^T
+        for (size_t row = j + jb; row < n; ++row) {
+            CMatType *a = CMat_pat(cmat, row, j);
+            for (size_t col = 0; col < jb; ++col) {
+                a[col] = (a[col] - kern->dot(col, a, CMat_pat(cmat, j + col, j))) /
+                         CMat_at(cmat, j + col, j + col);
+            }
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_CHOLESKY, n * n * (n / 3.0), n * n);
+    return spd;
+}
+bool CMat_cholesky_factor(CMatCholesky *chol, const CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "Cholesky only defined for square matrix");
+
+    CMat_init(&chol->l, cmat->nrow, cmat->ncol);
+    CMat_iterate2(&chol->l, cmat, row, col, dst, src, *dst = *src;);
+    return CMat_cholesky(&chol->l);
+}
+void CMat_cholesky_deinit(CMatCholesky *chol) { CMat_deinit(&chol->l); }
+void CMat_cholesky_solve(const CMatCholesky *chol, CMat *b) {
+    CMAT_ASSERT(b->nrow == chol->l.nrow, "b->nrow should match with the size of the matrix");
+
+    CMAT_STAT_BEGIN();
+    size_t n = chol->l.nrow;
+    // L . y = b then L^T . x = y
+    cmat_trsm(true, false, chol->l.data, chol->l.stride, 1, n, b);
+    cmat_trsm(false, false, chol->l.data, 1, chol->l.stride, n, b);
+    CMAT_STAT_END(CMAT_STAT_CHOLESKY_SOLVE, 2.0 * n * n * b->ncol, b->nrow * b->ncol);
+}
+bool CMat_cholesky_update(CMatCholesky *chol, CMatType alpha, const CMat *x) {
+    CMAT_ASSERT(x->nrow == chol->l.nrow, "x->nrow should match with the size of the matrix");
+
+    CMAT_STAT_BEGIN();
+    CMat     *l    = &chol->l;
+    size_t    n    = l->nrow;
+    CMatType  sign = alpha < 0 ? -1 : 1, scale = sqrt(alpha < 0 ? -alpha : alpha);
+    bool      ok   = true;
+    CMatType *w    = cmat_scratch_alloc(CMAT_MAX(n, 1) * sizeof(CMatType));
+    for (size_t c = 0; c < x->ncol && ok; ++c) {
+        for (size_t i = 0; i < n; ++i) { w[i] = scale * CMat_at(x, i, c); }
+        // the rotation of the step k zero w[k] against L[k][k] and update the col k of L
+        for (size_t k = 0; k < n; ++k) {
+            CMatType l_kk = CMat_at(l, k, k);
+            CMatType r2   = l_kk * l_kk + sign * w[k] * w[k];
+            if (!(r2 > 0)) {
+                ok = false;
+                break;
+            }
+            CMatType r = sqrt(r2), c_k = r / l_kk, s_k = w[k] / l_kk;
+            CMat_at(l, k, k) = r;
+            for (size_t i = k + 1; i < n; ++i) {
+                CMatType *l_ik = CMat_pat(l, i, k);
+                *l_ik          = (*l_ik + sign * s_k * w[i]) / c_k;
+                w[i]           = c_k * w[i] - s_k * *l_ik;
+            }
+        }
+    }
+    cmat_scratch_free(w, CMAT_MAX(n, 1) * sizeof(CMatType));
+    CMAT_STAT_END(CMAT_STAT_CHOLESKY_UPDATE, 4.0 * n * n * x->ncol, n * n);
+    return ok;
+}
+
+// determinant of a square matrix from its LU decomposition done in place
+static CMatType cmat_det_lu(CMat *lu, size_t *piv) {
+    CMat_lu(lu, piv);
+
+    CMatType det = 1;
+    for (size_t i = 0; i < lu->nrow; ++i) {
+        det *= CMat_at(lu, i, i);
+        // every swap flip the sign
+        if (piv[i] != i) { det = -det; }
+    }
+    return det;
+}
+
+// the buffers of a n x n matrix and its pivots on the stack up to CMAT_DET_STACK_MAX, else heap
+// allocated in one block
+typedef struct {
+    CMatType stack_data[CMAT_DET_STACK_MAX * CMAT_DET_STACK_MAX];
+    size_t   stack_piv[CMAT_DET_STACK_MAX];
+    void    *heap;
+    CMat     cmat;
+    size_t  *piv;
+} CMatDetBuf;
+
+static void cmat_det_buf_init(CMatDetBuf *buf, size_t n) {
+    buf->heap = NULL;
+    buf->cmat = (CMat){.data = buf->stack_data, .nrow = n, .ncol = n, .stride = n};
+    buf->piv  = buf->stack_piv;
+    if (n > CMAT_DET_STACK_MAX) {
+        buf->heap = cmat_scratch_alloc(n * n * sizeof(CMatType) + n * sizeof(size_t));
+        buf->cmat.data = buf->heap;
+        buf->piv       = (size_t *)(buf->cmat.data + n * n);
+    }
+}
+static void cmat_det_buf_deinit(CMatDetBuf *buf) {
+    size_t n = buf->cmat.nrow;
+    if (buf->heap) { cmat_scratch_free(buf->heap, n * n * sizeof(CMatType) + n * sizeof(size_t)); }
+}
+
+bool CMat_solve(CMat *b, const CMat *cmat) { return CMatView_solve(b, &CMat_view(cmat)); }
+bool CMatView_solve(CMat *b, const CMatView *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "LU only defined for square matrix");
+
+    // a CMatLU on the buffers of the temporaries
+    CMAT_STAT_BEGIN();
+    CMatDetBuf buf;
+    cmat_det_buf_init(&buf, cmat->nrow);
+    CMatView_copy(&CMat_view(&buf.cmat), cmat);
+
+    CMatLU lu = {.lu = buf.cmat, .piv = buf.piv};
+    lu.singular = !CMat_lu(&lu.lu, lu.piv);
+    if (!lu.singular) { CMat_lu_solve(&lu, b); }
+
+    cmat_det_buf_deinit(&buf);
+    CMAT_STAT_END(CMAT_STAT_SOLVE, b->nrow * b->nrow * (2.0 / 3.0 * b->nrow + 2.0 * b->ncol),
+                  b->nrow * b->ncol);
+    return !lu.singular;
+}
+CMatType CMat_cofactor(const CMat *cmat, size_t row, size_t col) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "the cofactor is only defined for square matrices");
+    CMAT_ASSERT(row < cmat->nrow && col < cmat->ncol, "row, col should be inside the matrix");
+
+    CMatDetBuf buf;
+    cmat_det_buf_init(&buf, cmat->nrow - 1);
+    CMat *submat = &buf.cmat;
+
+    size_t idx = 0;
+    for (size_t i = 0; i < cmat->nrow; ++i) {
+        for (size_t j = 0; j < cmat->ncol; ++j) {
+            if (i == row || j == col) { continue; }
+            // no stride so it's fine
+            submat->data[idx++] = CMat_at(cmat, i, j);
+        }
+    }
+
+    CMatType det = cmat_det_lu(submat, buf.piv);
+
+    cmat_det_buf_deinit(&buf);
+    return ((row + col) % 2 == 0) ? det : -det;
+}
+CMatType CMat_det(const CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "the determinent is only defined for square matrices");
+
+    CMAT_STAT_BEGIN();
+    CMatDetBuf buf;
+    cmat_det_buf_init(&buf, cmat->nrow);
+    CMat_iterate2(&buf.cmat, cmat, row, col, dst, src, *dst = *src;);
+
+    CMatType det = cmat_det_lu(&buf.cmat, buf.piv);
+
+    cmat_det_buf_deinit(&buf);
+    CMAT_STAT_END(CMAT_STAT_DET, 2.0 / 3.0 * cmat->nrow * cmat->nrow * cmat->nrow, 1);
+    return det;
+}
+// the 1 norm of cmat: the max of the sums of the absolute values of its columns, work get ncol
+// values
+static CMatType cmat_norm1(const CMat *cmat, CMatType *work) {
+    for (size_t col = 0; col < cmat->ncol; ++col) { work[col] = 0; }
+    for (size_t row = 0; row < cmat->nrow; ++row) {
+        const CMatType *vals = CMat_pat(cmat, row, 0);
+        for (size_t col = 0; col < cmat->ncol; ++col) { work[col] += fabs(vals[col]); }
+    }
+
+    CMatType norm = 0;
+    for (size_t col = 0; col < cmat->ncol; ++col) { norm = CMAT_MAX(norm, work[col]); }
+    return norm;
+}
+
+// v = v . U in place for the row vector v of size n and the upper triangle U of the block
+// cmat[start:start + n, start:start + n], from the last value so every value of v is read before
+// being overwritten
+static void cmat_row_trmm_upper(const CMat *cmat, CMatType *v, size_t start, size_t n) {
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t k = n; k-- > 0;) {
+        CMatType x = v[k];
+        v[k]       = x * CMat_at(cmat, start + k, start + k);
+        kern->axpy(n - k - 1, v + k + 1, x, CMat_pat(cmat, start + k, start + k + 1));
+    }
+}
+
+// inverse in place of the upper triangle of cmat with a non zero diagonal (the strictly lower
+// triangle is not touched)
+static void cmat_trtri_upper(CMat *cmat) {
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n    = cmat->nrow;
+    size_t             ld   = cmat->stride;
+    for (size_t j = 0; j < n; j += CMAT_LU_NB) {
+        size_t jb = CMAT_MIN(CMAT_LU_NB, n - j);
+
+        // A01 = U00^-1 . A01 top down by block, U00^-1 is already in place and a block only need
+        // the rows below it
+        for (size_t ib = 0; ib < j; ib += CMAT_LU_NB) {
+            size_t ibb = CMAT_MIN(CMAT_LU_NB, j - ib);
+            for (size_t i = ib; i < ib + ibb; ++i) {
+                CMatType *row = CMat_pat(cmat, i, j);
+                kern->scale(jb, row, CMat_at(cmat, i, i), row);
+                for (size_t k = i + 1; k < ib + ibb; ++k) {
+                    kern->axpy(jb, row, CMat_at(cmat, i, k), CMat_pat(cmat, k, j));
+                }
+            }
+            if (ib + ibb < j) {
+                cmat_gemm_strided(ibb, jb, j - ib - ibb, 1, CMat_pat(cmat, ib, ib + ibb), ld, 1,
+                                  CMat_pat(cmat, ib + ibb, j), ld, 1, 1, CMat_pat(cmat, ib, j), ld,
+                                  1);
+            }
+        }
+
+        // A11 = U11^-1 row by row from the bottom: a row is -(1 / u_ii) times its part right of
+        // the diagonal multiplied by the inverse already done below it
+        for (size_t i = j + jb; i-- > j;) {
+            CMatType d = 1 / CMat_at(cmat, i, i);
+            cmat_row_trmm_upper(cmat, CMat_pat(cmat, i, i + 1), i + 1, j + jb - i - 1);
+            kern->scale(j + jb - i - 1, CMat_pat(cmat, i, i + 1), -d, CMat_pat(cmat, i, i + 1));
+            CMat_at(cmat, i, i) = d;
+        }
+
+        // A01 = -A01 . U11^-1 row by row
+        for (size_t row = 0; row < j; ++row) {
+            CMatType *v = CMat_pat(cmat, row, j);
+            cmat_row_trmm_upper(cmat, v, j, jb);
+            kern->scale(jb, v, -1, v);
+        }
+    }
+}
+
+// inverse in place from the LU decomposition of CMat_lu, work get CMAT_INVERSE_WORK(n) values
+static void cmat_inverse_lu(CMat *cmat, const size_t *piv, CMatType *work) {
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n    = cmat->nrow;
+    size_t             ld   = cmat->stride;
+    size_t             nb   = CMAT_MIN(CMAT_LU_NB, n);
+    if (n == 0) { return; }
+
+    cmat_trtri_upper(cmat);
+
+    // solve X . L = U^-1 by block of columns from the right, the strictly lower part of the block
+    // of L is moved to work
+    for (size_t j = (n - 1) / nb * nb;; j -= nb) {
+        size_t jb = CMAT_MIN(nb, n - j);
+        for (size_t i = j; i < n; ++i) {
+            for (size_t c = 0; c < jb; ++c) {
+                bool lower             = i > j + c;
+                work[(i - j) * jb + c] = lower ? CMat_at(cmat, i, j + c) : 0;
+                if (lower) { CMat_at(cmat, i, j + c) = 0; }
+            }
+        }
+
+        // X1 = (U^-1)1 - X2 . L21 then X1 . L11 = X1
+        if (j + jb < n) {
+            cmat_gemm_strided(n, jb, n - j - jb, -1, CMat_pat(cmat, 0, j + jb), ld, 1,
+                              work + jb * jb, jb, 1, 1, CMat_pat(cmat, 0, j), ld, 1);
+        }
+        for (size_t row = 0; row < n; ++row) {
+            CMatType *v = CMat_pat(cmat, row, j);
+            for (size_t k = jb; k-- > 0;) { kern->axpy(k, v, -v[k], work + k * jb); }
+        }
+
+        if (j == 0) { break; }
+    }
+
+    // A^-1 = (P . A)^-1 . P so the swaps of the rows are applied on the columns in reverse order
+    for (size_t i = n; i-- > 0;) {
+        if (piv[i] == i) { continue; }
+        for (size_t row = 0; row < n; ++row) {
+            CMatType *vals = CMat_pat(cmat, row, 0);
+            CMatType  temp = vals[i];
+            vals[i]        = vals[piv[i]];
+            vals[piv[i]]   = temp;
+        }
+    }
+}
+
+bool CMat_inverse_ws(CMat *cmat, size_t *piv, CMatType *work, CMatType *rcond) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "inverse only defined for square matrix");
+
+    CMAT_STAT_BEGIN();
+    CMatType norm    = cmat_norm1(cmat, work);
+    bool     regular = CMat_lu(cmat, piv);
+    if (regular) { cmat_inverse_lu(cmat, piv, work); }
+
+    if (rcond) {
+        CMatType inv_norm = regular ? cmat_norm1(cmat, work) : 0;
+        *rcond            = (norm == 0 || inv_norm == 0) ? 0 : 1 / (norm * inv_norm);
+    }
+    CMAT_STAT_END(CMAT_STAT_INVERSE_WS, 2.0 * cmat->nrow * cmat->nrow * cmat->nrow,
+                  cmat->nrow * cmat->nrow);
+    return regular;
+}
+bool CMat_inverse(CMat *cmat) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "inverse only defined for square matrix");
+
+    // a n x n matrix is enough for the work buffer
+    CMAT_STAT_BEGIN();
+    CMatDetBuf buf;
+    cmat_det_buf_init(&buf, cmat->nrow);
+
+    bool regular = CMat_inverse_ws(cmat, buf.piv, buf.cmat.data, NULL);
+
+    cmat_det_buf_deinit(&buf);
+    CMAT_STAT_END(CMAT_STAT_INVERSE, 2.0 * cmat->nrow * cmat->nrow * cmat->nrow,
+                  cmat->nrow * cmat->nrow);
+    return regular;
+}
+
+bool CMat_inverse_update(CMat *inv, CMatType alpha, const CMat *u, const CMat *v) {
+    CMAT_ASSERT(inv->nrow == inv->ncol, "inverse only defined for square matrix");
+    CMAT_ASSERT(u->nrow == inv->nrow && v->nrow == inv->nrow,
+                "u->nrow and v->nrow should match with the size of the matrix");
+    CMAT_ASSERT(u->ncol == v->ncol, "u and v should have the same number of col");
+
+    CMAT_STAT_BEGIN();
+    size_t n = inv->nrow, k = u->ncol;
+    // inv . u (n x k), v^T . inv (k x n) and the capacitance I + alpha * v^T . inv . u (k x k)
+    size_t    size = (2 * n * k + k * k) * sizeof(CMatType) + k * sizeof(size_t);
+    CMatType *buf  = cmat_scratch_alloc(CMAT_MAX(size, 1));
+    CMat      iu = {.data = buf, .nrow = n, .ncol = k, .stride = k};
+    CMat      vi = {.data = iu.data + n * k, .nrow = k, .ncol = n, .stride = n};
+    CMat      cap = {.data = vi.data + k * n, .nrow = k, .ncol = k, .stride = k};
+    CMatLU    lu  = {.lu = cap, .piv = (size_t *)(cap.data + k * k)};
+
+    CMat_gemm(&iu, 1, inv, u, 0);
+    cmat_gemm_strided(k, n, n, 1, v->data, 1, (ptrdiff_t)v->stride, inv->data,
+                      (ptrdiff_t)inv->stride, 1, 0, vi.data, vi.stride, 1);
+    CMat_iterate(&cap, row, col, val, *val = row == col;);
+    CMat_gemm(&cap, alpha, &vi, u, 1);
+
+    // the updated matrix is singular iff the capacitance is
+    lu.singular = !CMat_lu(&lu.lu, lu.piv);
+    if (!lu.singular) {
+        CMat_lu_solve(&lu, &vi);
+        CMat_gemm(inv, -alpha, &iu, &vi, 1);
+    }
+
+    cmat_scratch_free(buf, CMAT_MAX(size, 1));
+    CMAT_STAT_END(CMAT_STAT_INVERSE_UPDATE, 6.0 * n * n * k, n * n);
+    return !lu.singular;
+}
+
+// the probe of the drift checks, spread in [-1, 1] without a structure shared with usual
+// matrices (the fractional parts of multiples of the golden ratio)
+static void cmat_drift_probe(CMat *b) {
+    for (size_t i = 0; i < b->nrow; ++i) {
+        CMatType t       = (CMatType)(i + 1) * 0.6180339887498949;
+        CMat_at(b, i, 0) = 1 - 2 * (t - floor(t));
+    }
+}
+// |cmat . x - b| / |b| in the max norm
+static CMatType cmat_drift_residual(const CMat *cmat, const CMat *x, const CMat *b) {
+    const CMatKernels *kern = cmat_get_kernels();
+    CMatType           res = 0, norm = 0;
+    for (size_t i = 0; i < b->nrow; ++i) {
+        CMatType r = kern->dot(cmat->ncol, CMat_pat(cmat, i, 0), x->data) - CMat_at(b, i, 0);
+        res        = CMAT_MAX(res, fabs(r));
+        norm       = CMAT_MAX(norm, fabs(CMat_at(b, i, 0)));
+    }
+    return norm == 0 ? 0 : res / norm;
+}
+// the drift of one of the representations (repr) of the inverse of cmat, solve(repr, x, b) put
+// in x the solution of cmat . x = b
+static CMatType cmat_drift(const CMat *cmat, const void *repr,
+                           void (*solve)(const void *repr, CMat *x, const CMat *b)) {
+    size_t    n    = cmat->nrow;
+    size_t    size = CMAT_MAX(2 * n, 1) * sizeof(CMatType);
+    CMatType *buf  = cmat_scratch_alloc(size);
+    CMat      b    = {.data = buf, .nrow = n, .ncol = 1, .stride = 1};
+    CMat      x    = {.data = buf + n, .nrow = n, .ncol = 1, .stride = 1};
+    cmat_drift_probe(&b);
+    solve(repr, &x, &b);
+    CMatType drift = cmat_drift_residual(cmat, &x, &b);
+    cmat_scratch_free(buf, size);
+    return drift;
+}
+static void cmat_drift_solve_inverse(const void *inv, CMat *x, const CMat *b) {
+    CMat_gemm(x, 1, inv, b, 0);
+}
+static void cmat_drift_solve_lu(const void *lu, CMat *x, const CMat *b) {
+    CMat_iterate2(x, b, row, col, dst, src, *dst = *src;);
+    CMat_lu_solve(lu, x);
+}
+static void cmat_drift_solve_cholesky(const void *chol, CMat *x, const CMat *b) {
+    CMat_iterate2(x, b, row, col, dst, src, *dst = *src;);
+    CMat_cholesky_solve(chol, x);
+}
+
+CMatType CMat_inverse_drift(const CMat *inv, const CMat *cmat) {
+    CMAT_ASSERT(inv->nrow == cmat->nrow && inv->ncol == cmat->ncol,
+                "inv and cmat should have the same size");
+    return cmat_drift(cmat, inv, cmat_drift_solve_inverse);
+}
+CMatType CMat_lu_drift(const CMatLU *lu, const CMat *cmat) {
+    return cmat_drift(cmat, lu, cmat_drift_solve_lu);
+}
+CMatType CMat_cholesky_drift(const CMatCholesky *chol, const CMat *cmat) {
+    return cmat_drift(cmat, chol, cmat_drift_solve_cholesky);
+}
+
+// the Householder reflector H = I - tau . v . v^T with v = (1, x) such that H . (alpha, x) =
+// (beta, 0), alpha get beta and x (n - 1 elements spaced by inc) get the rest of v
+static CMatType cmat_householder(size_t n, CMatType *alpha, CMatType *x, size_t inc) {
+    // scaled sum of squares so the norm don't overflow
+    CMatType scale = 0, ssq = 1;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        CMatType val = fabs(x[i * inc]);
+        if (val == 0) { continue; }
+        if (scale < val) {
+            ssq   = 1 + ssq * (scale / val) * (scale / val);
+            scale = val;
+        } else {
+            ssq += (val / scale) * (val / scale);
+        }
+    }
+    CMatType x_norm = scale * sqrt(ssq);
+    if (x_norm == 0) { return 0; }
+
+    CMatType beta = -copysign(hypot(*alpha, x_norm), *alpha);
+    CMatType tau = (beta - *alpha) / beta, inv = 1 / (*alpha - beta);
+    for (size_t i = 0; i + 1 < n; ++i) { x[i * inc] *= inv; }
+    *alpha = beta;
+    return tau;
+}
+
+// the unblocked QR of the cols [j, j + jb) of the rows [j, m) of a, the reflectors are only
+// applied inside the panel, work get jb values
+static void cmat_qr_panel(CMat *a, CMatType *tau, size_t j, size_t jb, CMatType *work) {
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t c = j; c < j + jb; ++c) {
+        tau[c] = cmat_householder(a->nrow - c, CMat_pat(a, c, c), CMat_pat(a, c, c) + a->stride,
+                                  a->stride);
+        size_t w = j + jb - c - 1;
+        if (tau[c] == 0 || w == 0) { continue; }
+
+        // work = v^T . a[c:, c + 1:] then a[c:, c + 1:] -= tau . v . work, row by row
+        CMatType *row_c = CMat_pat(a, c, c + 1);
+        for (size_t k = 0; k < w; ++k) { work[k] = row_c[k]; }
+        for (size_t r = c + 1; r < a->nrow; ++r) {
+            kern->axpy(w, work, CMat_at(a, r, c), CMat_pat(a, r, c + 1));
+        }
+        kern->axpy(w, row_c, -tau[c], work);
+        for (size_t r = c + 1; r < a->nrow; ++r) {
+            kern->axpy(w, CMat_pat(a, r, c + 1), -tau[c] * CMat_at(a, r, c), work);
+        }
+    }
+}
+
+// the block reflector H_j ... H_(j + jb - 1) = I - V . T . V^T of the cols [j, j + jb) of a QR:
+// v get V ((m - j) x jb with its ones and zeros) and t the upper triangular T (jb x jb)
+static void cmat_qr_block(const CMat *qr, const CMatType *tau, size_t j, size_t jb, CMatType *v,
+                          CMatType *t) {
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             mv   = qr->nrow - j;
+    for (size_t r = 0; r < mv; ++r) {
+        const CMatType *row = CMat_pat(qr, j + r, j);
+        for (size_t c = 0; c < jb; ++c) { v[r * jb + c] = r > c ? row[c] : r == c; }
+    }
+    // T[:i, i] = -tau_i . T[:i, :i] . V[:, :i]^T . v_i, V^T . v_i is kept in the lower part
+    for (size_t i = 0; i < jb; ++i) {
+        CMatType *vtv = t + i * jb;
+        for (size_t k = 0; k < i; ++k) { vtv[k] = 0; }
+        for (size_t r = i; r < mv; ++r) { kern->axpy(i, vtv, v[r * jb + i], v + r * jb); }
+        for (size_t k = 0; k < i; ++k) {
+            t[k * jb + i] = -tau[j + i] * kern->dot(i - k, t + k * jb + k, vtv + k);
+        }
+        for (size_t k = 0; k < i; ++k) { vtv[k] = 0; }
+        t[i * jb + i] = tau[j + i];
+    }
+}
+
+// c = (I - V . op(T) . V^T) . c with 3 gemm, op(T) = T^T if trans, work get 2 * jb * c->ncol
+// values
+static void cmat_qr_block_apply(const CMatType *v, const CMatType *t, size_t jb, bool trans,
+                                CMat *c, CMatType *work) {
+    size_t    nc = c->ncol;
+    CMatType *w1 = work, *w2 = work + jb * nc;
+    cmat_gemm_strided(jb, nc, c->nrow, 1, v, 1, (ptrdiff_t)jb, c->data, (ptrdiff_t)c->stride, 1, 0,
+                      w1, nc, 1);
+    cmat_gemm_strided(jb, nc, jb, 1, t, trans ? 1 : (ptrdiff_t)jb, trans ? (ptrdiff_t)jb : 1, w1,
+                      (ptrdiff_t)nc, 1, 0, w2, nc, 1);
+    cmat_gemm_strided(c->nrow, nc, jb, -1, v, (ptrdiff_t)jb, 1, w2, (ptrdiff_t)nc, 1, 1, c->data,
+                      c->stride, 1);
+}
+
+void CMat_qr(CMat *cmat, CMatType *tau) {
+    CMAT_STAT_BEGIN();
+    size_t m = cmat->nrow, n = cmat->ncol, k = CMAT_MIN(m, n);
+    size_t nb = CMAT_MAX(CMAT_MIN(CMAT_QR_NB, k), 1);
+
+    size_t    size = (m * nb + nb * nb + 2 * nb * n) * sizeof(CMatType);
+    CMatType *v    = cmat_scratch_alloc(CMAT_MAX(size, 1));
+    CMatType *t    = v + m * nb;
+    CMatType *work = t + nb * nb;
+    for (size_t j = 0; j < k; j += nb) {
+        size_t jb = CMAT_MIN(nb, k - j);
+        cmat_qr_panel(cmat, tau, j, jb, work);
+        // the reflectors of the panel are applied at once on the cols at its right
+        if (j + jb < n) {
+            cmat_qr_block(cmat, tau, j, jb, v, t);
+            CMat trailing = CMat_from_submat(cmat, j, j + jb, m - j, n - j - jb);
+            cmat_qr_block_apply(v, t, jb, true, &trailing, work);
+        }
+    }
+    cmat_scratch_free(v, CMAT_MAX(size, 1));
+    CMAT_STAT_END(CMAT_STAT_QR, 2.0 * k * k * (3.0 * CMAT_MAX(m, n) - k) / 3.0, m * n);
+}
+void CMat_qr_apply(const CMat *qr, const CMatType *tau, CMat *b, bool transpose) {
+    CMAT_ASSERT(b->nrow == qr->nrow, "b->nrow should match with qr->nrow");
+
+    size_t m = qr->nrow, k = CMAT_MIN(m, qr->ncol);
+    size_t nb = CMAT_MAX(CMAT_MIN(CMAT_QR_NB, k), 1), nblk = (k + nb - 1) / nb;
+
+    size_t    size = (m * nb + nb * nb + 2 * nb * b->ncol) * sizeof(CMatType);
+    CMatType *v    = cmat_scratch_alloc(CMAT_MAX(size, 1));
+    CMatType *t    = v + m * nb;
+    CMatType *work = t + nb * nb;
+    // Q = H_1 ... H_k so Q^T . b apply the first block first and Q . b the last one
+    for (size_t blk = 0; blk < nblk; ++blk) {
+        size_t j  = (transpose ? blk : nblk - 1 - blk) * nb;
+        size_t jb = CMAT_MIN(nb, k - j);
+        cmat_qr_block(qr, tau, j, jb, v, t);
+        CMat rows = CMat_from_submat(b, j, 0, m - j, b->ncol);
+        cmat_qr_block_apply(v, t, jb, transpose, &rows, work);
+    }
+    cmat_scratch_free(v, CMAT_MAX(size, 1));
+}
+void CMat_qr_q(CMat *q, const CMat *qr, const CMatType *tau) {
+    CMAT_ASSERT(q->nrow == qr->nrow && q->ncol <= qr->nrow,
+                "q should have qr->nrow rows and at most as many cols");
+
+    CMat_iterate(q, row, col, val, *val = row == col;);
+    CMat_qr_apply(qr, tau, q, false);
+}
+bool CMat_qr_solve(const CMat *qr, const CMatType *tau, CMat *b) {
+    CMAT_ASSERT(qr->nrow >= qr->ncol, "the least squares need at least as many rows as cols");
+    CMAT_ASSERT(b->nrow == qr->nrow, "b->nrow should match with qr->nrow");
+
+    size_t n = qr->ncol;
+    for (size_t i = 0; i < n; ++i) {
+        if (CMat_at(qr, i, i) == 0) { return false; }
+    }
+    // R . x = (Q^T . b)[:n]
+    CMat_qr_apply(qr, tau, b, true);
+    CMat top = CMat_from_submat(b, 0, 0, n, b->ncol);
+    cmat_trsm(false, false, qr->data, qr->stride, 1, n, &top);
+    return true;
+}
+
+// rows (i, j) of cmat = (c . row_i + s . row_j, c . row_j - s . row_i), nothing if cmat is NULL
+static void cmat_rotate_rows(CMat *cmat, size_t i, size_t j, CMatType c, CMatType s) {
+    if (!cmat) { return; }
+    CMatType *x = CMat_pat(cmat, i, 0), *y = CMat_pat(cmat, j, 0);
+    for (size_t k = 0; k < cmat->ncol; ++k) {
+        CMatType x_k = x[k], y_k = y[k];
+        x[k]         = c * x_k + s * y_k;
+        y[k]         = c * y_k - s * x_k;
+    }
+}
+// the rotation (c, s) such that (c . f + s . g, c . g - s . f) = (r, 0)
+static CMatType cmat_givens(CMatType f, CMatType g, CMatType *c, CMatType *s) {
+    CMatType r = hypot(f, g);
+    *c         = r == 0 ? 1 : f / r;
+    *s         = r == 0 ? 0 : g / r;
+    return r;
+}
+// sort the values and the rows of rows1 and rows2 (can be NULL) with them
+static void cmat_sort_values(size_t n, CMatType *val, bool descending, CMat *rows1, CMat *rows2) {
+    for (size_t i = 0; i < n; ++i) {
+        size_t best = i;
+        for (size_t k = i + 1; k < n; ++k) {
+            if (descending ? val[k] > val[best] : val[k] < val[best]) { best = k; }
+        }
+        if (best == i) { continue; }
+        CMatType temp = val[i];
+        val[i]        = val[best];
+        val[best]     = temp;
+        if (rows1) { cmat_swap_rows(rows1, i, best, 0, rows1->ncol); }
+        if (rows2) { cmat_swap_rows(rows2, i, best, 0, rows2->ncol); }
+    }
+}
+
+// the tridiagonal reduction of the cols [j, j + jb) of the symmetric a (stored whole): v and w
+// ((n - j) x jb) get the vectors such that a[j + jb:, j + jb:] -= V . W^T + W . V^T, the
+// reflectors are also stored under the subdiagonal of a, tmp get 2 * n + jb values
+static void cmat_tridiag_panel(CMat *a, CMatType *d, CMatType *e, CMatType *tau, size_t j,
+                               size_t jb, CMatType *v, CMatType *w, CMatType *tmp) {
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n    = a->nrow;
+    CMatType          *col = tmp, *y = tmp + n, *small = tmp + 2 * n;
+    for (size_t i = 0; i < jb; ++i) {
+        size_t    c   = j + i;
+        CMatType *v_c = v + i * jb, *w_c = w + i * jb;
+        // the col c updated by the previous cols of the panel, read in the row c (not modified
+        // since the start of the panel)
+        for (size_t r = c; r < n; ++r) {
+            CMatType *v_r = v + (r - j) * jb, *w_r = w + (r - j) * jb;
+            col[r - c] = CMat_at(a, c, r) - kern->dot(i, v_r, w_c) - kern->dot(i, w_r, v_c);
+        }
+        d[c]   = col[0];
+        tau[c] = cmat_householder(n - c - 1, &col[1], &col[2], 1);
+        e[c]   = col[1];
+        col[1] = 1;
+        for (size_t r = j; r < n; ++r) { v[(r - j) * jb + i] = r > c ? col[r - c] : 0; }
+        for (size_t r = c + 2; r < n; ++r) { CMat_at(a, r, c) = col[r - c]; }
+
+        // w_i = tau . (A . v - V . W^T . v - W . V^T . v) + alpha . v with A the trailing matrix
+        // of the start of the panel
+        size_t          nr = n - c - 1;
+        const CMatType *vi = col + 1;
+        for (size_t r = 0; r < nr; ++r) { y[r] = kern->dot(nr, CMat_pat(a, c + 1 + r, c + 1), vi); }
+        for (size_t k = 0; k < i; ++k) { small[k] = 0; }
+        for (size_t r = 0; r < nr; ++r) { kern->axpy(i, small, vi[r], w + (c + 1 + r - j) * jb); }
+        for (size_t r = 0; r < nr; ++r) { y[r] -= kern->dot(i, v + (c + 1 + r - j) * jb, small); }
+        for (size_t k = 0; k < i; ++k) { small[k] = 0; }
+        for (size_t r = 0; r < nr; ++r) { kern->axpy(i, small, vi[r], v + (c + 1 + r - j) * jb); }
+        for (size_t r = 0; r < nr; ++r) { y[r] -= kern->dot(i, w + (c + 1 + r - j) * jb, small); }
+        kern->scale(nr, y, tau[c], y);
+        kern->axpy(nr, y, -0.5 * tau[c] * kern->dot(nr, y, vi), vi);
+        for (size_t r = j; r < n; ++r) { w[(r - j) * jb + i] = r > c ? y[r - c - 1] : 0; }
+    }
+}
+
+// the eigenvalues of the symmetric tridiagonal matrix (d, e) with e[n - 1] = 0 by implicit QL
+// with shifts, the rotations are applied to the rows of zt (can be NULL)
+static bool cmat_tridiag_ql(size_t n, CMatType *d, CMatType *e, CMat *zt) {
+    CMatType norm = 0;
+    for (size_t i = 0; i < n; ++i) { norm = CMAT_MAX(norm, fabs(d[i]) + fabs(e[i])); }
+    for (size_t l = 0; l < n; ++l) {
+        size_t iter = 0, m;
+        do {
+            // the first negligible e from l split the matrix, relative to its neighbours or to
+            // the norm for a cluster of values close to 0
+            for (m = l; m + 1 < n; ++m) {
+                CMatType tol = DBL_EPSILON * (fabs(d[m]) + fabs(d[m + 1]));
+                if (fabs(e[m]) <= CMAT_MAX(tol, DBL_EPSILON * norm)) { break; }
+            }
+            if (m == l) { break; }
+            if (iter++ == CMAT_EIGEN_MAX_ITER) { return false; }
+
+            // the shift is the eigenvalue of the leading 2 x 2 closer to d[l]
+            CMatType g = (d[l + 1] - d[l]) / (2 * e[l]);
+            CMatType r = hypot(g, 1);
+            g          = d[m] - d[l] + e[l] / (g + copysign(r, g));
+            CMatType s = 1, c = 1, p = 0;
+            bool     split = false;
+            for (size_t i = m; i-- > l;) {
+                CMatType f = s * e[i], b = c * e[i];
+                r          = cmat_givens(g, f, &c, &s);
+                e[i + 1]   = r;
+                if (r == 0) {
+                    d[i + 1] -= p;
+                    e[m]  = 0;
+                    split = true;
+                    break;
+                }
+                g        = d[i + 1] - p;
+                r        = (d[i] - g) * s + 2 * c * b;
+                p        = s * r;
+                d[i + 1] = g + p;
+                g        = c * r - b;
+                cmat_rotate_rows(zt, i + 1, i, c, s);
+            }
+            if (split) { continue; }
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0;
+        } while (m != l);
+    }
+    return true;
+}
+
+bool CMat_sym_eigen(CMat *cmat, CMatType *eig, bool vectors) {
+    CMAT_ASSERT(cmat->nrow == cmat->ncol, "eigen decomposition only defined for square matrix");
+
+    size_t n = cmat->nrow;
+    if (n == 0) { return true; }
+
+    CMAT_STAT_BEGIN();
+    size_t nb = CMAT_MAX(CMAT_MIN(CMAT_QR_NB, n), 1);
+
+    size_t    size = (2 * n * nb + 4 * n + nb + (vectors ? n * n : 0)) * sizeof(CMatType);
+    CMatType *v    = cmat_scratch_alloc(size);
+    CMatType *w    = v + n * nb;
+    CMatType *e    = w + n * nb;
+    CMatType *tau  = e + n;
+    CMatType *tmp  = tau + n;
+    CMat      zt   = {.data = tmp + 2 * n + nb, .nrow = n, .ncol = n, .stride = n};
+
+    // cmat = Q . T . Q^T by panels, the trailing matrix is updated with 2 gemm after each
+    for (size_t j = 0; j + 1 < n; j += nb) {
+        size_t jb = CMAT_MIN(nb, n - 1 - j), nt = n - j - jb;
+        cmat_tridiag_panel(cmat, eig, e, tau, j, jb, v, w, tmp);
+        CMatType *trailing = CMat_pat(cmat, j + jb, j + jb);
+        CMatType *v2 = v + jb * jb, *w2 = w + jb * jb;
+        cmat_gemm_strided(nt, nt, jb, -1, v2, (ptrdiff_t)jb, 1, w2, 1, (ptrdiff_t)jb, 1, trailing,
+                          cmat->stride, 1);
+        cmat_gemm_strided(nt, nt, jb, -1, w2, (ptrdiff_t)jb, 1, v2, 1, (ptrdiff_t)jb, 1, trailing,
+                          cmat->stride, 1);
+    }
+    eig[n - 1] = CMat_at(cmat, n - 1, n - 1);
+    e[n - 1]   = 0;
+
+    bool ok;
+    if (vectors) {
+        // Q^T = diag(1, Q'^T) where Q' is the QR of the reflectors under the subdiagonal
+        CMat_iterate(&zt, row, col, val, *val = row == col;);
+        if (n > 1) {
+            CMat qr  = CMat_from_submat(cmat, 1, 0, n - 1, n - 1);
+            CMat sub = CMat_from_submat(&zt, 1, 1, n - 1, n - 1);
+            CMat_qr_apply(&qr, tau, &sub, true);
+        }
+        ok = cmat_tridiag_ql(n, eig, e, &zt);
+        cmat_sort_values(n, eig, false, &zt, NULL);
+        CMat_transpose(cmat, &zt);
+    } else {
+        ok = cmat_tridiag_ql(n, eig, e, NULL);
+        cmat_sort_values(n, eig, false, NULL, NULL);
+    }
+
+    cmat_scratch_free(v, size);
+    CMAT_STAT_END(CMAT_STAT_SYM_EIGEN, (vectors ? 9.0 : 4.0 / 3.0) * n * n * n, n * n);
+    return ok;
+}
+
+// the bidiagonal reduction of the rows and cols [j, j + jb) of a (m >= n): x ((m - j) x jb)
+// and y ((n - j) x jb) get the vectors such that a[j + jb:, j + jb:] -= V . Y^T + X . U^T, the
+// left reflectors are stored under the diagonal and the right ones after the superdiagonal,
+// the diagonal and the superdiagonal of the panel hold the ones of V and U until the update,
+// tmp get max(m, n) + jb + 1 values
+static void cmat_bidiag_panel(CMat *a, CMatType *d, CMatType *e, CMatType *tauq, CMatType *taup,
+                              size_t j, size_t jb, CMatType *x, CMatType *y, CMatType *tmp) {
+    const CMatKernels *kern = cmat_get_kernels();
+    CMat               s    = CMat_from_submat(a, j, j, a->nrow - j, a->ncol - j);
+    size_t             ms = s.nrow, ns = s.ncol;
+    CMatType          *vec = tmp, *small = tmp + CMAT_MAX(ms, ns);
+    for (size_t i = 0; i < jb; ++i) {
+        // the col i updated by the previous rows and cols of the panel
+        for (size_t p = 0; p < i; ++p) { small[p] = CMat_at(&s, p, i); }
+        for (size_t r = i; r < ms; ++r) {
+            CMat_at(&s, r, i) -= kern->dot(i, CMat_pat(&s, r, 0), y + i * jb) +
+                                 kern->dot(i, x + r * jb, small);
+        }
+        tauq[j + i] =
+            cmat_householder(ms - i, CMat_pat(&s, i, i), CMat_pat(&s, i, i) + s.stride, s.stride);
+        d[j + i] = CMat_at(&s, i, i);
+        if (i + 1 == ns) { continue; }
+        CMat_at(&s, i, i) = 1;
+
+        // y_i = tauq . (S^T . v - Y . V^T . v - U . X^T . v) on the cols after i
+        size_t nq = ns - i - 1, nr = ms - i - 1;
+        for (size_t q = 0; q < nq; ++q) { vec[q] = 0; }
+        for (size_t p = 0; p < i; ++p) { small[p] = 0; }
+        for (size_t r = i; r < ms; ++r) {
+            kern->axpy(nq, vec, CMat_at(&s, r, i), CMat_pat(&s, r, i + 1));
+            kern->axpy(i, small, CMat_at(&s, r, i), CMat_pat(&s, r, 0));
+        }
+        for (size_t q = 0; q < nq; ++q) { vec[q] -= kern->dot(i, y + (i + 1 + q) * jb, small); }
+        for (size_t p = 0; p < i; ++p) { small[p] = 0; }
+        for (size_t r = i; r < ms; ++r) { kern->axpy(i, small, CMat_at(&s, r, i), x + r * jb); }
+        for (size_t p = 0; p < i; ++p) { kern->axpy(nq, vec, -small[p], CMat_pat(&s, p, i + 1)); }
+        for (size_t q = 0; q < nq; ++q) { y[(i + 1 + q) * jb + i] = tauq[j + i] * vec[q]; }
+
+        // the row i updated by the rows and cols of the panel
+        CMatType *row = CMat_pat(&s, i, i + 1);
+        for (size_t q = 0; q < nq; ++q) {
+            row[q] -= kern->dot(i + 1, y + (i + 1 + q) * jb, CMat_pat(&s, i, 0));
+        }
+        for (size_t p = 0; p < i; ++p) {
+            kern->axpy(nq, row, -x[i * jb + p], CMat_pat(&s, p, i + 1));
+        }
+        taup[j + i] = cmat_householder(nq, row, row + 1, 1);
+        e[j + i]    = row[0];
+        row[0]      = 1;
+
+        // x_i = taup . (S . u - V . Y^T . u - X . U^T . u) on the rows after i
+        for (size_t r = 0; r < nr; ++r) {
+            vec[r] = kern->dot(nq, CMat_pat(&s, i + 1 + r, i + 1), row);
+        }
+        for (size_t p = 0; p <= i; ++p) { small[p] = 0; }
+        for (size_t q = 0; q < nq; ++q) { kern->axpy(i + 1, small, row[q], y + (i + 1 + q) * jb); }
+        for (size_t r = 0; r < nr; ++r) {
+            vec[r] -= kern->dot(i + 1, CMat_pat(&s, i + 1 + r, 0), small);
+        }
+        for (size_t p = 0; p < i; ++p) { small[p] = kern->dot(nq, CMat_pat(&s, p, i + 1), row); }
+        for (size_t r = 0; r < nr; ++r) {
+            vec[r] -= kern->dot(i, x + (i + 1 + r) * jb, small);
+            x[(i + 1 + r) * jb + i] = taup[j + i] * vec[r];
+        }
+    }
+}
+// a = Q . B . P^T with B upper bidiagonal (d, e) for m >= n, Q is the QR of the reflectors
+// under the diagonal and P the one of the reflectors after the superdiagonal (transposed)
+static void cmat_bidiag(CMat *a, CMatType *d, CMatType *e, CMatType *tauq, CMatType *taup) {
+    size_t m = a->nrow, n = a->ncol;
+    size_t nb = CMAT_MAX(CMAT_MIN(CMAT_QR_NB, n), 1);
+
+    size_t    size = (m * nb + n * nb + CMAT_MAX(m, n) + nb + 1) * sizeof(CMatType);
+    CMatType *x    = cmat_scratch_alloc(size);
+    CMatType *y    = x + m * nb;
+    CMatType *tmp  = y + n * nb;
+    for (size_t j = 0; j < n; j += nb) {
+        size_t jb = CMAT_MIN(nb, n - j);
+        cmat_bidiag_panel(a, d, e, tauq, taup, j, jb, x, y, tmp);
+        if (j + jb < n) {
+            size_t    mt = m - j - jb, nt = n - j - jb;
+            CMatType *trailing = CMat_pat(a, j + jb, j + jb);
+            cmat_gemm_strided(mt, nt, jb, -1, CMat_pat(a, j + jb, j), (ptrdiff_t)a->stride, 1,
+                              y + jb * jb, 1, (ptrdiff_t)jb, 1, trailing, a->stride, 1);
+            cmat_gemm_strided(mt, nt, jb, -1, x + jb * jb, (ptrdiff_t)jb, 1, CMat_pat(a, j, j + jb),
+                              (ptrdiff_t)a->stride, 1, 1, trailing, a->stride, 1);
+        }
+        for (size_t i = j; i < j + jb; ++i) {
+            CMat_at(a, i, i) = d[i];
+            if (i + 1 < n) { CMat_at(a, i, i + 1) = e[i]; }
+        }
+    }
+    cmat_scratch_free(x, size);
+}
+
+// the SVD of the upper bidiagonal matrix (d, e) by implicit shifted QR (Golub-Kahan), the
+// rotations on the left are applied to the rows of ut and the ones on the right to the rows of
+// vt (both can be NULL), d get the singular values in decreasing order
+static bool cmat_bidiag_qr(size_t n, CMatType *d, CMatType *e, CMat *ut, CMat *vt) {
+    CMatType norm = 0;
+    for (size_t i = 0; i < n; ++i) {
+        norm = CMAT_MAX(norm, fabs(d[i]) + (i + 1 < n ? fabs(e[i]) : 0));
+    }
+    // a negligible e is relative to its neighbours or to the norm like in cmat_tridiag_ql
+#define CMAT_BIDIAG_SPLIT(i)                                                                       \
+    (fabs(e[i]) <= CMAT_MAX(DBL_EPSILON * (fabs(d[i]) + fabs(d[(i) + 1])), DBL_EPSILON * norm))
+    size_t iter = 0, hi = n ? n - 1 : 0;
+    while (hi > 0) {
+        if (CMAT_BIDIAG_SPLIT(hi - 1)) {
+            e[hi - 1] = 0;
+            --hi;
+            continue;
+        }
+        // [lo, hi] is the last block without a zero on the superdiagonal
+        size_t lo = hi - 1;
+        while (lo > 0 && !CMAT_BIDIAG_SPLIT(lo - 1)) { --lo; }
+        if (lo > 0) { e[lo - 1] = 0; }
+        if (iter++ == CMAT_EIGEN_MAX_ITER * n) { return false; }
+
+        // a zero on the diagonal is chased out of its row (or its col for the last one) so the
+        // block split
+        size_t zero = lo;
+        while (zero <= hi && fabs(d[zero]) > DBL_EPSILON * norm) { ++zero; }
+        CMatType c, s, f;
+        if (zero < hi) {
+            d[zero] = 0;
+            f       = e[zero];
+            e[zero] = 0;
+            for (size_t k = zero + 1; k <= hi; ++k) {
+                d[k] = cmat_givens(d[k], f, &c, &s);
+                cmat_rotate_rows(ut, k, zero, c, s);
+                if (k < hi) {
+                    f = -s * e[k];
+                    e[k] *= c;
+                }
+            }
+            continue;
+        }
+        if (zero == hi) {
+            d[hi]     = 0;
+            f         = e[hi - 1];
+            e[hi - 1] = 0;
+            for (size_t k = hi; k-- > lo;) {
+                d[k] = cmat_givens(d[k], f, &c, &s);
+                cmat_rotate_rows(vt, k, hi, c, s);
+                if (k > lo) {
+                    f = -s * e[k - 1];
+                    e[k - 1] *= c;
+                }
+            }
+            continue;
+        }
+
+        // the shift is the eigenvalue of the trailing 2 x 2 of B^T . B closer to its last element
+        CMatType d_m = d[hi - 1], d_n = d[hi], e_m = e[hi - 1], e_l = hi - 1 > lo ? e[hi - 2] : 0;
+        CMatType t11 = d_m * d_m + e_l * e_l, t12 = d_m * e_m, t22 = d_n * d_n + e_m * e_m;
+        CMatType delta = (t11 - t22) / 2, denom = delta + copysign(hypot(delta, t12), delta);
+        CMatType mu = denom == 0 ? t22 : t22 - t12 * t12 / denom;
+
+        // chase the bulge from the top to the bottom of the block with a rotation on the right
+        // then one on the left for every col
+        CMatType y = d[lo] * d[lo] - mu, z = d[lo] * e[lo];
+        for (size_t k = lo; k < hi; ++k) {
+            CMatType r = cmat_givens(y, z, &c, &s);
+            if (k > lo) { e[k - 1] = r; }
+            f        = c * d[k] + s * e[k];
+            e[k]     = c * e[k] - s * d[k];
+            z        = s * d[k + 1];
+            d[k + 1] = c * d[k + 1];
+            d[k]     = f;
+            cmat_rotate_rows(vt, k, k + 1, c, s);
+
+            d[k]     = cmat_givens(d[k], z, &c, &s);
+            f        = c * e[k] + s * d[k + 1];
+            d[k + 1] = c * d[k + 1] - s * e[k];
+            e[k]     = f;
+            if (k + 1 < hi) {
+                y = e[k];
+                z = s * e[k + 1];
+                e[k + 1] *= c;
+            }
+            cmat_rotate_rows(ut, k, k + 1, c, s);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (d[i] >= 0) { continue; }
+        d[i] = -d[i];
+        if (!vt) { continue; }
+        CMatType *row = CMat_pat(vt, i, 0);
+        for (size_t k = 0; k < vt->ncol; ++k) { row[k] = -row[k]; }
+    }
+    cmat_sort_values(n, d, true, ut, vt);
+    return true;
+#undef CMAT_BIDIAG_SPLIT
+}
+
+// the SVD of a m x n matrix with m >= n: a QR first when m > n so the bidiagonal reduction is on
+// the n x n R and Q is applied to the left vectors with gemm
+static bool cmat_svd_tall(CMat *a, CMatType *s, CMat *u, CMat *vt) {
+    size_t m = a->nrow, n = a->ncol;
+    if (n == 0) { return true; }
+
+    bool      qr   = m > n;
+    size_t    size = (3 * n * n + 4 * n) * sizeof(CMatType);
+    CMatType *buf  = cmat_scratch_alloc(size);
+    CMat      r    = {.data = buf, .nrow = n, .ncol = n, .stride = n};
+    CMat      ut   = {.data = r.data + n * n, .nrow = n, .ncol = n, .stride = n};
+    CMat      v_t  = {.data = ut.data + n * n, .nrow = n, .ncol = n, .stride = n};
+    CMatType *e = v_t.data + n * n, *tau = e + n, *tauq = tau + n, *taup = tauq + n;
+
+    if (qr) {
+        CMat_qr(a, tau);
+        CMat_iterate(&r, row, col, val, *val = row <= col ? CMat_at(a, row, col) : 0;);
+    } else {
+        r = *a;
+    }
+    cmat_bidiag(&r, s, e, tauq, taup);
+
+    // the rows of ut and vt start as Q^T and P^T of the bidiagonal reduction
+    if (u) {
+        CMat_iterate(&ut, row, col, val, *val = row == col;);
+        CMat_qr_apply(&r, tauq, &ut, true);
+    }
+    if (vt) {
+        CMat_iterate(&v_t, row, col, val, *val = row == col;);
+        if (n > 1) {
+            // the reflectors of the rows of r as the cols of a QR (in ut when u is NULL)
+            CMat p = {.data = u ? u->data : ut.data, .nrow = n - 1, .ncol = n - 1, .stride = n - 1};
+            if (u) { p.stride = u->stride; }
+            CMat_iterate(&p, row, col, val, *val = CMat_at(&r, col, row + 1););
+            CMat sub = CMat_from_submat(&v_t, 1, 1, n - 1, n - 1);
+            CMat_qr_apply(&p, taup, &sub, true);
+        }
+    }
+
+    bool ok = cmat_bidiag_qr(n, s, e, u ? &ut : NULL, vt ? &v_t : NULL);
+    if (vt) { CMat_iterate2(vt, &v_t, row, col, dst, src, *dst = *src;); }
+    if (u) {
+        CMat top = CMat_from_submat(u, 0, 0, n, n);
+        CMat_transpose(&top, &ut);
+        if (qr) {
+            for (size_t row = n; row < m; ++row) {
+                for (size_t col = 0; col < n; ++col) { CMat_at(u, row, col) = 0; }
+            }
+            CMat_qr_apply(a, tau, u, false);
+        }
+    }
+    cmat_scratch_free(buf, size);
+    return ok;
+}
+bool CMat_svd(CMat *cmat, CMatType *s, CMat *u, CMat *vt) {
+    size_t m = cmat->nrow, n = cmat->ncol, k = CMAT_MIN(m, n);
+    CMAT_ASSERT((!u || (u->nrow == m && u->ncol == k)), "u should be cmat->nrow x min(nrow, ncol)");
+    CMAT_ASSERT((!vt || (vt->nrow == k && vt->ncol == n)),
+                "vt should be min(nrow, ncol) x cmat->ncol");
+
+    CMAT_STAT_BEGIN();
+    bool ok;
+    if (m >= n) {
+        ok = cmat_svd_tall(cmat, s, u, vt);
+    } else {
+        // cmat^T = U' . S . V'^T so u = V' and vt = U'^T
+        size_t    size = (n * m + 2 * n * m) * sizeof(CMatType);
+        CMatType *buf  = cmat_scratch_alloc(size);
+        CMat      at   = {.data = buf, .nrow = n, .ncol = m, .stride = m};
+        CMat      u2   = {.data = buf + n * m, .nrow = n, .ncol = m, .stride = m};
+        CMat      vt2  = {.data = u2.data + n * m, .nrow = m, .ncol = m, .stride = m};
+        CMat_transpose(&at, cmat);
+        ok = cmat_svd_tall(&at, s, vt ? &u2 : NULL, u ? &vt2 : NULL);
+        if (u) { CMat_transpose(u, &vt2); }
+        if (vt) { CMat_transpose(vt, &u2); }
+        cmat_scratch_free(buf, size);
+    }
+    CMAT_STAT_END(CMAT_STAT_SVD, 4.0 * CMAT_MAX(m, n) * k * k + (u || vt ? 8.0 * k * k * k : 0),
+                  m * n);
+    return ok;
+}
+
+void CMat_adj(CMat *dst, const CMat *src) {
+    CMAT_ASSERT(src->nrow == src->ncol, "adj only defined for square matrix");
+    CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");
+
+    // adj(src) = det(src) . inv(src), the LU and the inverse are done in dst
+    CMAT_STAT_BEGIN();
+    CMatDetBuf buf;
+    cmat_det_buf_init(&buf, src->nrow);
+    CMat_iterate2(dst, src, row, col, val1, val2, *val1 = *val2;);
+
+    CMatType norm  = cmat_norm1(src, buf.cmat.data);
+    bool     valid = CMat_lu(dst, buf.piv);
+    if (valid) {
+        CMatType det = 1;
+        for (size_t i = 0; i < dst->nrow; ++i) {
+            det *= CMat_at(dst, i, i);
+            if (buf.piv[i] != i) { det = -det; }
+        }
+        cmat_inverse_lu(dst, buf.piv, buf.cmat.data);
+        valid = norm * cmat_norm1(dst, buf.cmat.data) * CMAT_ADJ_RCOND_MIN <= 1;
+        if (valid) { CMat_scale(dst, det, dst); }
+    }
+    cmat_det_buf_deinit(&buf);
+    if (!valid) {
+        // det(src) . inv(src) lose too much precision (or is undefined), the cofactors don't
+        CMat_iterate(src, row, col, unused, {
+            (void)unused;
+            CMat_at(dst, col, row) = CMat_cofactor(src, row, col);
+        });
+    }
+    CMAT_STAT_END(CMAT_STAT_ADJ, 2.0 * src->nrow * src->nrow * src->nrow, src->nrow * src->nrow);
+}
+
+// the batch kernels of an instruction set, the kernels of n x n matrices are at index n - 1, they
+// work on count matrices of a CMatBatch by group of W (every vector of the padding to stride is
+// computed) and load every element of a group before the first store so dst can be a source
+typedef struct {
+    void (*gemm)(size_t count, size_t stride, size_t m, size_t k, size_t n, CMatType *dst,
+                 const CMatType *a, const CMatType *b);
+    void (*dot[CMAT_BATCH_MAX])(size_t count, size_t stride, CMatType *dst, const CMatType *a,
+                                const CMatType *b);
+    void (*det[CMAT_BATCH_MAX])(size_t count, size_t stride, CMatType *det, const CMatType *a);
+    size_t (*inverse[CMAT_BATCH_MAX])(size_t count, size_t stride, CMatType *dst, CMatType *det,
+                                      const CMatType *a);
+} CMatBatchKernels;
+
+// the fixed size kernels of N x N matrices of a group of W lanes, fully unrolled
+#define CMAT_DEFINE_BATCH_SQUARE(isa, target, W, N)                                                \
+    target static void cmat_batch_dot##N##_##isa(size_t count, size_t stride, CMatType *dst,       \
+                                                 const CMatType *a, const CMatType *b) {           \
+        for (size_t idx = 0; idx < count; idx += (W)) {                                            \
+            cmat_bvec_##isa va[N * N], vb[N * N];                                                  \
+            _Pragma("GCC unroll 16") for (size_t e = 0; e < N * N; ++e) {                          \
+                va[e] = *(const cmat_bvec_##isa *)(a + e * stride + idx);                          \
+                vb[e] = *(const cmat_bvec_##isa *)(b + e * stride + idx);                          \
+            }                                                                                      \
+            _Pragma("GCC unroll 4") for (size_t i = 0; i < N; ++i) {                               \
+                _Pragma("GCC unroll 4") for (size_t j = 0; j < N; ++j) {                           \
+                    cmat_bvec_##isa acc = va[i * N] * vb[j];                                       \
+                    _Pragma("GCC unroll 4") for (size_t p = 1; p < N; ++p) {                       \
+                        acc += va[i * N + p] * vb[p * N + j];                                      \
+                    }                                                                              \
+                    *(cmat_bvec_##isa *)(dst + (i * N + j) * stride + idx) = acc;                  \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    target static void cmat_batch_det##N##_##isa(size_t count, size_t stride, CMatType *det,       \
+                                                 const CMatType *a) {                              \
+        for (size_t idx = 0; idx < count; idx += (W)) {                                            \
+            cmat_bvec_##isa va[N * N];                                                             \
+            _Pragma("GCC unroll 16") for (size_t e = 0; e < N * N; ++e) {                          \
+                va[e] = *(const cmat_bvec_##isa *)(a + e * stride + idx);                          \
+            }                                                                                      \
+            cmat_bvec_##isa d = CMAT_DET##N(va);                                                   \
+            if (idx + (W) <= count) {                                                              \
+                *(cmat_bvec_##isa *)(det + idx) = d;                                               \
+                continue;                                                                          \
+            }                                                                                      \
+            for (size_t l = 0; idx + l < count; ++l) { det[idx + l] = d[l]; }                      \
+        }                                                                                          \
+    }                                                                                              \
+    target static size_t cmat_batch_inverse##N##_##isa(size_t count, size_t stride, CMatType *dst, \
+                                                       CMatType *det, const CMatType *a) {         \
+        size_t singular = 0;                                                                       \
+        for (size_t idx = 0; idx < count; idx += (W)) {                                            \
+            cmat_bvec_##isa va[N * N], vinv[N * N], d;                                             \
+            _Pragma("GCC unroll 16") for (size_t e = 0; e < N * N; ++e) {                          \
+                va[e] = *(const cmat_bvec_##isa *)(a + e * stride + idx);                          \
+            }                                                                                      \
+            CMAT_INVERSE##N(cmat_bvec_##isa, vinv, va, d);                                         \
+            _Pragma("GCC unroll 16") for (size_t e = 0; e < N * N; ++e) {                          \
+                *(cmat_bvec_##isa *)(dst + e * stride + idx) = vinv[e];                            \
+            }                                                                                      \
+            for (size_t l = 0; l < (W) && idx + l < count; ++l) {                                  \
+                singular += d[l] == 0;                                                             \
+                if (det) { det[idx + l] = d[l]; }                                                  \
+            }                                                                                      \
+        }                                                                                          \
+        return singular;                                                                           \
+    }
+// the batch kernels of W lanes written with gcc vector extensions (1 lane for the scalar ones)
+#define CMAT_DEFINE_BATCH_KERNELS(isa, target, W)                                                  \
+    typedef CMatType cmat_bvec_##isa __attribute__((vector_size((W) * sizeof(CMatType)),           \
+                                                    aligned(sizeof(CMatType)), may_alias));        \
+    target static void cmat_batch_gemm_##isa(size_t count, size_t stride, size_t m, size_t k,      \
+                                             size_t n, CMatType *dst, const CMatType *a,           \
+                                             const CMatType *b) {                                  \
+        for (size_t idx = 0; idx < count; idx += (W)) {                                            \
+            cmat_bvec_##isa vc[CMAT_BATCH_MAX * CMAT_BATCH_MAX];                                   \
+            for (size_t i = 0; i < m; ++i) {                                                       \
+                for (size_t j = 0; j < n; ++j) {                                                   \
+                    cmat_bvec_##isa acc = {0};                                                     \
+                    for (size_t p = 0; p < k; ++p) {                                               \
+                        acc += *(const cmat_bvec_##isa *)(a + (i * k + p) * stride + idx) *        \
+                               *(const cmat_bvec_##isa *)(b + (p * n + j) * stride + idx);         \
+                    }                                                                              \
+                    vc[i * n + j] = acc;                                                           \
+                }                                                                                  \
+            }                                                                                      \
+            for (size_t e = 0; e < m * n; ++e) {                                                   \
+                *(cmat_bvec_##isa *)(dst + e * stride + idx) = vc[e];                              \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    CMAT_DEFINE_BATCH_SQUARE(isa, target, W, 1)                                                    \
+    CMAT_DEFINE_BATCH_SQUARE(isa, target, W, 2)                                                    \
+    CMAT_DEFINE_BATCH_SQUARE(isa, target, W, 3)                                                    \
+    CMAT_DEFINE_BATCH_SQUARE(isa, target, W, 4)                                                    \
+    static const CMatBatchKernels cmat_batch_kernels_##isa = {                                     \
+        .gemm    = cmat_batch_gemm_##isa,                                                          \
+        .dot     = {cmat_batch_dot1_##isa, cmat_batch_dot2_##isa, cmat_batch_dot3_##isa,           \
+                    cmat_batch_dot4_##isa},                                                        \
+        .det     = {cmat_batch_det1_##isa, cmat_batch_det2_##isa, cmat_batch_det3_##isa,           \
+                    cmat_batch_det4_##isa},                                                        \
+        .inverse = {cmat_batch_inverse1_##isa, cmat_batch_inverse2_##isa,                          \
+                    cmat_batch_inverse3_##isa, cmat_batch_inverse4_##isa},                         \
+    };
+
+CMAT_DEFINE_BATCH_KERNELS(scalar, , 1)
+#ifdef CMAT_X86_SIMD
+CMAT_DEFINE_BATCH_KERNELS(sse2, CMAT_TARGET_SSE2, 2)
+CMAT_DEFINE_BATCH_KERNELS(avx2, CMAT_TARGET_AVX2, 4)
+CMAT_DEFINE_BATCH_KERNELS(avx512, CMAT_TARGET_AVX512, 8)
+#endif // CMAT_X86_SIMD
+
+// the batch kernels of the selected instruction set
+static const CMatBatchKernels *cmat_batch_get_kernels(void) {
+    switch (CMat_isa_get()) {
+#ifdef CMAT_X86_SIMD
+    case CMAT_ISA_AVX512: return &cmat_batch_kernels_avx512;
+    case CMAT_ISA_AVX2: return &cmat_batch_kernels_avx2;
+    case CMAT_ISA_SSE2: return &cmat_batch_kernels_sse2;
+#endif // CMAT_X86_SIMD
+    default: return &cmat_batch_kernels_scalar;
+    }
+}
+
+void CMatBatch_init(CMatBatch *batch, size_t nrow, size_t ncol, size_t count) {
+    CMAT_ASSERT(nrow <= CMAT_BATCH_MAX && ncol <= CMAT_BATCH_MAX, "batch matrices too big");
+
+    // the elements are the rows of an aligned matrix, its stride is a multiple of 8
+    CMat storage;
+    CMat_init_aligned(&storage, nrow * ncol, count);
+    for (size_t i = 0; i < storage.nrow * storage.stride; ++i) { storage.data[i] = 0; }
+
+    batch->data   = storage.data;
+    batch->nrow   = nrow;
+    batch->ncol   = ncol;
+    batch->count  = count;
+    batch->stride = storage.stride;
+}
+void CMatBatch_deinit(CMatBatch *batch) {
+    CMat storage = {.data = batch->data};
+    CMat_deinit_aligned(&storage);
+}
+void CMatBatch_set(CMatBatch *batch, size_t idx, const CMat *src) {
+    CMAT_ASSERT(idx < batch->count, "idx out of the batch");
+    CMAT_ASSERT(src->nrow == batch->nrow, "nrow don't match");
+    CMAT_ASSERT(src->ncol == batch->ncol, "ncol don't match");
+
+    CMat_iterate(src, row, col, val, CMatBatch_at(batch, idx, row, col) = *val;);
+}
+void CMatBatch_get(CMat *dst, const CMatBatch *batch, size_t idx) {
+    CMAT_ASSERT(idx < batch->count, "idx out of the batch");
+    CMAT_ASSERT(dst->nrow == batch->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == batch->ncol, "ncol don't match");
+
+    CMat_iterate(dst, row, col, val, *val = CMatBatch_at(batch, idx, row, col););
+}
+void CMatBatch_dot(CMatBatch *dst, const CMatBatch *cmat1, const CMatBatch *cmat2) {
+    CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "cmat1 ncol and cmat2 nrow don't match");
+    CMAT_ASSERT(dst->nrow == cmat1->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == cmat2->ncol, "ncol don't match");
+    CMAT_ASSERT(dst->count == cmat1->count && dst->count == cmat2->count, "count don't match");
+    CMAT_ASSERT(dst->stride == cmat1->stride && dst->stride == cmat2->stride,
+                "stride don't match");
+
+    CMAT_STAT_BEGIN();
+    const CMatBatchKernels *k = cmat_batch_get_kernels();
+    size_t                  n = cmat1->nrow;
+    if (n != 0 && cmat1->ncol == n && cmat2->ncol == n) {
+        k->dot[n - 1](dst->count, dst->stride, dst->data, cmat1->data, cmat2->data);
+    } else {
+        k->gemm(dst->count, dst->stride, cmat1->nrow, cmat1->ncol, cmat2->ncol, dst->data,
+                cmat1->data, cmat2->data);
+    }
+    CMAT_STAT_END(CMAT_STAT_BATCH_DOT, 2.0 * dst->count * dst->nrow * dst->ncol * cmat1->ncol,
+                  dst->count * dst->nrow * dst->ncol);
+}
+void CMatBatch_det(CMatType *det, const CMatBatch *batch) {
+    CMAT_ASSERT(batch->nrow == batch->ncol, "det only defined for square matrix");
+
+    CMAT_STAT_BEGIN();
+    size_t n = batch->nrow;
+    if (n == 0) {
+        for (size_t i = 0; i < batch->count; ++i) { det[i] = 1; }
+    } else {
+        cmat_batch_get_kernels()->det[n - 1](batch->count, batch->stride, det, batch->data);
+    }
+    CMAT_STAT_END(CMAT_STAT_BATCH_DET, 2.0 / 3.0 * batch->count * n * n * n, batch->count);
+}
+size_t CMatBatch_inverse(CMatBatch *dst, const CMatBatch *src, CMatType *det) {
+    CMAT_ASSERT(src->nrow == src->ncol, "inverse only defined for square matrix");
+    CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");
+    CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");
+    CMAT_ASSERT(dst->count == src->count, "count don't match");
+    CMAT_ASSERT(dst->stride == src->stride, "stride don't match");
+
+    CMAT_STAT_BEGIN();
+    size_t n        = src->nrow;
+    size_t singular = 0;
+    if (n == 0) {
+        for (size_t i = 0; det && i < src->count; ++i) { det[i] = 1; }
+    } else {
+        singular = cmat_batch_get_kernels()->inverse[n - 1](src->count, src->stride, dst->data,
+                                                             det, src->data);
+    }
+    CMAT_STAT_END(CMAT_STAT_BATCH_INVERSE, 2.0 * src->count * n * n * n, src->count * n * n);
+    return singular;
+}
+
+void CMatCoo_init(CMatCoo *coo, size_t nrow, size_t ncol, size_t capacity) {
+    capacity     = CMAT_MAX(capacity, 1);
+    coo->values  = cmat_malloc(capacity, sizeof(*coo->values));
+    coo->row_idx = cmat_malloc(capacity, sizeof(*coo->row_idx));
+    coo->col_idx = cmat_malloc(capacity, sizeof(*coo->col_idx));
+    CMAT_ASSERT(coo->values && coo->row_idx && coo->col_idx, "malloc failed");
+
+    coo->nrow     = nrow;
+    coo->ncol     = ncol;
+    coo->nnz      = 0;
+    coo->capacity = capacity;
+}
+void CMatCoo_deinit(CMatCoo *coo) {
+    CMAT_FREE(coo->values);
+    CMAT_FREE(coo->row_idx);
+    CMAT_FREE(coo->col_idx);
+}
+void CMatCoo_push(CMatCoo *coo, size_t row, size_t col, CMatType val) {
+    CMAT_ASSERT(row < coo->nrow && col < coo->ncol, "out of the matrix");
+
+    if (coo->nnz == coo->capacity) {
+        CMatCoo grown;
+        CMatCoo_init(&grown, coo->nrow, coo->ncol, 2 * coo->capacity);
+        for (size_t p = 0; p < coo->nnz; ++p) {
+            grown.values[p]  = coo->values[p];
+            grown.row_idx[p] = coo->row_idx[p];
+            grown.col_idx[p] = coo->col_idx[p];
+        }
+        grown.nnz = coo->nnz;
+        CMatCoo_deinit(coo);
+        *coo = grown;
+    }
+    coo->values[coo->nnz]  = val;
+    coo->row_idx[coo->nnz] = row;
+    coo->col_idx[coo->nnz] = col;
+    ++coo->nnz;
+}
+void CMatCoo_from_dense(CMatCoo *coo, const CMat *src) {
+    size_t nnz = 0;
+    CMat_iterate(src, row, col, val, nnz += *val != 0;);
+
+    CMatCoo_init(coo, src->nrow, src->ncol, nnz);
+    CMat_iterate(src, row, col, val, {
+        if (*val != 0) { CMatCoo_push(coo, row, col, *val); }
+    });
+}
+void CMatCoo_to_dense(CMat *dst, const CMatCoo *coo) {
+    CMAT_ASSERT(dst->nrow == coo->nrow && dst->ncol == coo->ncol, "size don't match");
+
+    CMat_iterate(dst, row, col, val, *val = 0;);
+    for (size_t p = 0; p < coo->nnz; ++p) {
+        CMat_at(dst, coo->row_idx[p], coo->col_idx[p]) += coo->values[p];
+    }
+}
+
+// CSR and CSC are the same compressed layout: the non zeros of the major line i (a row of a CSR,
+// a col of a CSC) are values[ptr[i], ptr[i + 1]) at the positions idx[ptr[i], ptr[i + 1]) of the
+// minor lines, a CSR of a matrix is a CSC of its transpose
+static void cmat_sparse_alloc(size_t nmajor, size_t nnz, CMatType **values, CMatIndex **idx,
+                              size_t **ptr) {
+    *values = cmat_malloc(CMAT_MAX(nnz, 1), sizeof(**values));
+    *idx    = cmat_malloc(CMAT_MAX(nnz, 1), sizeof(**idx));
+    *ptr    = cmat_malloc(nmajor + 1, sizeof(**ptr));
+    CMAT_ASSERT(*values && *idx && *ptr, "malloc failed");
+}
+// counting sort of the non zeros (major[p], minor[p], val[p]) by major line, stable so the order
+// of the non zeros of a line is their order in the arrays
+static void cmat_sparse_scatter(size_t nmajor, size_t nnz, const CMatIndex *major,
+                                const CMatIndex *minor, const CMatType *val, size_t *ptr,
+                                CMatIndex *idx, CMatType *values) {
+    for (size_t i = 0; i <= nmajor; ++i) { ptr[i] = 0; }
+    for (size_t p = 0; p < nnz; ++p) { ++ptr[major[p] + 1]; }
+    for (size_t i = 0; i < nmajor; ++i) { ptr[i + 1] += ptr[i]; }
+    // ptr[i] is the cursor of the line i then the beginning of the line i + 1
+    for (size_t p = 0; p < nnz; ++p) {
+        size_t q  = ptr[major[p]]++;
+        idx[q]    = minor[p];
+        values[q] = val[p];
+    }
+    for (size_t i = nmajor; i > 0; --i) { ptr[i] = ptr[i - 1]; }
+    ptr[0] = 0;
+}
+// the minor line of every non zero of a compressed matrix is its major line in the transpose
+static CMatIndex *cmat_sparse_expand(size_t nmajor, const size_t *ptr) {
+    CMatIndex *major = cmat_scratch_alloc(CMAT_MAX(ptr[nmajor], 1) * sizeof(*major));
+    for (size_t i = 0; i < nmajor; ++i) {
+        for (size_t p = ptr[i]; p < ptr[i + 1]; ++p) { major[p] = i; }
+    }
+    return major;
+}
+// the compressed transpose of a compressed matrix, the minor lines stay sorted (allocate)
+static void cmat_sparse_transpose(size_t nmajor, size_t nminor, const size_t *ptr,
+                                  const CMatIndex *idx, const CMatType *values, size_t **t_ptr,
+                                  CMatIndex **t_idx, CMatType **t_values) {
+    size_t nnz = ptr[nmajor];
+    cmat_sparse_alloc(nminor, nnz, t_values, t_idx, t_ptr);
+
+    CMatIndex *major = cmat_sparse_expand(nmajor, ptr);
+    cmat_sparse_scatter(nminor, nnz, idx, major, values, *t_ptr, *t_idx, *t_values);
+    cmat_scratch_free(major, CMAT_MAX(nnz, 1) * sizeof(*major));
+}
+// the compressed matrix of a COO (allocate), sorted by minor line with a first counting sort by
+// minor line and the duplicates summed, return the number of non zeros
+static size_t cmat_sparse_from_coo(size_t nmajor, size_t nminor, size_t nnz,
+                                   const CMatIndex *major, const CMatIndex *minor,
+                                   const CMatType *val, size_t **ptr, CMatIndex **idx,
+                                   CMatType **values) {
+    size_t    *t_ptr;
+    CMatIndex *t_idx;
+    CMatType  *t_values;
+    cmat_sparse_alloc(nminor, nnz, &t_values, &t_idx, &t_ptr);
+    cmat_sparse_scatter(nminor, nnz, minor, major, val, t_ptr, t_idx, t_values);
+    cmat_sparse_transpose(nminor, nmajor, t_ptr, t_idx, t_values, ptr, idx, values);
+    CMAT_FREE(t_values);
+    CMAT_FREE(t_idx);
+    CMAT_FREE(t_ptr);
+
+    // the duplicates are next to each other
+    size_t unique = 0;
+    for (size_t i = 0; i < nmajor; ++i) {
+        size_t begin = (*ptr)[i], end = (*ptr)[i + 1];
+        (*ptr)[i]    = unique;
+        for (size_t p = begin; p < end; ++p) {
+            if (unique > (*ptr)[i] && (*idx)[unique - 1] == (*idx)[p]) {
+                (*values)[unique - 1] += (*values)[p];
+            } else {
+                (*idx)[unique]    = (*idx)[p];
+                (*values)[unique] = (*values)[p];
+                ++unique;
+            }
+        }
+    }
+    (*ptr)[nmajor] = unique;
+    return unique;
+}
+// the compressed matrix of the non zeros of a dense one (allocate), the element (i, j) of the
+// major line i is data[i * rs + j * cs], return the number of non zeros
+static size_t cmat_sparse_from_dense(size_t nmajor, size_t nminor, const CMatType *data, size_t rs,
+                                     size_t cs, size_t **ptr, CMatIndex **idx,
+                                     CMatType **values) {
+    size_t nnz = 0;
+    for (size_t i = 0; i < nmajor; ++i) {
+        for (size_t j = 0; j < nminor; ++j) { nnz += data[i * rs + j * cs] != 0; }
+    }
+    cmat_sparse_alloc(nmajor, nnz, values, idx, ptr);
+
+    size_t q = 0;
+    for (size_t i = 0; i < nmajor; ++i) {
+        (*ptr)[i] = q;
+        for (size_t j = 0; j < nminor; ++j) {
+            CMatType val = data[i * rs + j * cs];
+            if (val == 0) { continue; }
+            (*idx)[q]    = j;
+            (*values)[q] = val;
+            ++q;
+        }
+    }
+    (*ptr)[nmajor] = q;
+    return nnz;
+}
+static void cmat_sparse_to_dense(size_t nmajor, const size_t *ptr, const CMatIndex *idx,
+                                 const CMatType *values, CMatType *data, size_t rs, size_t cs) {
+    for (size_t i = 0; i < nmajor; ++i) {
+        for (size_t p = ptr[i]; p < ptr[i + 1]; ++p) { data[i * rs + idx[p] * cs] += values[p]; }
+    }
+}
+
+// a sparse multiply-add load an index and a row of b far from the previous one, it cost about
+// CMAT_SPARSE_COST dense ones when comparing to the parallel threshold
+#define CMAT_SPARSE_COST 8
+
+// a parallel sparse . dense product, a task compute a part of the rows (CSR) or cols (CSC) of dst
+typedef struct {
+    const CMatKernels *kern;
+    CMatType           alpha;
+    const CMatType    *values;
+    const CMatIndex   *idx;
+    const size_t      *ptr;
+    size_t             nmajor;
+    const CMat        *b;
+    CMatType           beta;
+    CMat              *dst;
+    size_t             ntask;
+} CMatSparseJob;
+
+// dst[0, n) = beta * dst[0, n) without reading dst if beta is 0
+static void cmat_sparse_scale(const CMatKernels *kern, size_t n, CMatType *dst, CMatType beta) {
+    if (beta == 0) {
+        for (size_t j = 0; j < n; ++j) { dst[j] = 0; }
+    } else if (beta != 1) {
+        kern->scale(n, dst, beta, dst);
+    }
+}
+// the rows [begin, end) of dst = alpha * a . b + beta * dst with a CSR
+static void cmat_csr_gemm_rows(const CMatSparseJob *job, size_t begin, size_t end) {
+    const CMat *b = job->b;
+    for (size_t i = begin; i < end; ++i) {
+        CMatType *c = CMat_pat(job->dst, i, 0);
+        if (b->ncol == 1) {
+            CMatType sum = 0;
+            for (size_t p = job->ptr[i]; p < job->ptr[i + 1]; ++p) {
+                sum += job->values[p] * b->data[job->idx[p] * b->stride];
+            }
+            *c = job->alpha * sum + (job->beta == 0 ? 0 : job->beta * *c);
+            continue;
+        }
+        cmat_sparse_scale(job->kern, b->ncol, c, job->beta);
+        for (size_t p = job->ptr[i]; p < job->ptr[i + 1]; ++p) {
+            job->kern->axpy(b->ncol, c, job->alpha * job->values[p], CMat_pat(b, job->idx[p], 0));
+        }
+    }
+}
+// the first row of the task, the tasks have the same number of non zeros + rows (a row cost
+// about a non zero even if empty)
+static size_t cmat_csr_task_row(const CMatSparseJob *job, size_t task) {
+    size_t target = (job->ptr[job->nmajor] + job->nmajor) * task / job->ntask;
+    size_t lo = 0, hi = job->nmajor;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (job->ptr[mid] + mid < target) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+static void cmat_csr_gemm_task(void *ctx, size_t task, size_t worker) {
+    (void)worker;
+    const CMatSparseJob *job = ctx;
+    cmat_csr_gemm_rows(job, cmat_csr_task_row(job, task), cmat_csr_task_row(job, task + 1));
+}
+// the cols [begin, end) of dst = alpha * a . b + beta * dst with a CSC, every col of a add its
+// non zeros times a row of b to rows of dst
+static void cmat_csc_gemm_cols(const CMatSparseJob *job, size_t begin, size_t end) {
+    const CMat *b = job->b;
+    size_t      n = end - begin;
+    for (size_t i = 0; i < job->dst->nrow; ++i) {
+        cmat_sparse_scale(job->kern, n, CMat_pat(job->dst, i, begin), job->beta);
+    }
+    for (size_t j = 0; j < job->nmajor; ++j) {
+        const CMatType *b_row = CMat_pat(b, j, begin);
+        for (size_t p = job->ptr[j]; p < job->ptr[j + 1]; ++p) {
+            CMatType *c = CMat_pat(job->dst, job->idx[p], begin);
+            if (n == 1) {
+                *c += job->alpha * job->values[p] * *b_row;
+            } else {
+                job->kern->axpy(n, c, job->alpha * job->values[p], b_row);
+            }
+        }
+    }
+}
+static void cmat_csc_gemm_task(void *ctx, size_t task, size_t worker) {
+    (void)worker;
+    const CMatSparseJob *job = ctx;
+    size_t               n   = job->b->ncol;
+    cmat_csc_gemm_cols(job, n * task / job->ntask, n * (task + 1) / job->ntask);
+}
+
+void CMatCsr_from_coo(CMatCsr *csr, const CMatCoo *coo) {
+    csr->nrow = coo->nrow;
+    csr->ncol = coo->ncol;
+    csr->nnz  = cmat_sparse_from_coo(coo->nrow, coo->ncol, coo->nnz, coo->row_idx, coo->col_idx,
+                                     coo->values, &csr->row_ptr, &csr->col_idx, &csr->values);
+}
+void CMatCsr_from_dense(CMatCsr *csr, const CMat *src) {
+    csr->nrow = src->nrow;
+    csr->ncol = src->ncol;
+    csr->nnz  = cmat_sparse_from_dense(src->nrow, src->ncol, src->data, src->stride, 1,
+                                       &csr->row_ptr, &csr->col_idx, &csr->values);
+}
+void CMatCsr_from_csc(CMatCsr *csr, const CMatCsc *csc) {
+    csr->nrow = csc->nrow;
+    csr->ncol = csc->ncol;
+    csr->nnz  = csc->nnz;
+    cmat_sparse_transpose(csc->ncol, csc->nrow, csc->col_ptr, csc->row_idx, csc->values,
+                          &csr->row_ptr, &csr->col_idx, &csr->values);
+}
+void CMatCsr_to_dense(CMat *dst, const CMatCsr *csr) {
+    CMAT_ASSERT(dst->nrow == csr->nrow && dst->ncol == csr->ncol, "size don't match");
+
+    CMat_iterate(dst, row, col, val, *val = 0;);
+    cmat_sparse_to_dense(csr->nrow, csr->row_ptr, csr->col_idx, csr->values, dst->data,
+                         dst->stride, 1);
+}
+void CMatCsr_deinit(CMatCsr *csr) {
+    CMAT_FREE(csr->values);
+    CMAT_FREE(csr->col_idx);
+    CMAT_FREE(csr->row_ptr);
+}
+void CMatCsr_gemm(CMat *dst, CMatType alpha, const CMatCsr *a, const CMat *b, CMatType beta) {
+    CMAT_ASSERT(a->nrow == dst->nrow, "a->nrow should match with dst->nrow");
+    CMAT_ASSERT(a->ncol == b->nrow, "a->ncol should match with b->nrow");
+    CMAT_ASSERT(b->ncol == dst->ncol, "b->ncol should match with dst->ncol");
+
+    CMAT_STAT_BEGIN();
+    CMatSparseJob job = {.kern   = cmat_get_kernels(),
+                         .alpha  = alpha,
+                         .values = a->values,
+                         .idx    = a->col_idx,
+                         .ptr    = a->row_ptr,
+                         .nmajor = a->nrow,
+                         .b      = b,
+                         .beta   = beta,
+                         .dst    = dst,
+                         .ntask  = CMAT_MIN(4 * CMat_get_num_threads(), a->nrow)};
+    if (CMAT_SPARSE_COST * (a->nnz + a->nrow) * b->ncol <= cmat_parallel_threshold ||
+        !cmat_pool_try_run(job.ntask, cmat_csr_gemm_task, &job)) {
+        cmat_csr_gemm_rows(&job, 0, a->nrow);
+    }
+    CMAT_STAT_END(CMAT_STAT_CSR_GEMM, 2.0 * a->nnz * b->ncol, a->nnz);
+}
+void CMatCsr_dot(CMat *dst, const CMatCsr *a, const CMat *b) { CMatCsr_gemm(dst, 1, a, b, 0); }
+
+void CMatCsc_from_coo(CMatCsc *csc, const CMatCoo *coo) {
+    csc->nrow = coo->nrow;
+    csc->ncol = coo->ncol;
+    csc->nnz  = cmat_sparse_from_coo(coo->ncol, coo->nrow, coo->nnz, coo->col_idx, coo->row_idx,
+                                     coo->values, &csc->col_ptr, &csc->row_idx, &csc->values);
+}
+void CMatCsc_from_dense(CMatCsc *csc, const CMat *src) {
+    csc->nrow = src->nrow;
+    csc->ncol = src->ncol;
+    csc->nnz  = cmat_sparse_from_dense(src->ncol, src->nrow, src->data, 1, src->stride,
+                                       &csc->col_ptr, &csc->row_idx, &csc->values);
+}
+void CMatCsc_from_csr(CMatCsc *csc, const CMatCsr *csr) {
+    csc->nrow = csr->nrow;
+    csc->ncol = csr->ncol;
+    csc->nnz  = csr->nnz;
+    cmat_sparse_transpose(csr->nrow, csr->ncol, csr->row_ptr, csr->col_idx, csr->values,
+                          &csc->col_ptr, &csc->row_idx, &csc->values);
+}
+void CMatCsc_to_dense(CMat *dst, const CMatCsc *csc) {
+    CMAT_ASSERT(dst->nrow == csc->nrow && dst->ncol == csc->ncol, "size don't match");
+
+    CMat_iterate(dst, row, col, val, *val = 0;);
+    cmat_sparse_to_dense(csc->ncol, csc->col_ptr, csc->row_idx, csc->values, dst->data, 1,
+                         dst->stride);
+}
+void CMatCsc_deinit(CMatCsc *csc) {
+    CMAT_FREE(csc->values);
+    CMAT_FREE(csc->row_idx);
+    CMAT_FREE(csc->col_ptr);
+}
+void CMatCsc_gemm(CMat *dst, CMatType alpha, const CMatCsc *a, const CMat *b, CMatType beta) {
+    CMAT_ASSERT(a->nrow == dst->nrow, "a->nrow should match with dst->nrow");
+    CMAT_ASSERT(a->ncol == b->nrow, "a->ncol should match with b->nrow");
+    CMAT_ASSERT(b->ncol == dst->ncol, "b->ncol should match with dst->ncol");
+
+    CMAT_STAT_BEGIN();
+    // a task has at least 8 cols of dst
+    CMatSparseJob job = {.kern   = cmat_get_kernels(),
+                         .alpha  = alpha,
+                         .values = a->values,
+                         .idx    = a->row_idx,
+                         .ptr    = a->col_ptr,
+                         .nmajor = a->ncol,
+                         .b      = b,
+                         .beta   = beta,
+                         .dst    = dst,
+                         .ntask  = CMAT_MIN(4 * CMat_get_num_threads(), b->ncol / 8)};
+    if (CMAT_SPARSE_COST * (a->nnz + a->nrow) * b->ncol <= cmat_parallel_threshold ||
+        !cmat_pool_try_run(job.ntask, cmat_csc_gemm_task, &job)) {
+        cmat_csc_gemm_cols(&job, 0, b->ncol);
+    }
+    CMAT_STAT_END(CMAT_STAT_CSC_GEMM, 2.0 * a->nnz * b->ncol, a->nnz);
+}
+void CMatCsc_dot(CMat *dst, const CMatCsc *a, const CMat *b) { CMatCsc_gemm(dst, 1, a, b, 0); }
+
+// dst += alpha * src for rows of m elements, inline for the single col of a matrix vector product
+static inline void cmat_row_axpy(const CMatKernels *kern, size_t m, CMatType *dst, CMatType alpha,
+                                 const CMatType *src) {
+    if (m == 1) {
+        *dst += alpha * *src;
+    } else {
+        kern->axpy(m, dst, alpha, src);
+    }
+}
+// the elements count of a packed triangle, at least 1 to never malloc 0 (the offset of CMatTri_pat
+// and CMatSym_pat is linear in col so the pointer of the col 0 of a row index the whole row)
+#define CMAT_PACKED_SIZE(n) CMAT_MAX((n) * ((n) + 1) / 2, 1)
+
+void CMatDiag_init(CMatDiag *diag, size_t n) {
+    diag->data = cmat_malloc(CMAT_MAX(n, 1), sizeof(*diag->data));
+    CMAT_ASSERT(diag->data, "malloc failed");
+    diag->n = n;
+}
+void CMatDiag_from_dense(CMatDiag *diag, const CMat *src) {
+    CMAT_ASSERT(src->nrow == src->ncol, "src should be square");
+
+    CMatDiag_init(diag, src->nrow);
+    for (size_t i = 0; i < diag->n; ++i) { diag->data[i] = CMat_at(src, i, i); }
+}
+void CMatDiag_to_dense(CMat *dst, const CMatDiag *diag) {
+    CMAT_ASSERT(dst->nrow == diag->n && dst->ncol == diag->n, "size don't match");
+
+    CMat_iterate(dst, row, col, val, *val = row == col ? diag->data[row] : 0;);
+}
+void CMatDiag_dot(CMat *dst, const CMatDiag *diag, const CMat *b) {
+    CMAT_ASSERT(b->nrow == diag->n, "b->nrow should match with diag->n");
+    CMAT_ASSERT(dst->nrow == b->nrow && dst->ncol == b->ncol, "dst should have the size of b");
+
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t i = 0; i < diag->n; ++i) {
+        kern->scale(b->ncol, CMat_pat(dst, i, 0), diag->data[i], CMat_pat(b, i, 0));
+    }
+}
+void CMatDiag_dot_right(CMat *dst, const CMat *b, const CMatDiag *diag) {
+    CMAT_ASSERT(b->ncol == diag->n, "b->ncol should match with diag->n");
+    CMAT_ASSERT(dst->nrow == b->nrow && dst->ncol == b->ncol, "dst should have the size of b");
+
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t i = 0; i < b->nrow; ++i) {
+        kern->mul(b->ncol, CMat_pat(dst, i, 0), CMat_pat(b, i, 0), diag->data);
+    }
+}
+// true if no element of the diagonal d (of n elements, every inc) is 0
+static bool cmat_diag_invertible(const CMatType *d, size_t n, size_t inc) {
+    for (size_t i = 0; i < n; ++i) {
+        if (d[i * inc] == 0) { return false; }
+    }
+    return true;
+}
+bool CMatDiag_inverse(CMatDiag *diag) {
+    if (!cmat_diag_invertible(diag->data, diag->n, 1)) { return false; }
+    for (size_t i = 0; i < diag->n; ++i) { diag->data[i] = 1 / diag->data[i]; }
+    return true;
+}
+bool CMatDiag_solve(CMat *b, const CMatDiag *diag) {
+    CMAT_ASSERT(b->nrow == diag->n, "b->nrow should match with diag->n");
+
+    if (!cmat_diag_invertible(diag->data, diag->n, 1)) { return false; }
+    const CMatKernels *kern = cmat_get_kernels();
+    for (size_t i = 0; i < diag->n; ++i) {
+        CMatType *b_row = CMat_pat(b, i, 0);
+        kern->scale(b->ncol, b_row, 1 / diag->data[i], b_row);
+    }
+    return true;
+}
+CMatType CMatDiag_det(const CMatDiag *diag) {
+    CMatType det = 1;
+    for (size_t i = 0; i < diag->n; ++i) { det *= diag->data[i]; }
+    return det;
 }
 
-void CMat_identity(CMat *dst) {
-    CMAT_ASSERT(dst->nrow == dst->ncol, "row and col don't match");
+void CMatTri_init(CMatTri *tri, size_t n, bool upper) {
+    tri->data = cmat_malloc(CMAT_PACKED_SIZE(n), sizeof(*tri->data));
+    CMAT_ASSERT(tri->data, "malloc failed");
+    tri->n     = n;
+    tri->upper = upper;
+}
+void CMatTri_from_dense(CMatTri *tri, const CMat *src, bool upper) {
+    CMAT_ASSERT(src->nrow == src->ncol, "src should be square");
+
+    CMatTri_init(tri, src->nrow, upper);
+    CMat_iterate(src, row, col, val, {
+        if (upper ? row <= col : row >= col) { CMatTri_at(tri, row, col) = *val; }
+    });
+}
+void CMatTri_to_dense(CMat *dst, const CMatTri *tri) {
+    CMAT_ASSERT(dst->nrow == tri->n && dst->ncol == tri->n, "size don't match");
+
     CMat_iterate(dst, row, col, val, {
-        if (row == col) {
-            *val = 1;
-        } else {
-            *val = 0;
-        }
+        *val = (tri->upper ? row <= col : row >= col) ? CMatTri_at(tri, row, col) : 0;
     });
 }
+// tile = the rows [row0, row0 + nrow) and cols [col0, col0 + ncol) of tri or of its transpose
+// with the 0 out of the triangle, the blocked functions multiply the dense tiles with the gemm
+static void cmat_tri_unpack(CMatType *tile, const CMatTri *tri, bool transpose, size_t row0,
+                            size_t nrow, size_t col0, size_t ncol) {
+    for (size_t r = 0; r < nrow; ++r) {
+        for (size_t c = 0; c < ncol; ++c) {
+            size_t i = transpose ? col0 + c : row0 + r;
+            size_t j = transpose ? row0 + r : col0 + c;
+            tile[r * ncol + c] = (tri->upper ? i <= j : i >= j) ? CMatTri_at(tri, i, j) : 0;
+        }
+    }
+}
+void CMatTri_dot(CMat *dst, const CMatTri *tri, const CMat *b) {
+    CMAT_ASSERT(b->nrow == tri->n, "b->nrow should match with tri->n");
+    CMAT_ASSERT(dst->nrow == b->nrow && dst->ncol == b->ncol, "dst should have the size of b");
 
-void CMat_dot(CMat *dst, const CMat *cmat1, const CMat *cmat2) {
-    CMAT_ASSERT(cmat1->nrow == dst->nrow, "a->nrow should match with dst->nrow");
-    CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "a->ncol should match with b->nrow");
-    CMAT_ASSERT(cmat2->ncol == dst->ncol, "b->ncol should match with dst->ncol");
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             n = tri->n, m = b->ncol;
+    // the rows of dst only use the rows of b on the side of the triangle, so computing the blocks
+    // (and the rows of a block) from the other side never read a row of b already replaced when
+    // dst is b
+    if (m == 1) {
+        for (size_t k = 0; k < n; ++k) {
+            size_t          i     = tri->upper ? k : n - 1 - k;
+            const CMatType *t_row = CMatTri_pat(tri, i, 0);
+            CMatType        y     = 0;
+            for (size_t j = tri->upper ? i : 0; j < (tri->upper ? n : i + 1); ++j) {
+                y += t_row[j] * CMat_at(b, j, 0);
+            }
+            CMat_at(dst, i, 0) = y;
+        }
+        CMAT_STAT_END(CMAT_STAT_TRI_DOT, (double)n * n, n);
+        return;
+    }
 
-    for (size_t col = 0; col < dst->ncol; ++col) {
-        for (size_t row = 0; row < dst->nrow; ++row) {
-            CMatType sum = 0;
-            for (size_t i = 0; i < cmat1->ncol; ++i) {
-                sum += CMat_at(cmat1, row, i) * CMat_at(cmat2, i, col);
+    size_t    nb        = CMAT_MIN(CMAT_TRSM_NB, n);
+    size_t    tile_size = CMAT_MAX(n * nb, 1) * sizeof(CMatType);
+    CMatType *tile      = cmat_scratch_alloc(tile_size);
+    for (size_t blk = 0; blk < n; blk += nb) {
+        size_t jb = CMAT_MIN(nb, n - blk);
+        size_t i0 = tri->upper ? blk : n - blk - jb;
+        size_t i1 = i0 + jb;
+
+        cmat_tri_unpack(tile, tri, false, i0, jb, i0, jb);
+        for (size_t k = 0; k < jb; ++k) {
+            size_t    r     = tri->upper ? k : jb - 1 - k;
+            CMatType *d_row = CMat_pat(dst, i0 + r, 0);
+            kern->scale(m, d_row, tile[r * jb + r], CMat_pat(b, i0 + r, 0));
+            size_t lo = tri->upper ? r + 1 : 0;
+            size_t hi = tri->upper ? jb : r;
+            for (size_t c = lo; c < hi; ++c) {
+                cmat_row_axpy(kern, m, d_row, tile[r * jb + c], CMat_pat(b, i0 + c, 0));
             }
-            CMat_at(dst, row, col) = sum;
         }
+
+        // add the rest of the block rows
+        size_t c0 = tri->upper ? i1 : 0;
+        size_t nc = tri->upper ? n - i1 : i0;
+        if (nc > 0) {
+            cmat_tri_unpack(tile, tri, false, i0, jb, c0, nc);
+            cmat_gemm_strided(jb, m, nc, 1, tile, nc, 1, CMat_pat(b, c0, 0), b->stride, 1, 1,
+                              CMat_pat(dst, i0, 0), dst->stride, 1);
+        }
+    }
+    cmat_scratch_free(tile, tile_size);
+    CMAT_STAT_END(CMAT_STAT_TRI_DOT, (double)n * n * m, n * m);
+}
+// true if no element of the diagonal of tri is 0
+static bool cmat_tri_invertible(const CMatTri *tri) {
+    for (size_t i = 0; i < tri->n; ++i) {
+        if (CMatTri_at(tri, i, i) == 0) { return false; }
     }
+    return true;
 }
+// solve tri . x = b or tri^T . x = b in place by blocks: the diagonal block is solved by
+// cmat_trsm then removed from the rows still to solve with a gemm
+static void cmat_tri_solve(CMat *b, const CMatTri *tri, bool transpose) {
+    CMAT_STAT_BEGIN();
+    size_t n = tri->n, m = b->ncol;
+    bool   lower = tri->upper == transpose;
+    if (m == 1) {
+        // substitution on the col, the packed row i of tri is contiguous: a row of the system
+        // (x_i = (b_i - sum t_ij x_j) / t_ii) or a col of the transpose (x_i is removed from the
+        // rows still to solve once found)
+        for (size_t k = 0; k < n; ++k) {
+            size_t          i     = lower ? k : n - 1 - k;
+            size_t          lo    = tri->upper ? i + 1 : 0;
+            size_t          hi    = tri->upper ? n : i;
+            const CMatType *t_row = CMatTri_pat(tri, i, 0);
+            CMatType       *x_i   = CMat_pat(b, i, 0);
+            if (transpose) {
+                *x_i /= t_row[i];
+                for (size_t j = lo; j < hi; ++j) { CMat_at(b, j, 0) -= t_row[j] * *x_i; }
+            } else {
+                for (size_t j = lo; j < hi; ++j) { *x_i -= t_row[j] * CMat_at(b, j, 0); }
+                *x_i /= t_row[i];
+            }
+        }
+        CMAT_STAT_END(CMAT_STAT_TRI_SOLVE, (double)n * n, n);
+        return;
+    }
 
-CMatType CMat_cofactor(const CMat *cmat, size_t row, size_t col) {
-    CMat submat;
-    CMat_init(&submat, cmat->nrow - 1, cmat->ncol - 1);
+    size_t    nb        = CMAT_MIN(CMAT_TRSM_NB, n);
+    size_t    tile_size = CMAT_MAX(n * nb, 1) * sizeof(CMatType);
+    CMatType *tile      = cmat_scratch_alloc(tile_size);
+    for (size_t blk = 0; blk < n; blk += nb) {
+        size_t jb = CMAT_MIN(nb, n - blk);
+        // lower go down from the first block, upper go up from the last one
+        size_t i0 = lower ? blk : n - blk - jb;
+        size_t i1 = i0 + jb;
 
-    size_t idx = 0;
-    for (size_t i = 0; i < cmat->nrow; ++i) {
-        for (size_t j = 0; j < cmat->ncol; ++j) {
-            if (i == row || j == col) { continue; }
-            // no stride so it's fine
-            submat.data[idx++] = CMat_at(cmat, i, j);
+        CMat b_blk = {.data = CMat_pat(b, i0, 0), .nrow = jb, .ncol = m, .stride = b->stride};
+        cmat_tri_unpack(tile, tri, transpose, i0, jb, i0, jb);
+        cmat_trsm(lower, false, tile, jb, 1, jb, &b_blk);
+
+        size_t r0 = lower ? i1 : 0;
+        size_t nr = lower ? n - i1 : i0;
+        if (nr > 0) {
+            cmat_tri_unpack(tile, tri, transpose, r0, nr, i0, jb);
+            cmat_gemm_strided(nr, m, jb, -1, tile, jb, 1, b_blk.data, b->stride, 1, 1,
+                              CMat_pat(b, r0, 0), b->stride, 1);
         }
     }
+    cmat_scratch_free(tile, tile_size);
+    CMAT_STAT_END(CMAT_STAT_TRI_SOLVE, (double)n * n * m, n * m);
+}
+bool CMatTri_solve(CMat *b, const CMatTri *tri) {
+    CMAT_ASSERT(b->nrow == tri->n, "b->nrow should match with tri->n");
 
-    CMatType det = CMat_det(&submat);
-
-    CMat_deinit(&submat);
-    return ((row + col) % 2 == 0) ? det : -det;
+    if (!cmat_tri_invertible(tri)) { return false; }
+    cmat_tri_solve(b, tri, false);
+    return true;
 }
-CMatType CMat_det(const CMat *cmat) {
-    CMAT_ASSERT(cmat->nrow == cmat->ncol, "the determinent is only defined for square matrices");
-    // Laplace expansion
+bool CMatTri_solve_transpose(CMat *b, const CMatTri *tri) {
+    CMAT_ASSERT(b->nrow == tri->n, "b->nrow should match with tri->n");
 
-    // base case: 0x0
-    if (cmat->nrow == 0) { return 1; }
+    if (!cmat_tri_invertible(tri)) { return false; }
+    cmat_tri_solve(b, tri, true);
+    return true;
+}
+CMatType CMatTri_det(const CMatTri *tri) {
+    CMatType det = 1;
+    for (size_t i = 0; i < tri->n; ++i) { det *= CMatTri_at(tri, i, i); }
+    return det;
+}
 
-    // recursive_case: nxn => (n-1)x(n-1)
-    CMatType det = 0;
-    for (size_t col = 0; col < cmat->ncol; ++col) {
-        // CMat_cofactor call CMat_det
-        det += CMat_at(cmat, 0, col) * CMat_cofactor(cmat, 0, col);
+void CMatBand_init(CMatBand *band, size_t nrow, size_t ncol, size_t kl, size_t ku) {
+    size_t size = CMAT_MAX(nrow * (kl + ku + 1), 1);
+    band->data  = cmat_malloc(size, sizeof(*band->data));
+    CMAT_ASSERT(band->data, "malloc failed");
+    for (size_t i = 0; i < size; ++i) { band->data[i] = 0; }
+    band->nrow = nrow;
+    band->ncol = ncol;
+    band->kl   = kl;
+    band->ku   = ku;
+}
+// the cols [*lo, *hi) of the row of a band inside the matrix
+static void cmat_band_cols(const CMatBand *band, size_t row, size_t *lo, size_t *hi) {
+    *lo = row > band->kl ? row - band->kl : 0;
+    *hi = CMAT_MIN(band->ncol, row + band->ku + 1);
+    *hi = CMAT_MAX(*lo, *hi);
+}
+void CMatBand_from_dense(CMatBand *band, const CMat *src, size_t kl, size_t ku) {
+    CMatBand_init(band, src->nrow, src->ncol, kl, ku);
+    for (size_t i = 0; i < src->nrow; ++i) {
+        size_t lo, hi;
+        cmat_band_cols(band, i, &lo, &hi);
+        for (size_t j = lo; j < hi; ++j) { CMatBand_at(band, i, j) = CMat_at(src, i, j); }
     }
-    return det;
 }
-void CMat_adj(CMat *dst, const CMat *src) {
-    CMAT_ASSERT(src->nrow == src->ncol, "adj only defined for square matrix");
-    CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");
-    CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");
+void CMatBand_to_dense(CMat *dst, const CMatBand *band) {
+    CMAT_ASSERT(dst->nrow == band->nrow && dst->ncol == band->ncol, "size don't match");
 
-    CMat_iterate(src, row, col, unused, {
-        (void)unused;
-        CMat_at(dst, col, row) = CMat_cofactor(src, row, col);
+    CMat_iterate(dst, row, col, val, {
+        *val = row <= col + band->kl && col <= row + band->ku ? CMatBand_at(band, row, col) : 0;
     });
 }
-bool CMat_inverse(CMat *cmat) {
-    CMat id;
-    CMat_init(&id, cmat->nrow, cmat->ncol);
-    CMat_identity(&id);
+void CMatBand_dot(CMat *dst, const CMatBand *band, const CMat *b) {
+    CMAT_ASSERT(band->ncol == b->nrow, "band->ncol should match with b->nrow");
+    CMAT_ASSERT(dst->nrow == band->nrow && dst->ncol == b->ncol, "dst size don't match");
 
-    for (size_t i = 0; i < cmat->nrow; ++i) {
-        if (CMat_at(cmat, i, i) == 0) {
-            bool   found = false;
-            size_t j     = i + 1;
-            for (; j < cmat->nrow; ++j) {
-                if (CMat_at(cmat, j, i) != 0) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                CMat_deinit(&id);
-                return false;
-            }
+    CMAT_STAT_BEGIN();
+    const CMatKernels *kern = cmat_get_kernels();
+    size_t             m    = b->ncol;
+    for (size_t i = 0; i < band->nrow; ++i) {
+        size_t lo, hi;
+        cmat_band_cols(band, i, &lo, &hi);
+        CMatType *d_row = CMat_pat(dst, i, 0);
+        if (lo == hi) {
+            for (size_t j = 0; j < m; ++j) { d_row[j] = 0; }
+            continue;
+        }
+        kern->scale(m, d_row, CMatBand_at(band, i, lo), CMat_pat(b, lo, 0));
+        for (size_t j = lo + 1; j < hi; ++j) {
+            cmat_row_axpy(kern, m, d_row, CMatBand_at(band, i, j), CMat_pat(b, j, 0));
+        }
+    }
+    CMAT_STAT_END(CMAT_STAT_BAND_DOT, 2.0 * band->nrow * (band->kl + band->ku + 1) * m,
+                  dst->nrow * m);
+}
 
-            for (size_t k = 0; k < cmat->ncol; ++k) {
-                CMatType temp       = CMat_at(cmat, i, k);
-                CMat_at(cmat, i, k) = CMat_at(cmat, j, k);
-                CMat_at(cmat, j, k) = temp;
+void CMatSym_init(CMatSym *sym, size_t n) {
+    sym->data = cmat_malloc(CMAT_PACKED_SIZE(n), sizeof(*sym->data));
+    CMAT_ASSERT(sym->data, "malloc failed");
+    sym->n = n;
+}
+void CMatSym_from_dense(CMatSym *sym, const CMat *src) {
+    CMAT_ASSERT(src->nrow == src->ncol, "src should be square");
 
-                temp               = CMat_at(&id, i, k);
-                CMat_at(&id, i, k) = CMat_at(&id, j, k);
-                CMat_at(&id, j, k) = temp;
-            }
-        }
+    CMatSym_init(sym, src->nrow);
+    for (size_t i = 0; i < sym->n; ++i) {
+        for (size_t j = 0; j <= i; ++j) { CMatSym_at(sym, i, j) = CMat_at(src, i, j); }
+    }
+}
+void CMatSym_to_dense(CMat *dst, const CMatSym *sym) {
+    CMAT_ASSERT(dst->nrow == sym->n && dst->ncol == sym->n, "size don't match");
 
-        CMatType div = CMat_at(cmat, i, i);
-        for (size_t col = 0; col < cmat->ncol; ++col) { CMat_at(cmat, i, col) /= div; }
-        for (size_t col = 0; col < id.ncol; ++col) { CMat_at(&id, i, col) /= div; }
+    CMat_iterate(dst, row, col, val,
+                 *val = row >= col ? CMatSym_at(sym, row, col) : CMatSym_at(sym, col, row););
+}
+void CMatSym_dot(CMat *dst, const CMatSym *sym, const CMat *b) {
+    CMAT_ASSERT(b->nrow == sym->n, "b->nrow should match with sym->n");
+    CMAT_ASSERT(dst->nrow == b->nrow && dst->ncol == b->ncol, "dst should have the size of b");
 
-        for (size_t row = 0; row < cmat->nrow; ++row) {
-            if (row == i) { continue; }
-            CMatType x = CMat_at(cmat, row, i);
-            for (size_t col = 0; col < cmat->ncol; ++col) {
-                CMat_at(cmat, row, col) -= CMat_at(cmat, i, col) * x;
-            }
-            for (size_t col = 0; col < id.ncol; ++col) {
-                CMat_at(&id, row, col) -= CMat_at(&id, i, col) * x;
+    CMAT_STAT_BEGIN();
+    size_t n = sym->n, m = b->ncol;
+    if (m == 1) {
+        // s_ij (j < i) is added to y_i from x_j and to y_j from x_i
+        for (size_t i = 0; i < n; ++i) {
+            const CMatType *s_row = CMatSym_pat(sym, i, 0);
+            CMatType        x_i = CMat_at(b, i, 0), y_i = s_row[i] * x_i;
+            for (size_t j = 0; j < i; ++j) {
+                y_i += s_row[j] * CMat_at(b, j, 0);
+                CMat_at(dst, j, 0) += s_row[j] * x_i;
             }
+            CMat_at(dst, i, 0) = y_i;
         }
+        CMAT_STAT_END(CMAT_STAT_SYM_DOT, 2.0 * n * n, n);
+        return;
     }
 
-    CMat_iterate2(cmat, &id, row, col, val1, val2, *val1 = *val2;);
+    size_t    nb        = CMAT_MIN(CMAT_TRSM_NB, n);
+    size_t    tile_size = CMAT_MAX(n * nb, 1) * sizeof(CMatType);
+    CMatType *tile      = cmat_scratch_alloc(tile_size);
+    CMatTri   lower     = {.data = sym->data, .n = n, .upper = false};
+    for (size_t i0 = 0; i0 < n; i0 += nb) {
+        size_t ib = CMAT_MIN(nb, n - i0);
 
-    CMat_deinit(&id);
-    return true;
+        // the diagonal block, mirrored, is the first product of the block rows of dst
+        cmat_tri_unpack(tile, &lower, false, i0, ib, i0, ib);
+        for (size_t r = 0; r < ib; ++r) {
+            for (size_t c = r + 1; c < ib; ++c) { tile[r * ib + c] = tile[c * ib + r]; }
+        }
+        cmat_gemm_strided(ib, m, ib, 1, tile, ib, 1, CMat_pat(b, i0, 0), b->stride, 1, 0,
+                          CMat_pat(dst, i0, 0), dst->stride, 1);
+
+        // the block rows left of the diagonal is used for its rows and transposed for its cols
+        if (i0 > 0) {
+            cmat_tri_unpack(tile, &lower, false, i0, ib, 0, i0);
+            cmat_gemm_strided(ib, m, i0, 1, tile, i0, 1, b->data, b->stride, 1, 1,
+                              CMat_pat(dst, i0, 0), dst->stride, 1);
+            cmat_gemm_strided(i0, m, ib, 1, tile, 1, i0, CMat_pat(b, i0, 0), b->stride, 1, 1,
+                              dst->data, dst->stride, 1);
+        }
+    }
+    cmat_scratch_free(tile, tile_size);
+    CMAT_STAT_END(CMAT_STAT_SYM_DOT, 2.0 * n * n * m, n * m);
 }
 
 static size_t str_size_f(CMatType f, size_t float_pres) {
@@ -655,8 +7211,7 @@ static size_t str_size_f(CMatType f, size_t float_pres) {
 
 #ifndef CMAT_NO_PRINT
 void CMat_fprint_pres(FILE *f, const CMat *cmat, size_t float_pres) {
-    size_t *max_elems_size = CMAT_MALLOC(cmat->ncol, sizeof(*max_elems_size));
-    CMAT_ASSERT(max_elems_size, "malloc failed");
+    size_t *max_elems_size = cmat_scratch_alloc(cmat->ncol * sizeof(*max_elems_size));
 
     size_t max_row_size = cmat->ncol - 1;
     for (size_t col = 0; col < cmat->ncol; ++col) { max_elems_size[col] = 0; }
@@ -672,7 +7227,7 @@ void CMat_fprint_pres(FILE *f, const CMat *cmat, size_t float_pres) {
         }
     }
 
-    fprintf(f, "--%*s--\n", max_row_size, "");
+    fprintf(f, "--%*s--\n", (int)max_row_size, "");
 
     for (size_t row = 0; row < cmat->nrow; ++row) {
         for (size_t col = 0; col < cmat->ncol; ++col) {
@@ -681,13 +7236,1065 @@ void CMat_fprint_pres(FILE *f, const CMat *cmat, size_t float_pres) {
             CMatType cur_elem      = CMat_at(cmat, row, col);
             size_t   cur_elem_size = str_size_f(cur_elem, float_pres);
 
-            fprintf(f, "%*s%.*lf ", max_elems_size[col] - cur_elem_size, "", float_pres, cur_elem);
+            fprintf(f, "%*s%.*lf ", (int)(max_elems_size[col] - cur_elem_size), "", (int)float_pres,
+                    cur_elem);
         }
         fputs("|\n", f);
     }
-    fprintf(f, "--%*s--\n", max_row_size, "");
+    fprintf(f, "--%*s--\n", (int)max_row_size, "");
+
+    cmat_scratch_free(max_elems_size, cmat->ncol * sizeof(*max_elems_size));
+}
+#endif // CMAT_NO_PRINT
+#ifndef CMAT_NO_PRINT
+#include <limits.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define CMAT_HAS_MMAP
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CMAT_HAS_MMAP
+#endif // _WIN32
+
+_Static_assert(sizeof(CMatBinHeader) == CMAT_BIN_HEADER_SIZE, "CMatBinHeader is padded");
+
+// the byte order of the machine
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CMAT_BIN_NATIVE CMAT_BIN_BIG
+#else
+#define CMAT_BIN_NATIVE CMAT_BIN_LITTLE
+#endif // __BYTE_ORDER__
+// the CMatBinType of the type T (fail to compile for the other types)
+#define CMAT_BIN_TYPE_OF(T)                                                                        \
+    _Generic((T)0, double: CMAT_BIN_F64, float: CMAT_BIN_F32, int32_t: CMAT_BIN_I32,              \
+             float _Complex: CMAT_BIN_C64, double _Complex: CMAT_BIN_C128)
+
+#define CMAT_HASH_OFFSET 0xcbf29ce484222325ULL
+#define CMAT_HASH_PRIME 0x100000001b3ULL
+// the state of the checksum of CMatBinHeader
+typedef struct {
+    uint64_t      lane[4];
+    uint64_t      size;     // the number of bytes given to cmat_hash_update
+    unsigned char tail[32]; // the size % 32 last bytes
+} CMatHash;
+
+static void cmat_hash_init(CMatHash *hash) {
+    for (size_t i = 0; i < 4; ++i) { hash->lane[i] = CMAT_HASH_OFFSET + i; }
+    hash->size = 0;
+}
+// hash 4 words, the lanes don't depend on each other so the multiplications are pipelined
+static void cmat_hash_block(CMatHash *hash, const unsigned char *block) {
+    for (size_t i = 0; i < 4; ++i) {
+        // compiled to a single load on a little endian machine
+        uint64_t word = 0;
+        for (size_t b = 0; b < 8; ++b) { word |= (uint64_t)block[i * 8 + b] << (b * 8); }
+        uint64_t lane = (hash->lane[i] ^ word) * CMAT_HASH_PRIME;
+        hash->lane[i] = lane << 27 | lane >> 37;
+    }
+}
+static void cmat_hash_update(CMatHash *hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    size_t               used  = hash->size % 32;
+    hash->size += size;
+    if (used) {
+        size_t n = CMAT_MIN(32 - used, size);
+        for (size_t i = 0; i < n; ++i) { hash->tail[used + i] = bytes[i]; }
+        if (used + n < 32) { return; }
+        cmat_hash_block(hash, hash->tail);
+        bytes += n;
+        size -= n;
+    }
+    for (; size >= 32; bytes += 32, size -= 32) { cmat_hash_block(hash, bytes); }
+    for (size_t i = 0; i < size; ++i) { hash->tail[i] = bytes[i]; }
+}
+static uint64_t cmat_hash_final(CMatHash *hash) {
+    size_t used = hash->size % 32;
+    if (used) {
+        for (size_t i = used; i < 32; ++i) { hash->tail[i] = 0; }
+        cmat_hash_block(hash, hash->tail);
+    }
+    uint64_t res = CMAT_HASH_OFFSET;
+    for (size_t i = 0; i < 4; ++i) { res = (res ^ hash->lane[i]) * CMAT_HASH_PRIME; }
+    return (res ^ hash->size) * CMAT_HASH_PRIME;
+}
+
+// reverse the byte order of count units of unit_size bytes
+static void cmat_bin_swap(void *data, size_t count, size_t unit_size) {
+    unsigned char *bytes = data;
+    for (size_t i = 0; i < count; ++i, bytes += unit_size) {
+        for (size_t b = 0; b < unit_size / 2; ++b) {
+            unsigned char tmp         = bytes[b];
+            bytes[b]                  = bytes[unit_size - 1 - b];
+            bytes[unit_size - 1 - b] = tmp;
+        }
+    }
+}
+// the size of the units to swap of an element (a complex is 2 floating point values)
+static size_t cmat_bin_unit(CMatBinType type, size_t elem_size) {
+    return type == CMAT_BIN_C64 || type == CMAT_BIN_C128 ? elem_size / 2 : elem_size;
+}
+// convert a header read from a file to the byte order of the machine and check it describe a
+// matrix of type, swap is true if the data are in the other byte order
+static bool cmat_bin_parse(CMatBinHeader *header, CMatBinType type, size_t elem_size, bool *swap) {
+    static const char magic[4] = {'C', 'M', 'A', 'T'};
+    for (size_t i = 0; i < 4; ++i) {
+        if (header->magic[i] != magic[i]) { return false; }
+    }
+    if (header->endian != CMAT_BIN_LITTLE && header->endian != CMAT_BIN_BIG) { return false; }
+    *swap = header->endian != CMAT_BIN_NATIVE;
+    // nrow, ncol, stride, offset and checksum
+    if (*swap) { cmat_bin_swap(&header->nrow, 5, sizeof(uint64_t)); }
+
+    // the offset is skipped by fseek (a long) and must keep the mapped elements aligned
+    return header->version != 0 && header->version <= CMAT_BIN_VERSION && header->type == type &&
+           header->elem_size == elem_size && header->stride >= header->ncol &&
+           header->offset >= CMAT_BIN_HEADER_SIZE &&
+           header->offset - CMAT_BIN_HEADER_SIZE <= LONG_MAX && header->offset % elem_size == 0 &&
+           header->nrow <= SIZE_MAX &&
+           (header->stride == 0 || header->nrow <= SIZE_MAX / elem_size / header->stride);
+}
+
+static bool cmat_bin_write(FILE *f, CMatBinType type, size_t elem_size, const void *data,
+                           size_t nrow, size_t ncol, size_t stride) {
+    const unsigned char *bytes    = data;
+    size_t               row_size = ncol * elem_size;
+
+    CMatHash hash;
+    cmat_hash_init(&hash);
+    for (size_t row = 0; row < nrow; ++row) {
+        cmat_hash_update(&hash, bytes + row * stride * elem_size, row_size);
+    }
+
+    // the rows are written without their padding
+    CMatBinHeader header = {
+        .magic     = {'C', 'M', 'A', 'T'},
+        .version   = CMAT_BIN_VERSION,
+        .type      = type,
+        .elem_size = elem_size,
+        .endian    = CMAT_BIN_NATIVE,
+        .nrow      = nrow,
+        .ncol      = ncol,
+        .stride    = ncol,
+        .offset    = CMAT_BIN_HEADER_SIZE,
+        .checksum  = cmat_hash_final(&hash),
+    };
+    if (fwrite(&header, sizeof(header), 1, f) != 1) { return false; }
+    if (stride == ncol) { return fwrite(data, elem_size, nrow * ncol, f) == nrow * ncol; }
+    for (size_t row = 0; row < nrow; ++row) {
+        if (fwrite(bytes + row * stride * elem_size, elem_size, ncol, f) != ncol) { return false; }
+    }
+    return true;
+}
+
+// read a matrix of type written by cmat_bin_write in an allocation of nrow * stride elements
+static bool cmat_bin_read(FILE *f, CMatBinType type, size_t elem_size, void **data, size_t *nrow,
+                          size_t *ncol, size_t *stride) {
+    CMatBinHeader header;
+    bool          swap;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        !cmat_bin_parse(&header, type, elem_size, &swap)) {
+        return false;
+    }
+    if (header.offset > CMAT_BIN_HEADER_SIZE &&
+        fseek(f, (long)(header.offset - CMAT_BIN_HEADER_SIZE), SEEK_CUR) != 0) {
+        return false;
+    }
+
+    // a corrupted header can ask for any size
+    size_t count = header.nrow * header.stride;
+    void  *buf   = cmat_malloc(CMAT_MAX(count, 1), elem_size);
+    if (!buf) { return false; }
+
+    CMatHash hash;
+    cmat_hash_init(&hash);
+    if (fread(buf, elem_size, count, f) != count) {
+        CMAT_FREE(buf);
+        return false;
+    }
+    cmat_hash_update(&hash, buf, count * elem_size);
+    if (cmat_hash_final(&hash) != header.checksum) {
+        CMAT_FREE(buf);
+        return false;
+    }
+    if (swap) {
+        size_t unit = cmat_bin_unit(type, elem_size);
+        cmat_bin_swap(buf, count * (elem_size / unit), unit);
+    }
+
+    *data   = buf;
+    *nrow   = header.nrow;
+    *ncol   = header.ncol;
+    *stride = header.stride;
+    return true;
+}
+
+#ifdef CMAT_HAS_MMAP
+// map the whole file at path copy on write
+static bool cmat_map_file(CMatMap *map, const char *path) {
+    map->addr   = NULL;
+    map->mapped = true;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart >= CMAT_BIN_HEADER_SIZE &&
+        (uint64_t)size.QuadPart <= SIZE_MAX) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping) {
+            map->addr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            map->size = size.QuadPart;
+            // the view keep the mapping alive
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    return map->addr != NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= CMAT_BIN_HEADER_SIZE &&
+        (uint64_t)st.st_size <= SIZE_MAX) {
+        map->size = st.st_size;
+        map->addr = mmap(NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map->addr == MAP_FAILED) { map->addr = NULL; }
+    }
+    // the mapping keep the file alive
+    close(fd);
+    return map->addr != NULL;
+#endif // _WIN32
+}
+#endif // CMAT_HAS_MMAP
+
+static bool cmat_bin_map(CMatMap *map, const char *path, bool verify, CMatBinType type,
+                         size_t elem_size, void **data, size_t *nrow, size_t *ncol,
+                         size_t *stride) {
+#ifdef CMAT_HAS_MMAP
+    if (!cmat_map_file(map, path)) { return false; }
+
+    // the mapping is page aligned
+    CMatBinHeader header = *(const CMatBinHeader *)map->addr;
+    bool          swap   = false;
+    bool          valid  = cmat_bin_parse(&header, type, elem_size, &swap);
+    size_t        size   = header.nrow * header.stride * elem_size;
+    valid = valid && header.offset <= map->size && size <= map->size - header.offset;
+    if (valid && !swap) {
+        unsigned char *buf = (unsigned char *)map->addr + header.offset;
+        if (verify) {
+            CMatHash hash;
+            cmat_hash_init(&hash);
+            cmat_hash_update(&hash, buf, size);
+            valid = cmat_hash_final(&hash) == header.checksum;
+        }
+        if (valid) {
+            *data   = buf;
+            *nrow   = header.nrow;
+            *ncol   = header.ncol;
+            *stride = header.stride;
+            return true;
+        }
+    }
+    CMat_munmap(map);
+    if (!valid) { return false; }
+    // the data of a file in the other byte order can't be used in place
+#endif // CMAT_HAS_MMAP
+
+    FILE *f = fopen(path, "rb");
+    if (!f) { return false; }
+    bool res = cmat_bin_read(f, type, elem_size, data, nrow, ncol, stride);
+    fclose(f);
+    if (!res) { return false; }
+
+    map->addr   = *data;
+    map->size   = *nrow * *stride * elem_size;
+    map->mapped = false;
+    return true;
+}
+
+void CMat_munmap(CMatMap *map) {
+    if (!map->mapped) {
+        CMAT_FREE(map->addr);
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(map->addr);
+#elif defined(CMAT_HAS_MMAP)
+    munmap(map->addr, map->size);
+#endif // _WIN32
+}
+
+// define the binary I/O of the family X (see CMAT_DECLARE_TYPE_IO)
+#define CMAT_DEFINE_TYPE_IO(X)                                                                     \
+    bool X##_write(FILE *f, const X *cmat) {                                                       \
+        return cmat_bin_write(f, CMAT_BIN_TYPE_OF(X##Type), sizeof(X##Type), cmat->data,           \
+                              cmat->nrow, cmat->ncol, cmat->stride);                               \
+    }                                                                                              \
+    bool X##_read(FILE *f, X *cmat) {                                                              \
+        void *data;                                                                                \
+        if (!cmat_bin_read(f, CMAT_BIN_TYPE_OF(X##Type), sizeof(X##Type), &data, &cmat->nrow,      \
+                           &cmat->ncol, &cmat->stride)) {                                          \
+            return false;                                                                          \
+        }                                                                                          \
+        cmat->data = data;                                                                         \
+        return true;                                                                               \
+    }                                                                                              \
+    bool X##_save(const char *path, const X *cmat) {                                               \
+        FILE *f = fopen(path, "wb");                                                               \
+        if (!f) { return false; }                                                                  \
+        bool res = X##_write(f, cmat);                                                             \
+        return fclose(f) == 0 && res;                                                              \
+    }                                                                                              \
+    bool X##_load(const char *path, X *cmat) {                                                     \
+        FILE *f = fopen(path, "rb");                                                               \
+        if (!f) { return false; }                                                                  \
+        bool res = X##_read(f, cmat);                                                              \
+        fclose(f);                                                                                 \
+        return res;                                                                                \
+    }                                                                                              \
+    bool X##_mmap(CMatMap *map, X *cmat, const char *path, bool verify) {                          \
+        void *data;                                                                                \
+        if (!cmat_bin_map(map, path, verify, CMAT_BIN_TYPE_OF(X##Type), sizeof(X##Type), &data,    \
+                          &cmat->nrow, &cmat->ncol, &cmat->stride)) {                              \
+            return false;                                                                          \
+        }                                                                                          \
+        cmat->data = data;                                                                         \
+        return true;                                                                               \
+    }
+
+CMAT_DEFINE_TYPE_IO(CMat)
+
+#include <string.h>
+
+// the size of the buffers of CMat_csv_write and CMatCsvReader (a line longer grow the buffer)
+#define CMAT_CSV_BUF_SIZE (1 << 16)
+
+// the powers of 10 exactly representable by a double
+static const double cmat_pow10[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                      1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                      1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// parse a decimal number at str like strtod without its locale, the fast path of Clinger when
+// the digits and the power of 10 are exact doubles (a single rounding) else strtod, decimal only:
+// "0x10" stop after its "0" (strtod is only reached after a decimal digit or for "nan" and "inf")
+// so the caller see the 'x' and reject it
+static double cmat_parse_double(const char *str, char **end) {
+    const char *p   = str;
+    bool        neg = *p == '-';
+    if (*p == '-' || *p == '+') { ++p; }
+
+    uint64_t mant = 0;
+    int      nsignificant = 0, exp10 = 0;
+    bool     any_digit = false;
+    for (; *p >= '0' && *p <= '9'; ++p, any_digit = true) {
+        if (nsignificant == 19) { return strtod(str, end); }
+        mant = mant * 10 + (*p - '0');
+        nsignificant += mant != 0;
+    }
+    if (*p == '.') {
+        for (++p; *p >= '0' && *p <= '9'; ++p, any_digit = true) {
+            if (nsignificant == 19) { return strtod(str, end); }
+            mant = mant * 10 + (*p - '0');
+            nsignificant += mant != 0;
+            --exp10;
+        }
+    }
+    // "nan", "inf" or not a number
+    if (!any_digit) { return strtod(str, end); }
+    if (*p == 'e' || *p == 'E') {
+        const char *q       = p + 1;
+        bool        exp_neg = *q == '-';
+        if (*q == '-' || *q == '+') { ++q; }
+        if (*q >= '0' && *q <= '9') {
+            int exp = 0;
+            for (; *q >= '0' && *q <= '9'; ++q) {
+                if (exp > 10000) { return strtod(str, end); }
+                exp = exp * 10 + (*q - '0');
+            }
+            exp10 += exp_neg ? -exp : exp;
+            p = q;
+        }
+    }
+    // a zero keep its sign whatever its exponent
+    if (mant == 0) {
+        *end = (char *)p;
+        return neg ? -0.0 : 0.0;
+    }
+    if (exp10 < -22 || exp10 > 22) { return strtod(str, end); }
+
+    double pow = cmat_pow10[exp10 < 0 ? -exp10 : exp10];
+    double res;
+    if (mant <= (uint64_t)1 << 53) {
+        res = exp10 < 0 ? (double)mant / pow : (double)mant * pow;
+    } else {
+        // mant = mant_hi + mant_lo, the result is the exact hi and a small lo rounded only once
+        // and so is rounded right unless it's too close to the half between 2 doubles
+        double mant_hi = (double)mant;
+        double mant_lo = (double)(int64_t)(mant - (uint64_t)mant_hi);
+        double hi, lo;
+        if (exp10 >= 0) {
+            hi = mant_hi * pow;
+            lo = fma(mant_hi, pow, -hi) + mant_lo * pow;
+        } else {
+            hi = mant_hi / pow;
+            lo = (fma(-hi, pow, mant_hi) + mant_lo) / pow;
+        }
+        res = hi + lo;
+
+        int    exp2;
+        double err      = (hi - res) + lo;
+        double half_ulp = ldexp(1, ilogb(res) - 53);
+        // the half below a power of 2 is at half_ulp / 2
+        if (fabs(fabs(err) - half_ulp) < half_ulp * 0x1p-20 || frexp(res, &exp2) == 0.5) {
+            return strtod(str, end);
+        }
+    }
+    *end = (char *)p;
+    return neg ? -res : res;
+}
+
+// write x at buf (32 bytes) like snprintf "%.*g" with precision <= 17 digits and return the size
+// written, the value times a power of 10 is kept as the exact sum of 2 doubles (with a fma) and
+// rounded to an integer, the values too big or too small for an exact power of 10 use snprintf
+static size_t cmat_format_double(char *buf, double x, int precision) {
+    double ax = fabs(x);
+    if (ax == 0 || !isfinite(ax)) { return snprintf(buf, 32, "%.*g", precision, x); }
+
+    // log10 can be off by 1 near a power of 10
+    int      exp10 = (int)floor(log10(ax));
+    uint64_t digits;
+    for (;;) {
+        int k = precision - 1 - exp10;
+        if (k < -22 || k > 22) { return snprintf(buf, 32, "%.*g", precision, x); }
+
+        // ax * 10^k = hi + lo
+        double hi, lo;
+        if (k >= 0) {
+            hi = ax * cmat_pow10[k];
+            lo = fma(ax, cmat_pow10[k], -hi);
+        } else {
+            hi = ax / cmat_pow10[-k];
+            lo = fma(-hi, cmat_pow10[-k], ax) / cmat_pow10[-k];
+        }
+        double min = cmat_pow10[precision - 1], max = cmat_pow10[precision];
+        if (hi < min || (hi == min && lo < 0)) {
+            --exp10;
+            continue;
+        }
+        if (hi > max || (hi == max && lo >= 0)) {
+            ++exp10;
+            continue;
+        }
+
+        // round half to even like printf: hi >= 1 so frac - 0.5 is exact, above 2^53 hi is an
+        // integer and lo can be bigger than 1
+        double base = floor(hi), frac = hi - base;
+        digits      = (uint64_t)base;
+        if (frac == 0) {
+            digits += (int64_t)floor(lo);
+            frac = lo - floor(lo);
+            lo   = 0;
+        }
+        double diff = (frac - 0.5) + lo;
+        // the lo of a division is rounded, a value too close to the half can be on the wrong side
+        if (k < 0 && fabs(diff) < 0x1p-30) { return snprintf(buf, 32, "%.*g", precision, x); }
+        digits += diff > 0 || (diff == 0 && digits % 2 == 1);
+        if (digits == (uint64_t)max) {
+            digits /= 10;
+            ++exp10;
+        }
+        break;
+    }
+
+    char   str[17];
+    size_t ndigit = precision;
+    for (size_t i = ndigit; i-- > 0; digits /= 10) { str[i] = '0' + digits % 10; }
+    while (ndigit > 1 && str[ndigit - 1] == '0') { --ndigit; }
+
+    size_t size = 0;
+    if (x < 0) { buf[size++] = '-'; }
+    if (exp10 < -4 || exp10 >= precision) {
+        buf[size++] = str[0];
+        if (ndigit > 1) { buf[size++] = '.'; }
+        for (size_t i = 1; i < ndigit; ++i) { buf[size++] = str[i]; }
+        buf[size++]  = 'e';
+        buf[size++]  = exp10 < 0 ? '-' : '+';
+        unsigned exp = exp10 < 0 ? -exp10 : exp10;
+        if (exp >= 100) { buf[size++] = '0' + exp / 100; }
+        buf[size++] = '0' + exp / 10 % 10;
+        buf[size++] = '0' + exp % 10;
+    } else if (exp10 >= 0) {
+        for (size_t i = 0; i <= (size_t)exp10; ++i) { buf[size++] = i < ndigit ? str[i] : '0'; }
+        if (ndigit > (size_t)exp10 + 1) { buf[size++] = '.'; }
+        for (size_t i = exp10 + 1; i < ndigit; ++i) { buf[size++] = str[i]; }
+    } else {
+        buf[size++] = '0';
+        buf[size++] = '.';
+        for (int i = -1; i > exp10; --i) { buf[size++] = '0'; }
+        for (size_t i = 0; i < ndigit; ++i) { buf[size++] = str[i]; }
+    }
+    return size;
+}
+
+bool CMat_csv_write(FILE *f, const CMat *cmat, char delim, int precision) {
+    CMAT_ASSERT(1 <= precision && precision <= 17, "precision must be in [1, 17]");
+    char  *buf  = cmat_scratch_alloc(CMAT_CSV_BUF_SIZE);
+    size_t used = 0;
+    bool   res  = true;
+
+    for (size_t row = 0; row < cmat->nrow; ++row) {
+        for (size_t col = 0; col < cmat->ncol; ++col) {
+            // a value and its separator are at most 33 bytes
+            if (used > CMAT_CSV_BUF_SIZE - 33) {
+                res  = res && fwrite(buf, 1, used, f) == used;
+                used = 0;
+            }
+            used += cmat_format_double(buf + used, CMat_at(cmat, row, col), precision);
+            buf[used++] = col + 1 < cmat->ncol ? delim : '\n';
+        }
+    }
+    res = res && fwrite(buf, 1, used, f) == used;
+
+    cmat_scratch_free(buf, CMAT_CSV_BUF_SIZE);
+    return res;
+}
+
+void CMat_csv_reader_init(CMatCsvReader *reader, FILE *f, char delim) {
+    // + 1 for a '\0' after the text so the parsing stop at the end of the last line
+    reader->buf = cmat_malloc(CMAT_CSV_BUF_SIZE + 1, 1);
+    CMAT_ASSERT(reader->buf, "malloc failed");
+
+    reader->f     = f;
+    reader->size  = CMAT_CSV_BUF_SIZE;
+    reader->begin = 0;
+    reader->end   = 0;
+    reader->line  = 1;
+    reader->delim = delim;
+    reader->eof   = false;
+    reader->error = false;
+}
+void CMat_csv_reader_deinit(CMatCsvReader *reader) {
+    // give back the text read ahead
+    if (reader->end > reader->begin) {
+        fseek(reader->f, -(long)(reader->end - reader->begin), SEEK_CUR);
+    }
+    CMAT_FREE(reader->buf);
+}
+
+// read until the next line is in buf and return its size (without the '\n') or SIZE_MAX at the
+// end of the file
+static size_t cmat_csv_line(CMatCsvReader *reader) {
+    size_t scan = reader->begin;
+    for (;;) {
+        const char *newline = memchr(reader->buf + scan, '\n', reader->end - scan);
+        if (newline) { return newline - (reader->buf + reader->begin); }
+        size_t len = reader->end - reader->begin;
+        if (reader->eof || reader->error) { return len ? len : SIZE_MAX; }
+
+        // move the beginning of the line at the start of buf or grow buf if the line fill it
+        if (reader->begin > 0) {
+            memmove(reader->buf, reader->buf + reader->begin, len);
+        } else if (len == reader->size) {
+            char *buf = cmat_malloc(2 * reader->size + 1, 1);
+            CMAT_ASSERT(buf, "malloc failed");
+            memcpy(buf, reader->buf, len);
+            CMAT_FREE(reader->buf);
+            reader->buf = buf;
+            reader->size *= 2;
+        }
+        reader->begin = 0;
+        reader->end   = len;
+        scan          = len;
+
+        size_t nread = fread(reader->buf + len, 1, reader->size - len, reader->f);
+        reader->end += nread;
+        reader->buf[reader->end] = '\0';
+        if (nread < reader->size - len) {
+            reader->eof   = true;
+            reader->error = ferror(reader->f) != 0;
+        }
+    }
+}
+// go to the line after the one of size len
+static void cmat_csv_next_line(CMatCsvReader *reader, size_t len) {
+    // the last line can have no '\n'
+    reader->begin = CMAT_MIN(reader->begin + len + 1, reader->end);
+    ++reader->line;
+}
+// parse at most max values of the line [str, end) in row (if not NULL) and return the number of
+// values or SIZE_MAX if the line can't be parsed (or has more than max values)
+static size_t cmat_csv_parse(const char *str, const char *end, char delim, CMatType *row,
+                             size_t max) {
+    if (end > str && end[-1] == '\r') { --end; }
+    // with delim ' ' the values are separated by any spaces and tabs
+    bool        space_delim = delim == ' ';
+    const char *p           = str;
+    for (size_t n = 0;; ++n) {
+        while (p < end && (*p == ' ' || (*p == '\t' && delim != '\t'))) { ++p; }
+        // an empty line or the spaces at the end of a line
+        if (p == end && (n == 0 || space_delim)) { return n; }
+        if (n == max) { return SIZE_MAX; }
+
+        char    *num_end;
+        CMatType val = cmat_parse_double(p, &num_end);
+        if (num_end == p || num_end > end) { return SIZE_MAX; }
+        if (row) { row[n] = val; }
+
+        p = num_end;
+        while (p < end && (*p == ' ' || (*p == '\t' && delim != '\t'))) { ++p; }
+        if (p == end) { return n + 1; }
+        if (space_delim) {
+            if (p == num_end) { return SIZE_MAX; }
+        } else if (*p++ != delim) {
+            return SIZE_MAX;
+        }
+    }
+}
+
+size_t CMat_csv_reader_skip(CMatCsvReader *reader, size_t nline) {
+    size_t nskip = 0;
+    for (; nskip < nline; ++nskip) {
+        size_t len = cmat_csv_line(reader);
+        if (len == SIZE_MAX) { break; }
+        cmat_csv_next_line(reader, len);
+    }
+    return nskip;
+}
+size_t CMat_csv_reader_ncol(CMatCsvReader *reader) {
+    for (;;) {
+        size_t len = cmat_csv_line(reader);
+        if (len == SIZE_MAX) { return 0; }
+
+        const char *str = reader->buf + reader->begin;
+        size_t      n   = cmat_csv_parse(str, str + len, reader->delim, NULL, SIZE_MAX);
+        if (n == SIZE_MAX) {
+            reader->error = true;
+            return 0;
+        }
+        if (n != 0) { return n; }
+        cmat_csv_next_line(reader, len);
+    }
+}
+size_t CMat_csv_reader_read(CMatCsvReader *reader, CMat *dst) {
+    size_t nrow = 0;
+    while (nrow < dst->nrow && !reader->error) {
+        size_t len = cmat_csv_line(reader);
+        if (len == SIZE_MAX) { break; }
 
-    CMAT_FREE(max_elems_size);
+        const char *str = reader->buf + reader->begin;
+        size_t n = cmat_csv_parse(str, str + len, reader->delim, CMat_pat(dst, nrow, 0), dst->ncol);
+        if (n == 0) {
+            cmat_csv_next_line(reader, len);
+            continue;
+        }
+        if (n != dst->ncol) {
+            reader->error = true;
+            break;
+        }
+        cmat_csv_next_line(reader, len);
+        ++nrow;
+    }
+    return nrow;
+}
+bool CMat_csv_read(FILE *f, CMat *dst, char delim) {
+    CMatCsvReader reader;
+    CMat_csv_reader_init(&reader, f, delim);
+    size_t nrow = CMat_csv_reader_read(&reader, dst);
+    CMat_csv_reader_deinit(&reader);
+    return nrow == dst->nrow;
 }
 #endif // CMAT_NO_PRINT
+#ifndef CMAT_NO_TYPES
+// the kernels of a family of CMAT_DECLARE_TYPE for an instruction set (like CMatKernels), the
+// packing of the gemm and the scalar kernels
+#define CMAT_DEFINE_TYPE_BASE(X, T)                                                                \
+    typedef struct {                                                                               \
+        size_t mr;                                                                                 \
+        size_t nr;                                                                                 \
+        void (*gemm_ukernel)(size_t kc, T alpha, const T *a, const T *b, T beta, T *c, size_t rsc, \
+                             size_t csc);                                                          \
+        void (*add)(size_t n, T *dst, const T *a, const T *b);                                     \
+        void (*sub)(size_t n, T *dst, const T *a, const T *b);                                     \
+        void (*mul)(size_t n, T *dst, const T *a, const T *b);                                     \
+        void (*scale)(size_t n, T *dst, T alpha, const T *src);                                    \
+        void (*axpy)(size_t n, T *dst, T alpha, const T *src);                                     \
+        T (*sum)(size_t n, const T *src);                                                          \
+        T (*dot)(size_t n, const T *a, const T *b);                                                \
+    } X##Kernels;                                                                                  \
+    static void X##_gemm_store_tile(size_t m, size_t n, T alpha, const T *ab, size_t ldab, T beta, \
+                                    T *c, size_t rsc, size_t csc) {                                \
+        for (size_t i = 0; i < m; ++i) {                                                           \
+            for (size_t j = 0; j < n; ++j) {                                                       \
+                T *cij = c + i * rsc + j * csc;                                                    \
+                *cij = (beta == 0) ? alpha * ab[i * ldab + j]                                      \
+                                   : alpha * ab[i * ldab + j] + beta * *cij;                       \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static void X##_gemm_pack_a(T *restrict dst, const T *restrict a, size_t rsa, size_t mc,       \
+                                size_t kc, size_t mr) {                                            \
+        for (size_t ir = 0; ir < mc; ir += mr) {                                                   \
+            size_t m = CMAT_MIN(mr, mc - ir);                                                      \
+            for (size_t p = 0; p < kc; ++p) {                                                      \
+                size_t i = 0;                                                                      \
+                for (; i < m; ++i) { dst[i] = a[(ir + i) * rsa + p]; }                             \
+                for (; i < mr; ++i) { dst[i] = 0; }                                                \
+                dst += mr;                                                                         \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static void X##_gemm_pack_b(T *restrict dst, const T *restrict b, size_t rsb, size_t kc,       \
+                                size_t nc, size_t nr) {                                            \
+        for (size_t jr = 0; jr < nc; jr += nr) {                                                   \
+            size_t n = CMAT_MIN(nr, nc - jr);                                                      \
+            for (size_t p = 0; p < kc; ++p) {                                                      \
+                size_t j = 0;                                                                      \
+                for (; j < n; ++j) { dst[j] = b[p * rsb + jr + j]; }                               \
+                for (; j < nr; ++j) { dst[j] = 0; }                                                \
+                dst += nr;                                                                         \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static void X##_add_scalar(size_t n, T *dst, const T *a, const T *b) {                         \
+        for (size_t i = 0; i < n; ++i) { dst[i] = a[i] + b[i]; }                                   \
+    }                                                                                              \
+    static void X##_sub_scalar(size_t n, T *dst, const T *a, const T *b) {                         \
+        for (size_t i = 0; i < n; ++i) { dst[i] = a[i] - b[i]; }                                   \
+    }                                                                                              \
+    static void X##_mul_scalar(size_t n, T *dst, const T *a, const T *b) {                         \
+        for (size_t i = 0; i < n; ++i) { dst[i] = a[i] * b[i]; }                                   \
+    }                                                                                              \
+    static void X##_scale_scalar(size_t n, T *dst, T alpha, const T *src) {                        \
+        for (size_t i = 0; i < n; ++i) { dst[i] = alpha * src[i]; }                                \
+    }                                                                                              \
+    static void X##_axpy_scalar(size_t n, T *dst, T alpha, const T *src) {                         \
+        for (size_t i = 0; i < n; ++i) { dst[i] += alpha * src[i]; }                               \
+    }                                                                                              \
+    static T X##_sum_scalar(size_t n, const T *src) {                                              \
+        T sum = 0;                                                                                 \
+        for (size_t i = 0; i < n; ++i) { sum += src[i]; }                                          \
+        return sum;                                                                                \
+    }                                                                                              \
+    static T X##_dot_scalar(size_t n, const T *a, const T *b) {                                    \
+        T sum = 0;                                                                                 \
+        for (size_t i = 0; i < n; ++i) { sum += a[i] * b[i]; }                                     \
+        return sum;                                                                                \
+    }                                                                                              \
+    static void X##_gemm_ukernel_scalar(size_t kc, T alpha, const T *restrict a,                   \
+                                        const T *restrict b, T beta, T *restrict c, size_t rsc,    \
+                                        size_t csc) {                                              \
+        T ab[4][4] = {{0}};                                                                        \
+        for (size_t p = 0; p < kc; ++p) {                                                          \
+            for (size_t i = 0; i < 4; ++i) {                                                       \
+                for (size_t j = 0; j < 4; ++j) { ab[i][j] += a[p * 4 + i] * b[p * 4 + j]; }        \
+            }                                                                                      \
+        }                                                                                          \
+        X##_gemm_store_tile(4, 4, alpha, ab[0], 4, beta, c, rsc, csc);                             \
+    }                                                                                              \
+    static const X##Kernels X##_kernels_scalar = {                                                 \
+        .mr           = 4,                                                                         \
+        .nr           = 4,                                                                         \
+        .gemm_ukernel = X##_gemm_ukernel_scalar,                                                   \
+        .add          = X##_add_scalar,                                                            \
+        .sub          = X##_sub_scalar,                                                            \
+        .mul          = X##_mul_scalar,                                                            \
+        .scale        = X##_scale_scalar,                                                          \
+        .axpy         = X##_axpy_scalar,                                                           \
+        .sum          = X##_sum_scalar,                                                            \
+        .dot          = X##_dot_scalar,                                                            \
+    };
+
+#ifdef CMAT_X86_SIMD
+// the vector kernels of W lanes of a family with gcc vector extensions (see
+// CMAT_DEFINE_VEC_KERNELS), the gemm micro-kernel have a 6 x 2W register tile
+#define CMAT_DEFINE_TYPE_VEC_KERNELS(X, T, isa, target, W)                                         \
+    typedef T X##_vec_##isa                                                                        \
+        __attribute__((vector_size((W) * sizeof(T)), aligned(sizeof(T)), may_alias));              \
+    target static void X##_add_##isa(size_t n, T *dst, const T *a, const T *b) {                   \
+        size_t i = 0;                                                                              \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(X##_vec_##isa *)(dst + i) =                                                          \
+                *(const X##_vec_##isa *)(a + i) + *(const X##_vec_##isa *)(b + i);                 \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] + b[i]; }                                               \
+    }                                                                                              \
+    target static void X##_sub_##isa(size_t n, T *dst, const T *a, const T *b) {                   \
+        size_t i = 0;                                                                              \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(X##_vec_##isa *)(dst + i) =                                                          \
+                *(const X##_vec_##isa *)(a + i) - *(const X##_vec_##isa *)(b + i);                 \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] - b[i]; }                                               \
+    }                                                                                              \
+    target static void X##_mul_##isa(size_t n, T *dst, const T *a, const T *b) {                   \
+        size_t i = 0;                                                                              \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(X##_vec_##isa *)(dst + i) =                                                          \
+                *(const X##_vec_##isa *)(a + i) * *(const X##_vec_##isa *)(b + i);                 \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = a[i] * b[i]; }                                               \
+    }                                                                                              \
+    target static void X##_scale_##isa(size_t n, T *dst, T alpha, const T *src) {                  \
+        size_t i = 0;                                                                              \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(X##_vec_##isa *)(dst + i) = alpha * *(const X##_vec_##isa *)(src + i);               \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] = alpha * src[i]; }                                            \
+    }                                                                                              \
+    target static void X##_axpy_##isa(size_t n, T *dst, T alpha, const T *src) {                   \
+        size_t i = 0;                                                                              \
+        for (; i + (W) <= n; i += (W)) {                                                           \
+            *(X##_vec_##isa *)(dst + i) += alpha * *(const X##_vec_##isa *)(src + i);              \
+        }                                                                                          \
+        for (; i < n; ++i) { dst[i] += alpha * src[i]; }                                           \
+    }                                                                                              \
+    target static T X##_sum_##isa(size_t n, const T *src) {                                        \
+        X##_vec_##isa acc[4] = {{0}};                                                              \
+        size_t        i      = 0;                                                                  \
+        for (; i + 4 * (W) <= n; i += 4 * (W)) {                                                   \
+            for (size_t u = 0; u < 4; ++u) {                                                       \
+                acc[u] += *(const X##_vec_##isa *)(src + i + u * (W));                             \
+            }                                                                                      \
+        }                                                                                          \
+        acc[0] += acc[1] + acc[2] + acc[3];                                                        \
+        T sum = 0;                                                                                 \
+        for (size_t l = 0; l < (W); ++l) { sum += acc[0][l]; }                                     \
+        for (; i < n; ++i) { sum += src[i]; }                                                      \
+        return sum;                                                                                \
+    }                                                                                              \
+    target static T X##_dot_##isa(size_t n, const T *a, const T *b) {                              \
+        X##_vec_##isa acc[4] = {{0}};                                                              \
+        size_t        i      = 0;                                                                  \
+        for (; i + 4 * (W) <= n; i += 4 * (W)) {                                                   \
+            for (size_t u = 0; u < 4; ++u) {                                                       \
+                acc[u] += *(const X##_vec_##isa *)(a + i + u * (W)) *                              \
+                          *(const X##_vec_##isa *)(b + i + u * (W));                               \
+            }                                                                                      \
+        }                                                                                          \
+        acc[0] += acc[1] + acc[2] + acc[3];                                                        \
+        T sum = 0;                                                                                 \
+        for (size_t l = 0; l < (W); ++l) { sum += acc[0][l]; }                                     \
+        for (; i < n; ++i) { sum += a[i] * b[i]; }                                                 \
+        return sum;                                                                                \
+    }                                                                                              \
+    /* 6 x 2W register tile: every row of a broadcast against 2 vectors of b */                    \
+    target static void X##_gemm_ukernel_##isa(size_t kc, T alpha, const T *restrict a,             \
+                                              const T *restrict b, T beta, T *restrict c,          \
+                                              size_t rsc, size_t csc) {                            \
+        X##_vec_##isa acc[6][2];                                                                   \
+        _Pragma("GCC unroll 6") for (size_t i = 0; i < 6; ++i) {                                   \
+            acc[i][0] = acc[i][1] = (X##_vec_##isa){0};                                            \
+        }                                                                                          \
+        for (size_t p = 0; p < kc; ++p) {                                                          \
+            X##_vec_##isa b0 = *(const X##_vec_##isa *)b;                                          \
+            X##_vec_##isa b1 = *(const X##_vec_##isa *)(b + (W));                                  \
+            _Pragma("GCC unroll 6") for (size_t i = 0; i < 6; ++i) {                               \
+                acc[i][0] += a[i] * b0;                                                            \
+                acc[i][1] += a[i] * b1;                                                            \
+            }                                                                                      \
+            a += 6;                                                                                \
+            b += 2 * (W);                                                                          \
+        }                                                                                          \
+        if (csc != 1) {                                                                            \
+            T ab[6 * 2 * (W)];                                                                     \
+            _Pragma("GCC unroll 6") for (size_t i = 0; i < 6; ++i) {                               \
+                *(X##_vec_##isa *)(ab + i * 2 * (W))         = acc[i][0];                          \
+                *(X##_vec_##isa *)(ab + i * 2 * (W) + (W)) = acc[i][1];                            \
+            }                                                                                      \
+            X##_gemm_store_tile(6, 2 * (W), alpha, ab, 2 * (W), beta, c, rsc, csc);                \
+            return;                                                                                \
+        }                                                                                          \
+        _Pragma("GCC unroll 6") for (size_t i = 0; i < 6; ++i) {                                   \
+            _Pragma("GCC unroll 2") for (size_t j = 0; j < 2; ++j) {                               \
+                X##_vec_##isa *cij = (X##_vec_##isa *)(c + i * rsc + j * (W));                     \
+                X##_vec_##isa  res = alpha * acc[i][j];                                            \
+                if (beta != 0) { res += beta * *cij; }                                             \
+                *cij = res;                                                                        \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    static const X##Kernels X##_kernels_##isa = {                                                  \
+        .mr           = 6,                                                                         \
+        .nr           = 2 * (W),                                                                   \
+        .gemm_ukernel = X##_gemm_ukernel_##isa,                                                    \
+        .add          = X##_add_##isa,                                                             \
+        .sub          = X##_sub_##isa,                                                             \
+        .mul          = X##_mul_##isa,                                                             \
+        .scale        = X##_scale_##isa,                                                           \
+        .axpy         = X##_axpy_##isa,                                                            \
+        .sum          = X##_sum_##isa,                                                             \
+        .dot          = X##_dot_##isa,                                                             \
+    };
+#endif // CMAT_X86_SIMD
+
+// the functions of a family declared by CMAT_DECLARE_TYPE, sse2, avx2 and avx512 are the suffix
+// of the kernels of each instruction set (scalar if the family have no vector kernels)
+#define CMAT_DEFINE_TYPE(X, T, sse2, avx2, avx512)                                                 \
+    static const X##Kernels *X##_get_kernels(void) {                                               \
+        switch (CMat_isa_get()) {                                                                  \
+        case CMAT_ISA_AVX512: return &X##_kernels_##avx512;                                        \
+        case CMAT_ISA_AVX2: return &X##_kernels_##avx2;                                            \
+        case CMAT_ISA_SSE2: return &X##_kernels_##sse2;                                            \
+        default: return &X##_kernels_scalar;                                                       \
+        }                                                                                          \
+    }                                                                                              \
+    void X##_init(X *cmat, size_t nrow, size_t ncol) {                                             \
+        cmat->data = cmat_malloc(ncol * nrow, sizeof(*cmat->data));                                \
+        CMAT_ASSERT(cmat->data, "malloc failed");                                                  \
+        cmat->nrow   = nrow;                                                                       \
+        cmat->ncol   = ncol;                                                                       \
+        cmat->stride = ncol;                                                                       \
+    }                                                                                              \
+    void X##_from_d(X *dst, const CMat *src) {                                                     \
+        CMat_iterate2(dst, src, row, col, val1, val2, *val1 = (T)*val2;);                          \
+    }                                                                                              \
+    void X##_to_d(CMat *dst, const X *src) {                                                       \
+        CMat_iterate2(dst, src, row, col, val1, val2, *val1 = (CMatType)*val2;);                   \
+    }                                                                                              \
+    void X##_add(X *dst, const X *cmat1, const X *cmat2) {                                         \
+        CMAT_ELEMWISE3(X##_get_kernels()->add, dst, cmat1, cmat2);                                 \
+    }                                                                                              \
+    void X##_sub(X *dst, const X *cmat1, const X *cmat2) {                                         \
+        CMAT_ELEMWISE3(X##_get_kernels()->sub, dst, cmat1, cmat2);                                 \
+    }                                                                                              \
+    void X##_mul(X *dst, const X *cmat1, const X *cmat2) {                                         \
+        CMAT_ELEMWISE3(X##_get_kernels()->mul, dst, cmat1, cmat2);                                 \
+    }                                                                                              \
+    void X##_scale(X *dst, T alpha, const X *src) {                                                \
+        CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");                                   \
+        CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");                                   \
+        for (size_t row = 0; row < dst->nrow; ++row) {                                             \
+            X##_get_kernels()->scale(dst->ncol, CMat_pat(dst, row, 0), alpha,                      \
+                                     CMat_pat(src, row, 0));                                       \
+        }                                                                                          \
+    }                                                                                              \
+    void X##_axpy(X *dst, T alpha, const X *src) {                                                 \
+        CMAT_ASSERT(dst->nrow == src->nrow, "nrow don't match");                                   \
+        CMAT_ASSERT(dst->ncol == src->ncol, "ncol don't match");                                   \
+        for (size_t row = 0; row < dst->nrow; ++row) {                                             \
+            X##_get_kernels()->axpy(dst->ncol, CMat_pat(dst, row, 0), alpha,                       \
+                                    CMat_pat(src, row, 0));                                        \
+        }                                                                                          \
+    }                                                                                              \
+    T X##_sum(const X *cmat) {                                                                     \
+        T sum = 0;                                                                                 \
+        for (size_t row = 0; row < cmat->nrow; ++row) {                                            \
+            sum += X##_get_kernels()->sum(cmat->ncol, CMat_pat(cmat, row, 0));                     \
+        }                                                                                          \
+        return sum;                                                                                \
+    }                                                                                              \
+    T X##_inner(const X *cmat1, const X *cmat2) {                                                  \
+        CMAT_ASSERT(cmat1->nrow == cmat2->nrow, "nrow don't match");                               \
+        CMAT_ASSERT(cmat1->ncol == cmat2->ncol, "ncol don't match");                               \
+        T sum = 0;                                                                                 \
+        for (size_t row = 0; row < cmat1->nrow; ++row) {                                           \
+            sum += X##_get_kernels()->dot(cmat1->ncol, CMat_pat(cmat1, row, 0),                    \
+                                          CMat_pat(cmat2, row, 0));                                \
+        }                                                                                          \
+        return sum;                                                                                \
+    }                                                                                              \
+    void X##_transpose(X *dst, const X *src) {                                                     \
+        CMAT_ASSERT(dst->nrow == src->ncol, "dst->nrow should be == to src->ncol");                \
+        CMAT_ASSERT(dst->ncol == src->nrow, "dst->ncol should be == to src->nrow");                \
+        for (size_t row0 = 0; row0 < src->nrow; row0 += CMAT_TRANSPOSE_TILE) {                     \
+            size_t row_end = CMAT_MIN(row0 + CMAT_TRANSPOSE_TILE, src->nrow);                      \
+            for (size_t col0 = 0; col0 < src->ncol; col0 += CMAT_TRANSPOSE_TILE) {                 \
+                size_t col_end = CMAT_MIN(col0 + CMAT_TRANSPOSE_TILE, src->ncol);                  \
+                for (size_t row = row0; row < row_end; ++row) {                                    \
+                    for (size_t col = col0; col < col_end; ++col) {                                \
+                        CMat_at(dst, col, row) = CMat_at(src, row, col);                           \
+                    }                                                                              \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    void X##_gemm(X *dst, T alpha, const X *cmat1, const X *cmat2, T beta) {                       \
+        CMAT_ASSERT(cmat1->nrow == dst->nrow, "a->nrow should match with dst->nrow");              \
+        CMAT_ASSERT(cmat1->ncol == cmat2->nrow, "a->ncol should match with b->nrow");              \
+        CMAT_ASSERT(cmat2->ncol == dst->ncol, "b->ncol should match with dst->ncol");              \
+        const X##Kernels *kern = X##_get_kernels();                                                \
+        size_t            m = dst->nrow, n = dst->ncol, k = cmat1->ncol;                           \
+        if (k == 0 || alpha == 0) {                                                                \
+            for (size_t row = 0; row < m; ++row) {                                                 \
+                T *c = CMat_pat(dst, row, 0);                                                      \
+                for (size_t col = 0; col < n; ++col) { c[col] = (beta == 0) ? 0 : beta * c[col]; } \
+            }                                                                                      \
+            return;                                                                                \
+        }                                                                                          \
+        size_t mr       = kern->mr;                                                                \
+        size_t nr       = kern->nr;                                                                \
+        size_t mc_max   = CMAT_MIN(CMAT_ROUND_UP(CMAT_GEMM_MC, mr), CMAT_ROUND_UP(m, mr));         \
+        size_t nc_max   = CMAT_MIN(CMAT_ROUND_UP(CMAT_GEMM_NC, nr), CMAT_ROUND_UP(n, nr));         \
+        size_t kc_max   = CMAT_MIN(CMAT_GEMM_KC, k);                                               \
+        size_t pa_size  = CMAT_ROUND_UP(mc_max * kc_max * sizeof(T), CMAT_ALIGN);                  \
+        size_t buf_size = pa_size + kc_max * nc_max * sizeof(T) + CMAT_ALIGN;                      \
+        void  *buf      = cmat_scratch_alloc(buf_size);                                            \
+        T     *pa       = (T *)CMAT_ROUND_UP((uintptr_t)buf, CMAT_ALIGN);                          \
+        T     *pb       = (T *)((unsigned char *)pa + pa_size);                                    \
+        for (size_t jc = 0; jc < n; jc += nc_max) {                                                \
+            size_t nc = CMAT_MIN(nc_max, n - jc);                                                  \
+            for (size_t pc = 0; pc < k; pc += kc_max) {                                            \
+                size_t kc      = CMAT_MIN(kc_max, k - pc);                                         \
+                T      beta_pc = (pc == 0) ? beta : 1;                                             \
+                X##_gemm_pack_b(pb, CMat_pat(cmat2, pc, jc), cmat2->stride, kc, nc, nr);           \
+                for (size_t ic = 0; ic < m; ic += mc_max) {                                        \
+                    size_t mc = CMAT_MIN(mc_max, m - ic);                                          \
+                    X##_gemm_pack_a(pa, CMat_pat(cmat1, ic, pc), cmat1->stride, mc, kc, mr);       \
+                    for (size_t jr = 0; jr < nc; jr += nr) {                                       \
+                        size_t tile_n = CMAT_MIN(nr, nc - jr);                                     \
+                        for (size_t ir = 0; ir < mc; ir += mr) {                                   \
+                            size_t   tile_m = CMAT_MIN(mr, mc - ir);                               \
+                            const T *a      = pa + ir * kc;                                        \
+                            const T *b      = pb + jr * kc;                                        \
+                            T       *c      = CMat_pat(dst, ic + ir, jc + jr);                     \
+                            if (tile_m == mr && tile_n == nr) {                                    \
+                                kern->gemm_ukernel(kc, alpha, a, b, beta_pc, c, dst->stride, 1);   \
+                                continue;                                                          \
+                            }                                                                      \
+                            T tmp[CMAT_GEMM_TILE_MAX];                                             \
+                            kern->gemm_ukernel(kc, alpha, a, b, 0, tmp, nr, 1);                    \
+                            X##_gemm_store_tile(tile_m, tile_n, 1, tmp, nr, beta_pc, c,            \
+                                                dst->stride, 1);                                   \
+                        }                                                                          \
+                    }                                                                              \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+        cmat_scratch_free(buf, buf_size);                                                          \
+    }                                                                                              \
+    void X##_dot(X *dst, const X *cmat1, const X *cmat2) { X##_gemm(dst, 1, cmat1, cmat2, 0); }
+
+CMAT_DEFINE_TYPE_BASE(CMatf, float)
+CMAT_DEFINE_TYPE_BASE(CMati32, int32_t)
+CMAT_DEFINE_TYPE_BASE(CMatcf, float _Complex)
+CMAT_DEFINE_TYPE_BASE(CMatcd, double _Complex)
+#ifdef CMAT_X86_SIMD
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMatf, float, sse2, CMAT_TARGET_SSE2, 4)
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMatf, float, avx2, CMAT_TARGET_AVX2, 8)
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMatf, float, avx512, CMAT_TARGET_AVX512, 16)
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMati32, int32_t, sse2, CMAT_TARGET_SSE2, 4)
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMati32, int32_t, avx2, CMAT_TARGET_AVX2, 8)
+CMAT_DEFINE_TYPE_VEC_KERNELS(CMati32, int32_t, avx512, CMAT_TARGET_AVX512, 16)
+CMAT_DEFINE_TYPE(CMatf, float, sse2, avx2, avx512)
+CMAT_DEFINE_TYPE(CMati32, int32_t, sse2, avx2, avx512)
+#else
+CMAT_DEFINE_TYPE(CMatf, float, scalar, scalar, scalar)
+CMAT_DEFINE_TYPE(CMati32, int32_t, scalar, scalar, scalar)
+#endif // CMAT_X86_SIMD
+// gcc vector extensions don't have complex lanes
+CMAT_DEFINE_TYPE(CMatcf, float _Complex, scalar, scalar, scalar)
+CMAT_DEFINE_TYPE(CMatcd, double _Complex, scalar, scalar, scalar)
+#ifndef CMAT_NO_PRINT
+CMAT_DEFINE_TYPE_IO(CMatf)
+CMAT_DEFINE_TYPE_IO(CMati32)
+CMAT_DEFINE_TYPE_IO(CMatcf)
+CMAT_DEFINE_TYPE_IO(CMatcd)
+#endif // CMAT_NO_PRINT
+#endif // CMAT_NO_TYPES
 #endif // CMAT_IMPL